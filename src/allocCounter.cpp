@@ -0,0 +1,302 @@
+#include "allocCounter.h"
+
+#ifdef TRIPNO_ALLOC_COUNT
+
+#include "atomicOps.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef _MSC_VER
+#define ALLOC_THREAD_LOCAL __declspec(thread)
+#else
+#define ALLOC_THREAD_LOCAL __thread
+#endif
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+#define ALLOC_NOEXCEPT noexcept
+#else
+#define ALLOC_NOEXCEPT throw()
+#endif
+
+// sized delete (C++14) and aligned new (C++17), when the compiler has them
+#if defined(__cpp_sized_deallocation) || (defined(_MSC_VER) && _MSC_VER >= 1900)
+#define ALLOC_SIZED_DELETE
+#endif
+#if defined(__cpp_aligned_new)
+#define ALLOC_ALIGNED_NEW
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+#endif
+
+// static, a slot must not come from the heap it counts. Written only by the
+// thread that owns it, read by allocSnapshot.
+static t_allocCount slots[ALLOC_MAX_THREADS];
+static uint32_t owners[ALLOC_MAX_THREADS]; // 1 while a thread owns the slot
+static uint32_t slotCount; // slots ever taken, may pass ALLOC_MAX_THREADS
+
+static ALLOC_THREAD_LOCAL t_allocCount* threadSlot;
+static ALLOC_THREAD_LOCAL bool threadRejected;
+
+//--------------------------------------------------------------
+// owners only ever go up and back down by one, so a try that loses undoes
+// itself without a compare and swap
+static bool tryOwn(int index) {
+	if (loadAcquire(&owners[index]) != 0) {
+		return false;
+	}
+	if (fetchAdd(&owners[index], 1) == 0) {
+		return true;
+	}
+	fetchAdd(&owners[index], (uint32_t)-1);
+	return false;
+}
+
+//--------------------------------------------------------------
+static void release(t_allocCount* slot) {
+	fetchAdd(&owners[slot - slots], (uint32_t)-1);
+}
+
+//--------------------------------------------------------------
+// a slot no thread owns, named name, or unnamed for NULL
+static t_allocCount* reuseSlot(const char* name) {
+	uint32_t count = loadAcquire(&slotCount);
+	for (uint32_t i = 0; i < count && i < ALLOC_MAX_THREADS; i++) {
+		const char* thread = (const char*)loadAcquirePointer((void* const*)&slots[i].thread);
+		bool match = name ? thread && strcmp(thread, name) == 0 : !thread;
+		if (match && tryOwn(i)) {
+			return &slots[i];
+		}
+	}
+	return NULL;
+}
+
+//--------------------------------------------------------------
+static t_allocCount* getThreadSlot() {
+	if (threadSlot || threadRejected) {
+		return threadSlot;
+	}
+
+	threadSlot = reuseSlot(NULL);
+	while (!threadSlot) {
+		uint32_t index = fetchAdd(&slotCount, 1);
+		if (index >= ALLOC_MAX_THREADS) {
+			threadRejected = true;
+			return NULL;
+		}
+		// a reuseSlot may see the new slot before it is owned here
+		if (tryOwn(index)) {
+			threadSlot = &slots[index];
+		}
+	}
+	return threadSlot;
+}
+
+//--------------------------------------------------------------
+static void countAlloc(size_t size) {
+	t_allocCount* slot = getThreadSlot();
+	if (slot) {
+		storeRelease(&slot->allocations, slot->allocations + 1);
+		storeRelease(&slot->bytes, slot->bytes + (uint32_t)size);
+	}
+}
+
+//--------------------------------------------------------------
+static void* countedAlloc(size_t size) {
+	countAlloc(size);
+	return malloc(size ? size : 1);
+}
+
+#ifdef ALLOC_ALIGNED_NEW
+//--------------------------------------------------------------
+// freed by alignedFree only
+static void* countedAlignedAlloc(size_t size, size_t align) {
+	countAlloc(size);
+	if (align < sizeof(void*)) {
+		align = sizeof(void*);
+	}
+#ifdef _MSC_VER
+	return _aligned_malloc(size ? size : 1, align);
+#else
+	void* p = NULL;
+	return posix_memalign(&p, align, size ? size : 1) == 0 ? p : NULL;
+#endif
+}
+
+//--------------------------------------------------------------
+static void alignedFree(void* p) {
+#ifdef _MSC_VER
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+#endif
+
+//--------------------------------------------------------------
+void allocThreadName(const char* name) {
+	t_allocCount* slot = getThreadSlot();
+	if (slot && slot->thread == name) {
+		return;
+	}
+
+	// the slot of an earlier thread of that name
+	if (!slot || !slot->thread) {
+		t_allocCount* named = reuseSlot(name);
+		if (named) {
+			if (slot) {
+				release(slot);
+			}
+			threadSlot = named;
+			threadRejected = false;
+			return;
+		}
+	}
+
+	if (slot) {
+		storeReleasePointer((void**)&slot->thread, (void*)name);
+	}
+}
+
+//--------------------------------------------------------------
+void allocThreadExit() {
+	if (threadSlot) {
+		release(threadSlot);
+	}
+	threadSlot = NULL;
+	threadRejected = true;
+}
+
+//--------------------------------------------------------------
+int allocSnapshot(t_allocCount* counts, int max) {
+	int count = (int)loadAcquire(&slotCount);
+	if (count > ALLOC_MAX_THREADS) {
+		count = ALLOC_MAX_THREADS;
+	}
+	if (count > max) {
+		count = max;
+	}
+
+	for (int i = 0; i < count; i++) {
+		counts[i].thread = (const char*)loadAcquirePointer((void* const*)&slots[i].thread);
+		counts[i].allocations = loadAcquire(&slots[i].allocations);
+		counts[i].bytes = loadAcquire(&slots[i].bytes);
+	}
+	return count;
+}
+
+//--------------------------------------------------------------
+void* operator new(size_t size) {
+	void* p = countedAlloc(size);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+//--------------------------------------------------------------
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+//--------------------------------------------------------------
+void* operator new(size_t size, const std::nothrow_t&) ALLOC_NOEXCEPT {
+	return countedAlloc(size);
+}
+
+//--------------------------------------------------------------
+void* operator new[](size_t size, const std::nothrow_t&) ALLOC_NOEXCEPT {
+	return countedAlloc(size);
+}
+
+//--------------------------------------------------------------
+void operator delete(void* p) ALLOC_NOEXCEPT {
+	free(p);
+}
+
+//--------------------------------------------------------------
+void operator delete[](void* p) ALLOC_NOEXCEPT {
+	free(p);
+}
+
+//--------------------------------------------------------------
+void operator delete(void* p, const std::nothrow_t&) ALLOC_NOEXCEPT {
+	free(p);
+}
+
+//--------------------------------------------------------------
+void operator delete[](void* p, const std::nothrow_t&) ALLOC_NOEXCEPT {
+	free(p);
+}
+
+#ifdef ALLOC_SIZED_DELETE
+//--------------------------------------------------------------
+void operator delete(void* p, size_t) ALLOC_NOEXCEPT {
+	free(p);
+}
+
+//--------------------------------------------------------------
+void operator delete[](void* p, size_t) ALLOC_NOEXCEPT {
+	free(p);
+}
+#endif
+
+#ifdef ALLOC_ALIGNED_NEW
+//--------------------------------------------------------------
+void* operator new(size_t size, std::align_val_t align) {
+	void* p = countedAlignedAlloc(size, (size_t)align);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+//--------------------------------------------------------------
+void* operator new[](size_t size, std::align_val_t align) {
+	return operator new(size, align);
+}
+
+//--------------------------------------------------------------
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) ALLOC_NOEXCEPT {
+	return countedAlignedAlloc(size, (size_t)align);
+}
+
+//--------------------------------------------------------------
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) ALLOC_NOEXCEPT {
+	return countedAlignedAlloc(size, (size_t)align);
+}
+
+//--------------------------------------------------------------
+void operator delete(void* p, std::align_val_t) ALLOC_NOEXCEPT {
+	alignedFree(p);
+}
+
+//--------------------------------------------------------------
+void operator delete[](void* p, std::align_val_t) ALLOC_NOEXCEPT {
+	alignedFree(p);
+}
+
+//--------------------------------------------------------------
+void operator delete(void* p, size_t, std::align_val_t) ALLOC_NOEXCEPT {
+	alignedFree(p);
+}
+
+//--------------------------------------------------------------
+void operator delete[](void* p, size_t, std::align_val_t) ALLOC_NOEXCEPT {
+	alignedFree(p);
+}
+
+//--------------------------------------------------------------
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) ALLOC_NOEXCEPT {
+	alignedFree(p);
+}
+
+//--------------------------------------------------------------
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) ALLOC_NOEXCEPT {
+	alignedFree(p);
+}
+#endif
+
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+// Heap allocations per thread, to see what the frame loop and the audio
+// and simulation threads allocate once they run.
+//
+// With TRIPNO_ALLOC_COUNT defined, the global operator new and delete are
+// replaced, with their sized and aligned forms where the compiler has them,
+// by ones that count every new of a thread, and its bytes, in a
+// slot of a fixed table taken on the first allocation of the thread. The
+// counting itself never allocates and takes no lock. malloc calls of C
+// code, the system and the GL driver are not seen. Threads past
+// ALLOC_MAX_THREADS are not counted.
+//
+// A thread that ends calls ALLOC_THREAD_EXIT. Its slot is then left to the
+// next thread of the same name, which adds to the counts, so a thread
+// started again and again (a loader, a writer) keeps one slot. The slot a
+// thread took before it was named goes back to the unnamed threads.
+//
+// Without the define, nothing is replaced and the macros expand to nothing.
+
+#define ALLOC_MAX_THREADS 16
+
+struct t_allocCount {
+	const char* thread;	// NULL until named
+	uint32_t allocations;	// since the thread started, wraps
+	uint32_t bytes;		// wraps
+};
+
+#ifdef TRIPNO_ALLOC_COUNT
+
+void allocThreadName(const char* name);
+// the calling thread ends, its later allocations are not counted
+void allocThreadExit();
+// the counts of the threads seen so far, returns how many were written
+int allocSnapshot(t_allocCount* counts, int max);
+
+#define ALLOC_THREAD_NAME(name) allocThreadName(name)
+#define ALLOC_THREAD_EXIT() allocThreadExit()
+
+#else
+
+#define ALLOC_THREAD_NAME(name)
+#define ALLOC_THREAD_EXIT()
+
+#endif
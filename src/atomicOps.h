@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#include <windows.h>
+#endif
+
+// Acquire / release accesses on words shared between threads or processes,
+// for the lock-free queues and rings. Built on the compiler intrinsics, so
+// it works without C++11 <atomic> and on memory mapped by other processes.
+
+#ifdef _MSC_VER
+static inline uint32_t loadAcquire(const uint32_t* p) {
+	uint32_t value = *(const volatile uint32_t*)p;
+	_ReadWriteBarrier();
+	return value;
+}
+
+static inline void storeRelease(uint32_t* p, uint32_t value) {
+	_ReadWriteBarrier();
+	*(volatile uint32_t*)p = value;
+}
+
+static inline void fenceRelease() { MemoryBarrier(); }
+static inline void fenceAcquire() { MemoryBarrier(); }
+
+static inline void* loadAcquirePointer(void* const* p) {
+	void* value = *(void* const volatile*)p;
+	_ReadWriteBarrier();
+	return value;
+}
+
+static inline void storeReleasePointer(void** p, void* value) {
+	_ReadWriteBarrier();
+	*(void* volatile*)p = value;
+}
+
+// returns the value before the add
+static inline uint32_t fetchAdd(uint32_t* p, uint32_t value) {
+	return (uint32_t)InterlockedExchangeAdd((volatile LONG*)p, (LONG)value);
+}
+#else
+static inline uint32_t loadAcquire(const uint32_t* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static inline void storeRelease(uint32_t* p, uint32_t value) { __atomic_store_n(p, value, __ATOMIC_RELEASE); }
+static inline void fenceRelease() { __atomic_thread_fence(__ATOMIC_RELEASE); }
+static inline void fenceAcquire() { __atomic_thread_fence(__ATOMIC_ACQUIRE); }
+
+static inline void* loadAcquirePointer(void* const* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static inline void storeReleasePointer(void** p, void* value) { __atomic_store_n(p, value, __ATOMIC_RELEASE); }
+
+// returns the value before the add
+static inline uint32_t fetchAdd(uint32_t* p, uint32_t value) { return __atomic_fetch_add(p, value, __ATOMIC_ACQ_REL); }
+#endif
@@ -0,0 +1,253 @@
+#include "audioCapture.h"
+#include "atomicOps.h"
+#include "traceZones.h"
+#include "allocCounter.h"
+
+#include <cstring>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define WAV_HEADER_SIZE 44
+
+//--------------------------------------------------------------
+audioCapture::audioCapture() {
+	slotSamples = 0;
+	head = tail = 0;
+	active = 0;
+	overflows = overflowBase = 0;
+	blockIndex = 0;
+
+	file = NULL;
+	blocksFile = NULL;
+	format = CAPTURE_OFF;
+	buffered = 0;
+	dataBytes = reservedBytes = 0;
+	blocksWritten = 0;
+	failed = false;
+
+	sampleRate = 0;
+	channels = 0;
+}
+
+//--------------------------------------------------------------
+audioCapture::~audioCapture() {
+	stop();
+}
+
+//--------------------------------------------------------------
+void audioCapture::setup(int sampleRate, int channels, int blockSize) {
+	this->sampleRate = sampleRate;
+	this->channels = channels;
+
+	slotSamples = blockSize * channels;
+	slots.assign(CAPTURE_QUEUE_BLOCKS, t_captureSlot());
+	samples.assign(CAPTURE_QUEUE_BLOCKS * slotSamples, 0);
+	buffer.resize(CAPTURE_WRITE_SIZE);
+}
+
+//--------------------------------------------------------------
+bool audioCapture::start(const std::string& path, captureFormat format, double preallocateSeconds) {
+	stop();
+
+	if (slots.empty() || format == CAPTURE_OFF) {
+		return false;
+	}
+
+	file = fopen(path.c_str(), "wb");
+	if (!file) {
+		return false;
+	}
+	// the writes are already CAPTURE_WRITE_SIZE, no need to copy them again
+	setvbuf(file, NULL, _IONBF, 0);
+
+	blocksFile = fopen((path + ".blocks.csv").c_str(), "w");
+	if (blocksFile) {
+		fprintf(blocksFile, "# %d Hz, %d channels, float32\n", sampleRate, channels);
+		fprintf(blocksFile, "block,frame,timeMicros\n");
+	}
+
+	this->path = path;
+	this->format = format;
+	buffered = 0;
+	dataBytes = 0;
+	reservedBytes = 0;
+	blocksWritten = 0;
+	failed = false;
+
+	if (format == CAPTURE_WAV) {
+		writeWavHeader(0);
+	}
+
+#ifdef __linux__
+	uint64_t reserve = (uint64_t)(preallocateSeconds * sampleRate) * channels * sizeof(float);
+	if (reserve && posix_fallocate(fileno(file), ftell(file), reserve) == 0) {
+		reservedBytes = reserve;
+	}
+#endif
+
+	// blocks queued before the capture started are not part of it
+	storeRelease(&tail, loadAcquire(&head));
+	overflowBase = loadAcquire(&overflows);
+	storeRelease(&active, 1);
+
+	startThread(true, false);
+	return true;
+}
+
+//--------------------------------------------------------------
+void audioCapture::stop() {
+	if (!file) {
+		return;
+	}
+
+	storeRelease(&active, 0);
+	waitForThread(true);
+
+	drain();
+	flush();
+
+	long headerSize = format == CAPTURE_WAV ? WAV_HEADER_SIZE : 0;
+	if (format == CAPTURE_WAV && fseek(file, 0, SEEK_SET) == 0) {
+		writeWavHeader(dataBytes);
+	}
+
+#ifndef _WIN32
+	// give back what was preallocated and not used
+	if (reservedBytes > dataBytes && ftruncate(fileno(file), headerSize + dataBytes) != 0) {
+		failed = true;
+	}
+#endif
+
+	fclose(file);
+	file = NULL;
+
+	if (blocksFile) {
+		fclose(blocksFile);
+		blocksFile = NULL;
+	}
+}
+
+//--------------------------------------------------------------
+uint32_t audioCapture::getOverflows() const {
+	return loadAcquire(&overflows) - overflowBase;
+}
+
+//--------------------------------------------------------------
+void audioCapture::push(const float* input, int bufferSize, int nChannels, uint64_t timeMicros) {
+	uint32_t index = blockIndex++;
+
+	if (!loadAcquire(&active)) {
+		return;
+	}
+
+	// a full ring, or a block that does not fit a slot, is dropped
+	int count = bufferSize * nChannels;
+	if (head - loadAcquire(&tail) >= CAPTURE_QUEUE_BLOCKS || nChannels != channels || count > slotSamples) {
+		storeRelease(&overflows, overflows + 1);
+		return;
+	}
+
+	uint32_t slot = head & (CAPTURE_QUEUE_BLOCKS - 1);
+	memcpy(&samples[slot * slotSamples], input, count * sizeof(float));
+	slots[slot].index = index;
+	slots[slot].frames = bufferSize;
+	slots[slot].timeMicros = timeMicros;
+
+	storeRelease(&head, head + 1);
+}
+
+//--------------------------------------------------------------
+void audioCapture::threadedFunction() {
+	TRACE_THREAD_NAME("capture");
+	ALLOC_THREAD_NAME("capture");
+
+	while (isThreadRunning()) {
+		drain();
+		ofSleepMillis(CAPTURE_WRITER_SLEEP);
+	}
+	ALLOC_THREAD_EXIT();
+}
+
+//--------------------------------------------------------------
+void audioCapture::drain() {
+	uint32_t end = loadAcquire(&head);
+	if (tail == end) {
+		return;
+	}
+	TRACE_ZONE("capture write");
+
+	while (tail != end) {
+		uint32_t slot = tail & (CAPTURE_QUEUE_BLOCKS - 1);
+		const t_captureSlot& block = slots[slot];
+
+		if (blocksFile) {
+			fprintf(blocksFile, "%u,%llu,%llu\n", block.index,
+				(unsigned long long)(dataBytes / (channels * sizeof(float))),
+				(unsigned long long)block.timeMicros);
+		}
+		write((const char*)&samples[slot * slotSamples], block.frames * channels * sizeof(float));
+		blocksWritten++;
+
+		storeRelease(&tail, tail + 1);
+	}
+}
+
+//--------------------------------------------------------------
+void audioCapture::write(const char* data, size_t size) {
+	dataBytes += size;
+
+	while (size) {
+		size_t chunk = std::min(size, buffer.size() - buffered);
+		memcpy(&buffer[buffered], data, chunk);
+		buffered += chunk;
+		data += chunk;
+		size -= chunk;
+
+		if (buffered == buffer.size()) {
+			flush();
+		}
+	}
+}
+
+//--------------------------------------------------------------
+void audioCapture::flush() {
+	if (buffered && !failed && fwrite(&buffer[0], 1, buffered, file) != buffered) {
+		failed = true;
+	}
+	buffered = 0;
+}
+
+//--------------------------------------------------------------
+static void putLE(unsigned char* out, uint32_t value, int bytes) {
+	for (int i = 0; i < bytes; i++) {
+		out[i] = (value >> (8 * i)) & 0xff;
+	}
+}
+
+void audioCapture::writeWavHeader(uint64_t dataBytes) {
+	// sizes saturate past 4 GB, most readers then take the data to the end of the file
+	uint32_t dataSize = dataBytes > 0xffffffff - 36 ? 0xffffffff - 36 : (uint32_t)dataBytes;
+	uint32_t frameSize = channels * sizeof(float);
+
+	unsigned char header[WAV_HEADER_SIZE];
+	memcpy(header, "RIFF", 4);
+	putLE(header + 4, 36 + dataSize, 4);
+	memcpy(header + 8, "WAVEfmt ", 8);
+	putLE(header + 16, 16, 4);
+	putLE(header + 20, 3, 2); // WAVE_FORMAT_IEEE_FLOAT
+	putLE(header + 22, channels, 2);
+	putLE(header + 24, sampleRate, 4);
+	putLE(header + 28, sampleRate * frameSize, 4);
+	putLE(header + 32, frameSize, 2);
+	putLE(header + 34, 32, 2);
+	memcpy(header + 36, "data", 4);
+	putLE(header + 40, dataSize, 4);
+
+	if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) {
+		failed = true;
+	}
+}
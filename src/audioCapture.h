@@ -0,0 +1,97 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#define CAPTURE_QUEUE_BLOCKS 64 // ~1.5 s of 1024 sample hops at 44100 Hz
+#define CAPTURE_WRITE_SIZE (1 << 20) // bytes per file write
+#define CAPTURE_WRITER_SLEEP 5 // ms between drains
+
+enum captureFormat {
+	CAPTURE_OFF,
+	CAPTURE_WAV,	// 32 bit float WAV
+	CAPTURE_RAW		// headerless interleaved 32 bit float
+};
+
+// Records the raw audio input to disk, off the audio thread.
+//
+// push() copies each audio block into a single producer / single consumer
+// ring of preallocated slots and returns, it never takes a lock nor waits.
+// When the ring is full the block is dropped and counted as an overflow.
+// A writer thread drains the ring into a CAPTURE_WRITE_SIZE buffer and
+// writes it out in large sequential writes. With preallocation, the file
+// space for that many seconds is reserved up front (Linux only) and
+// trimmed when the capture stops.
+//
+// Next to the audio, path.blocks.csv lists every block written: its block
+// number, first sample frame in the file and arrival time. Block numbers
+// count every audioIn() call like the control stream record index, and
+// times are on the controlStreamTime() clock, so the two logs line up.
+class audioCapture : public ofThread {
+
+	public:
+		audioCapture();
+		~audioCapture();
+
+		// allocates the ring, call before the sound stream starts
+		void setup(int sampleRate, int channels, int blockSize);
+
+		// opens the files and starts the writer thread
+		bool start(const std::string& path, captureFormat format, double preallocateSeconds = 0);
+		// writes what is still queued and closes the files
+		void stop();
+		bool isCapturing() const { return file != NULL; }
+
+		// from the audio thread, once per block, capturing or not
+		void push(const float* input, int bufferSize, int nChannels, uint64_t timeMicros);
+
+		// blocks dropped since start() because the ring was full
+		uint32_t getOverflows() const;
+		uint32_t getBlocksWritten() const { return blocksWritten; }
+		// a write to the file failed, the capture is incomplete
+		bool hasFailed() const { return failed; }
+		const std::string& getPath() const { return path; }
+
+	private:
+		struct t_captureSlot {
+			uint32_t index;
+			uint32_t frames;
+			uint64_t timeMicros;
+		};
+
+		void threadedFunction();
+		void drain();
+		void write(const char* data, size_t size);
+		void flush();
+		void writeWavHeader(uint64_t dataBytes);
+
+		// ring, written by the audio thread at head, read by the writer at tail
+		std::vector<t_captureSlot> slots;
+		std::vector<float> samples;
+		int slotSamples;
+		uint32_t head;
+		uint32_t tail;
+		uint32_t active;
+		uint32_t overflows;
+		uint32_t overflowBase;
+		uint32_t blockIndex;
+
+		// owned by the writer thread while capturing
+		FILE* file;
+		FILE* blocksFile;
+		std::string path;
+		captureFormat format;
+		std::vector<char> buffer;
+		size_t buffered;
+		uint64_t dataBytes;
+		uint64_t reservedBytes;
+		uint32_t blocksWritten;
+		bool failed;
+
+		int sampleRate;
+		int channels;
+};
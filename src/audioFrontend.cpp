@@ -0,0 +1,205 @@
+#include "audioFrontend.h"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRONTEND_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef FRONTEND_SSE2
+//--------------------------------------------------------------
+// Store four input samples converted to the analysis type
+static inline void storeSamples(double* out, __m128 x) {
+	_mm_storeu_pd(out, _mm_cvtps_pd(x));
+	_mm_storeu_pd(out + 2, _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+}
+
+static inline void storeSamples(float* out, __m128 x) {
+	_mm_storeu_ps(out, x);
+}
+
+static inline void storeSamples(int16_t* out, __m128 x) {
+	x = _mm_mul_ps(x, _mm_set1_ps(32767.0f));
+	x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-32768.0f)), _mm_set1_ps(32767.0f));
+	__m128i q = _mm_cvtps_epi32(x);
+	_mm_storel_epi64((__m128i*)out, _mm_packs_epi32(q, q));
+}
+#endif
+
+//--------------------------------------------------------------
+// Deinterleave + convert + peak. Returns the peak |x|.
+template<typename T>
+static float extractChannel(const float* input, int bufferSize, int nChannels, int channel,
+	T* samples, float* spectral) {
+
+	float peak = 0;
+	int i = 0;
+
+#ifdef FRONTEND_SSE2
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	__m128 peak4 = _mm_setzero_ps();
+
+	if (nChannels == 1 || nChannels == 2) {
+		for (; i + 4 <= bufferSize; i += 4) {
+			__m128 x;
+			if (nChannels == 1) {
+				x = _mm_loadu_ps(input + i);
+			}
+			else {
+				// L0 R0 L1 R1 | L2 R2 L3 R3 -> L0 L1 L2 L3 (or the R lane)
+				__m128 a = _mm_loadu_ps(input + i * 2);
+				__m128 b = _mm_loadu_ps(input + i * 2 + 4);
+				x = channel == 0
+					? _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))
+					: _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+			}
+
+			peak4 = _mm_max_ps(peak4, _mm_and_ps(x, absMask));
+
+			if (spectral) {
+				_mm_storeu_ps(spectral + i, x);
+			}
+			storeSamples(samples + i, x);
+		}
+	}
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, peak4);
+	peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+
+	// tail, and channel layouts the vector path does not cover
+	for (; i < bufferSize; i++) {
+		float x = input[i * nChannels + channel];
+		peak = std::max(peak, std::fabs(x));
+		if (spectral) {
+			spectral[i] = x;
+		}
+		samples[i] = sampleTraits<T>::fromFloat(x);
+	}
+
+	return peak;
+}
+
+//--------------------------------------------------------------
+// Zero every sample with |x| <= threshold, from i on.
+template<typename T>
+static void gateTail(int i, int bufferSize, T threshold, T* samples, float* spectral) {
+	for (; i < bufferSize; i++) {
+		if (samples[i] > threshold || samples[i] < -threshold) {
+			continue;
+		}
+
+		samples[i] = 0;
+		if (spectral) {
+			spectral[i] = 0;
+		}
+	}
+}
+
+//--------------------------------------------------------------
+// Zero every sample with |x| <= threshold. Runs over the output of
+// extractChannel, which is still hot in cache.
+static void gateChannel(int bufferSize, double threshold, double* samples, float* spectral) {
+	int i = 0;
+
+#ifdef FRONTEND_SSE2
+	const __m128d absMask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+	const __m128d level = _mm_set1_pd(threshold);
+
+	for (; i + 4 <= bufferSize; i += 4) {
+		__m128d lo = _mm_loadu_pd(samples + i);
+		__m128d hi = _mm_loadu_pd(samples + i + 2);
+		__m128d keepLo = _mm_cmpgt_pd(_mm_and_pd(lo, absMask), level);
+		__m128d keepHi = _mm_cmpgt_pd(_mm_and_pd(hi, absMask), level);
+
+		_mm_storeu_pd(samples + i, _mm_and_pd(lo, keepLo));
+		_mm_storeu_pd(samples + i + 2, _mm_and_pd(hi, keepHi));
+
+		if (spectral) {
+			// the same decision, narrowed to four 32-bit lanes
+			__m128 keep = _mm_shuffle_ps(_mm_castpd_ps(keepLo), _mm_castpd_ps(keepHi),
+				_MM_SHUFFLE(2, 0, 2, 0));
+			_mm_storeu_ps(spectral + i, _mm_and_ps(_mm_loadu_ps(spectral + i), keep));
+		}
+	}
+#endif
+
+	gateTail(i, bufferSize, threshold, samples, spectral);
+}
+
+static void gateChannel(int bufferSize, double threshold, float* samples, float* spectral) {
+	int i = 0;
+	const float level = (float)threshold;
+
+#ifdef FRONTEND_SSE2
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	const __m128 level4 = _mm_set1_ps(level);
+
+	for (; i + 4 <= bufferSize; i += 4) {
+		__m128 x = _mm_loadu_ps(samples + i);
+		__m128 keep = _mm_cmpgt_ps(_mm_and_ps(x, absMask), level4);
+
+		_mm_storeu_ps(samples + i, _mm_and_ps(x, keep));
+		if (spectral) {
+			_mm_storeu_ps(spectral + i, _mm_and_ps(_mm_loadu_ps(spectral + i), keep));
+		}
+	}
+#endif
+
+	gateTail(i, bufferSize, level, samples, spectral);
+}
+
+static void gateChannel(int bufferSize, double threshold, int16_t* samples, float* spectral) {
+	int i = 0;
+
+	// integer samples : |x| > threshold is |x| > floor(threshold)
+	const int16_t level = (int16_t)std::min(32767.0, floor(threshold * 32767.0));
+
+#ifdef FRONTEND_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i level8 = _mm_set1_epi16(level);
+
+	for (; i + 8 <= bufferSize; i += 8) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(samples + i));
+		// saturating negation, so -32768 counts as 32767
+		__m128i magnitude = _mm_max_epi16(x, _mm_subs_epi16(zero, x));
+		__m128i keep = _mm_cmpgt_epi16(magnitude, level8);
+
+		_mm_storeu_si128((__m128i*)(samples + i), _mm_and_si128(x, keep));
+		if (spectral) {
+			// the same decision, widened to 32-bit lanes
+			__m128 keepLo = _mm_castsi128_ps(_mm_unpacklo_epi16(keep, keep));
+			__m128 keepHi = _mm_castsi128_ps(_mm_unpackhi_epi16(keep, keep));
+			_mm_storeu_ps(spectral + i, _mm_and_ps(_mm_loadu_ps(spectral + i), keepLo));
+			_mm_storeu_ps(spectral + i + 4, _mm_and_ps(_mm_loadu_ps(spectral + i + 4), keepHi));
+		}
+	}
+#endif
+
+	gateTail(i, bufferSize, level, samples, spectral);
+}
+
+//--------------------------------------------------------------
+template<typename T>
+float audioFrontend(const float* input, int bufferSize, int nChannels, int channel,
+	double& maxSignal, double clampRate, double gateThreshold,
+	T* samples, float* spectral) {
+
+	float peak = extractChannel(input, bufferSize, nChannels, channel, samples, spectral);
+
+	// Update max signal or slightly reduce it
+	maxSignal = peak > maxSignal
+		? peak
+		: maxSignal * clampRate;
+
+	gateChannel(bufferSize, maxSignal * gateThreshold, samples, spectral);
+
+	return peak;
+}
+
+template float audioFrontend<double>(const float*, int, int, int, double&, double, double, double*, float*);
+template float audioFrontend<float>(const float*, int, int, int, double&, double, double, float*, float*);
+template float audioFrontend<int16_t>(const float*, int, int, int, double&, double, double, int16_t*, float*);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "sampleTypes.h"
+
+// Analysis front-end: the first stage of audioIn.
+//
+// Reads one channel of the interleaved input block once and produces the
+// gated analysis channel for the pitch tracker (in the analysis sample
+// type, see sampleTypes.h) and, optionally, the same channel as float for
+// the spectral stage.
+//
+// Gating follows the adaptive peak: maxSignal rises to the block peak at
+// once or decays by clampRate per block, and samples with
+// |x| <= maxSignal * gateThreshold are zeroed. The gate level depends on the
+// peak of the whole block, so the kernel does one streaming pass over the
+// interleaved input (deinterleave, convert, peak) and one pass over its own
+// output while that is still in cache.
+
+// samples  : bufferSize samples, receives the gated channel
+// spectral : bufferSize floats or NULL, receives the gated channel as float
+// maxSignal: running peak, updated in place (float scale)
+// returns the peak |x| of this block
+// Instantiated for double, float and int16_t.
+template<typename T>
+float audioFrontend(const float* input, int bufferSize, int nChannels, int channel,
+	double& maxSignal, double clampRate, double gateThreshold,
+	T* samples, float* spectral);
@@ -0,0 +1,109 @@
+#include "calibration.h"
+
+#include <stdint.h>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#define CALIBRATION_MAGIC "TCAL"
+#define CALIBRATION_VERSION 1
+#define CALIBRATION_FILE_SIZE 44
+
+//--------------------------------------------------------------
+t_calibration priorCalibration() {
+	t_calibration calibration;
+	calibration.minFreqLog = log((double)CALIBRATION_PRIOR_MIN_FREQ);
+	calibration.maxFreqLog = log((double)CALIBRATION_PRIOR_MAX_FREQ);
+	calibration.maxSignal = 0;
+	calibration.voicedSeconds = 0;
+	return calibration;
+}
+
+//--------------------------------------------------------------
+// FNV-1a
+static uint32_t checksum(const unsigned char* data, int size) {
+	uint32_t hash = 2166136261u;
+	for (int i = 0; i < size; i++) {
+		hash = (hash ^ data[i]) * 16777619u;
+	}
+	return hash;
+}
+
+//--------------------------------------------------------------
+// the tools and the game run on little endian machines only, the fields
+// are copied as they are
+static void putUint32(unsigned char* at, uint32_t value) { memcpy(at, &value, 4); }
+static void putDouble(unsigned char* at, double value) { memcpy(at, &value, 8); }
+static uint32_t getUint32(const unsigned char* at) { uint32_t value; memcpy(&value, at, 4); return value; }
+static double getDouble(const unsigned char* at) { double value; memcpy(&value, at, 8); return value; }
+
+//--------------------------------------------------------------
+bool readCalibration(const std::string& path, t_calibration& calibration) {
+	unsigned char data[CALIBRATION_FILE_SIZE];
+
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file) {
+		return false;
+	}
+	size_t size = fread(data, 1, CALIBRATION_FILE_SIZE, file);
+	fclose(file);
+
+	if (size != CALIBRATION_FILE_SIZE || memcmp(data, CALIBRATION_MAGIC, 4) != 0
+		|| getUint32(data + 4) != CALIBRATION_VERSION
+		|| getUint32(data + 40) != checksum(data, 40)) {
+		return false;
+	}
+
+	t_calibration read;
+	read.minFreqLog = getDouble(data + 8);
+	read.maxFreqLog = getDouble(data + 16);
+	read.maxSignal = getDouble(data + 24);
+	read.voicedSeconds = getDouble(data + 32);
+
+	// log Hz and peaks in their possible range, which also rejects NaN. The
+	// range may be crossed by a little, the tracking narrows it every hop.
+	if (!(read.minFreqLog >= 0 && read.minFreqLog < 20 && read.maxFreqLog >= 0 && read.maxFreqLog < 20
+		&& read.maxSignal >= 0 && read.maxSignal < 1000 && read.voicedSeconds >= 0)) {
+		return false;
+	}
+
+	calibration = read;
+	return true;
+}
+
+//--------------------------------------------------------------
+bool writeCalibration(const std::string& path, const t_calibration& calibration) {
+	unsigned char data[CALIBRATION_FILE_SIZE];
+	memcpy(data, CALIBRATION_MAGIC, 4);
+	putUint32(data + 4, CALIBRATION_VERSION);
+	putDouble(data + 8, calibration.minFreqLog);
+	putDouble(data + 16, calibration.maxFreqLog);
+	putDouble(data + 24, calibration.maxSignal);
+	putDouble(data + 32, calibration.voicedSeconds);
+	putUint32(data + 40, checksum(data, 40));
+
+	std::string temporary = path + ".tmp";
+	FILE* file = fopen(temporary.c_str(), "wb");
+	if (!file) {
+		return false;
+	}
+	bool written = fwrite(data, 1, CALIBRATION_FILE_SIZE, file) == CALIBRATION_FILE_SIZE;
+	written = fclose(file) == 0 && written;
+
+	// the old profile stays whole until the new one replaces it; rename does
+	// not replace an existing file on Windows, MoveFileEx does
+#ifdef _WIN32
+	written = written && MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	written = written && rename(temporary.c_str(), path.c_str()) == 0;
+#endif
+	if (!written) {
+		remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+
+#define CALIBRATION_DEFAULT_PROFILE "default"
+#define CALIBRATION_PRIOR_MIN_FREQ 100 // Hz, pitch range of a player never heard before
+#define CALIBRATION_PRIOR_MAX_FREQ 400
+
+// What the analysis learnt of a player: the pitch range the control is
+// mapped from and the input peak the gate is relative to. Carried over
+// sessions, so the control is usable from the first voiced block.
+struct t_calibration {
+	double minFreqLog;
+	double maxFreqLog;
+	double maxSignal;
+	double voicedSeconds;	// of singing behind it, 0 for the prior
+};
+
+// A range around the usual voices, for a player without a profile
+t_calibration priorCalibration();
+
+// One profile per file, 44 bytes: "TCAL", version, the four fields as
+// little endian doubles and a checksum. Free of openFrameworks.
+// A missing, foreign or damaged file reads as false and leaves calibration
+// alone. Writing goes through a temporary file, a crash never leaves a half
+// written profile.
+bool readCalibration(const std::string& path, t_calibration& calibration);
+bool writeCalibration(const std::string& path, const t_calibration& calibration);
@@ -0,0 +1,56 @@
+#include "calibrationLoader.h"
+#include "atomicOps.h"
+#include "allocCounter.h"
+
+//--------------------------------------------------------------
+calibrationLoader::calibrationLoader() {
+	loaded = priorCalibration();
+	requested = 0;
+	loads = 0;
+	taken = 0;
+}
+
+//--------------------------------------------------------------
+uint32_t calibrationLoader::load(const std::string& path) {
+	// a read still running is a few bytes from done, loads finish in order
+	waitForThread(false);
+
+	this->path = path;
+	startThread(true, false);
+	return ++requested;
+}
+
+//--------------------------------------------------------------
+void calibrationLoader::threadedFunction() {
+	ALLOC_THREAD_NAME("calibration");
+
+	t_calibration calibration = priorCalibration();
+	if (readCalibration(path, calibration)) {
+		ofLogNotice() << "calibration from " << path << ", " << calibration.voicedSeconds << " s voiced";
+	}
+	else {
+		ofLogNotice() << "no calibration at " << path << ", starting from the prior";
+	}
+
+	lock();
+	loaded = calibration;
+	unlock();
+
+	fetchAdd(&loads, 1);
+	ALLOC_THREAD_EXIT();
+}
+
+//--------------------------------------------------------------
+bool calibrationLoader::take(t_calibration& calibration) {
+	uint32_t finished = loadAcquire(&loads);
+	if (finished == taken) {
+		return false;
+	}
+
+	lock();
+	calibration = loaded;
+	unlock();
+
+	taken = finished;
+	return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ofMain.h"
+#include "calibration.h"
+
+#include <stdint.h>
+
+// Reads calibration profiles off the main and audio threads.
+//
+// load() starts a read on the loader thread, the audio thread picks the
+// result up with take() at its next hop. A profile that is missing or does
+// not read gives priorCalibration(), so a new player does not inherit the
+// range of the previous one.
+class calibrationLoader : public ofThread {
+
+	public:
+		calibrationLoader();
+
+		// from the main thread, returns the number of this load (1, 2, ...)
+		uint32_t load(const std::string& path);
+
+		// from the audio thread : true once per finished load
+		bool take(t_calibration& calibration);
+		// number of the load take() last returned, 0 before the first
+		uint32_t getTaken() const { return taken; }
+
+	private:
+		void threadedFunction();
+
+		std::string path;
+		uint32_t requested;		// main thread
+		t_calibration loaded;	// guarded by lock()
+		uint32_t loads;			// finished, release ordered after loaded
+		uint32_t taken;			// audio thread
+};
@@ -0,0 +1,369 @@
+#include "controlStream.h"
+#include "atomicOps.h"
+
+#include <cstring>
+#include <cstddef>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+#endif
+
+#define CONTROL_STREAM_MAGIC 0x4f4e5254 // "TRNO"
+#define CONTROL_STREAM_VERSION 1
+#define CONTROL_STREAM_READ_RETRIES 64
+
+// Layout of the shared memory: the header, then capacity slots.
+// Slots are a cache line each, so readers of one slot do not slow down the
+// publisher writing the next.
+struct t_controlStreamHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t recordSize;
+	uint32_t capacity;		// a power of 2
+	uint32_t session;		// changes every time a publisher opens the stream
+	uint32_t head;			// records published in this session
+	uint32_t padding[10];
+};
+
+struct t_controlSlot {
+	uint32_t sequence;		// odd while the publisher writes the record
+	uint32_t padding;
+	t_controlRecord record;
+	uint8_t cacheLine[64 - 8 - sizeof(t_controlRecord)];
+};
+
+//--------------------------------------------------------------
+// Named shared memory
+struct sharedMapping {
+#ifdef _WIN32
+	HANDLE handle;
+#else
+	int fd;
+#endif
+	void* data;
+	size_t size;
+};
+
+static size_t streamSize(uint32_t capacity) {
+	return sizeof(t_controlStreamHeader) + capacity * sizeof(t_controlSlot);
+}
+
+// size 0 opens an existing stream with its own size, read-only: only the
+// publisher maps it writable
+static sharedMapping* openMapping(const std::string& name, size_t size) {
+	sharedMapping* mapping = new sharedMapping();
+
+#ifdef _WIN32
+	std::string path = "Local\\" + name;
+	if (size) {
+		mapping->handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+			0, (DWORD)size, path.c_str());
+	}
+	else {
+		mapping->handle = OpenFileMappingA(FILE_MAP_READ, FALSE, path.c_str());
+	}
+	if (!mapping->handle) {
+		delete mapping;
+		return NULL;
+	}
+
+	mapping->data = MapViewOfFile(mapping->handle, size ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, size);
+	MEMORY_BASIC_INFORMATION info;
+	if (!mapping->data || !VirtualQuery(mapping->data, &info, sizeof(info))) {
+		if (mapping->data) UnmapViewOfFile(mapping->data);
+		CloseHandle(mapping->handle);
+		delete mapping;
+		return NULL;
+	}
+	mapping->size = size ? size : info.RegionSize;
+#else
+	std::string path = "/" + name;
+	mapping->fd = shm_open(path.c_str(), size ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+	if (mapping->fd < 0) {
+		delete mapping;
+		return NULL;
+	}
+
+	// grown, never shrunk: readers still mapping the old size would fault past
+	// the new end
+	struct stat info;
+	if (fstat(mapping->fd, &info) != 0
+		|| (size && (size_t)info.st_size < size && ftruncate(mapping->fd, size) != 0)) {
+		::close(mapping->fd);
+		delete mapping;
+		return NULL;
+	}
+	mapping->size = (size_t)info.st_size > size ? info.st_size : size;
+
+	int protection = size ? PROT_READ | PROT_WRITE : PROT_READ;
+	mapping->data = mapping->size ? mmap(NULL, mapping->size, protection, MAP_SHARED, mapping->fd, 0) : MAP_FAILED;
+	if (mapping->data == MAP_FAILED) {
+		::close(mapping->fd);
+		delete mapping;
+		return NULL;
+	}
+#endif
+
+	return mapping;
+}
+
+static void closeMapping(sharedMapping* mapping) {
+	if (!mapping) {
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(mapping->data);
+	CloseHandle(mapping->handle);
+#else
+	// the stream stays in /dev/shm for the readers, the next publisher takes it over
+	munmap(mapping->data, mapping->size);
+	::close(mapping->fd);
+#endif
+	delete mapping;
+}
+
+//--------------------------------------------------------------
+uint64_t controlStreamTime() {
+#ifdef _WIN32
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (uint64_t)(counter.QuadPart / frequency.QuadPart * 1000000
+		+ counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart);
+#elif defined(__APPLE__)
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom == 0) {
+		mach_timebase_info(&timebase);
+	}
+	return mach_absolute_time() * timebase.numer / timebase.denom / 1000;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#endif
+}
+
+//--------------------------------------------------------------
+controlPublisher::controlPublisher() {
+	mapping = NULL;
+	header = NULL;
+	slots = NULL;
+	next = 0;
+}
+
+//--------------------------------------------------------------
+controlPublisher::~controlPublisher() {
+	close();
+}
+
+//--------------------------------------------------------------
+bool controlPublisher::open(const std::string& name, int capacity) {
+	close();
+
+	uint32_t slotCount = 1;
+	while ((int)slotCount < capacity) {
+		slotCount <<= 1;
+	}
+
+	sharedMapping* shared = openMapping(name, streamSize(slotCount));
+	if (!shared) {
+		return false;
+	}
+	mapping = shared;
+	header = (t_controlStreamHeader*)shared->data;
+	slots = (t_controlSlot*)(header + 1);
+
+	// a new session : readers resync when they see it change
+	uint32_t session = header->magic == CONTROL_STREAM_MAGIC ? header->session + 1 : 1;
+	header->head = 0;
+	for (uint32_t i = 0; i < slotCount; i++) {
+		slots[i].sequence = 0;
+	}
+	header->magic = CONTROL_STREAM_MAGIC;
+	header->version = CONTROL_STREAM_VERSION;
+	header->recordSize = sizeof(t_controlRecord);
+	header->capacity = slotCount;
+	fenceRelease();
+	storeRelease(&header->session, session);
+
+	next = 0;
+	return true;
+}
+
+//--------------------------------------------------------------
+void controlPublisher::close() {
+	closeMapping((sharedMapping*)mapping);
+	mapping = NULL;
+	header = NULL;
+	slots = NULL;
+}
+
+//--------------------------------------------------------------
+void controlPublisher::publish(const t_controlRecord& record) {
+	if (!header) {
+		return;
+	}
+
+	t_controlSlot* slot = &slots[next & (header->capacity - 1)];
+	uint32_t sequence = slot->sequence;
+
+	storeRelease(&slot->sequence, sequence + 1);
+	fenceRelease();
+
+	slot->record = record;
+	slot->record.index = next;
+	slot->record.timeMicros = controlStreamTime();
+
+	storeRelease(&slot->sequence, sequence + 2);
+
+	next++;
+	storeRelease(&header->head, next);
+}
+
+//--------------------------------------------------------------
+controlReader::controlReader() {
+	mapping = NULL;
+	header = NULL;
+	slots = NULL;
+	session = 0;
+	cursor = 0;
+	lost = 0;
+}
+
+//--------------------------------------------------------------
+controlReader::~controlReader() {
+	close();
+}
+
+//--------------------------------------------------------------
+bool controlReader::open(const std::string& name) {
+	close();
+
+	sharedMapping* shared = openMapping(name, 0);
+	if (!shared) {
+		return false;
+	}
+
+	t_controlStreamHeader* h = (t_controlStreamHeader*)shared->data;
+	if (shared->size < sizeof(t_controlStreamHeader)
+		|| loadAcquire(&h->session) == 0
+		|| h->magic != CONTROL_STREAM_MAGIC || h->version != CONTROL_STREAM_VERSION
+		|| h->recordSize != sizeof(t_controlRecord)
+		|| shared->size < streamSize(h->capacity)) {
+		closeMapping(shared);
+		return false;
+	}
+
+	mapping = shared;
+	header = h;
+	slots = (t_controlSlot*)(header + 1);
+	session = 0;
+	lost = 0;
+	return sync();
+}
+
+//--------------------------------------------------------------
+void controlReader::close() {
+	closeMapping((sharedMapping*)mapping);
+	mapping = NULL;
+	header = NULL;
+	slots = NULL;
+}
+
+//--------------------------------------------------------------
+// Follows a publisher restart: from then on, only the new session is read
+bool controlReader::sync() {
+	uint32_t current = loadAcquire(&header->session);
+	if (current == session) {
+		return true;
+	}
+
+	if (streamSize(header->capacity) > ((sharedMapping*)mapping)->size) {
+		// a publisher with a bigger ring took over, this mapping is too small
+		return false;
+	}
+
+	session = current;
+	cursor = loadAcquire(&header->head);
+	return true;
+}
+
+//--------------------------------------------------------------
+bool controlReader::readSlot(uint32_t index, t_controlRecord& record) {
+	const t_controlSlot* slot = &slots[index & (header->capacity - 1)];
+
+	for (int retry = 0; retry < CONTROL_STREAM_READ_RETRIES; retry++) {
+		uint32_t before = loadAcquire(&slot->sequence);
+		if (before & 1) {
+			continue;
+		}
+
+		record = slot->record;
+
+		fenceAcquire();
+		if (loadAcquire(&slot->sequence) == before) {
+			return true;
+		}
+	}
+	return false;
+}
+
+//--------------------------------------------------------------
+bool controlReader::read(t_controlRecord& record) {
+	if (!header || !sync()) {
+		return false;
+	}
+
+	while (true) {
+		uint32_t head = loadAcquire(&header->head);
+		int32_t available = (int32_t)(head - cursor);
+		if (available <= 0) {
+			return false;
+		}
+
+		// fell behind : skip what the publisher already overwrote
+		if ((uint32_t)available > header->capacity) {
+			lost += available - header->capacity;
+			cursor = head - header->capacity;
+		}
+
+		if (!readSlot(cursor, record)) {
+			return false;
+		}
+
+		if (record.index == cursor) {
+			cursor++;
+			return true;
+		}
+
+		// overwritten between reading head and the slot
+		lost++;
+		cursor++;
+	}
+}
+
+//--------------------------------------------------------------
+bool controlReader::latest(t_controlRecord& record) {
+	if (!header || !sync()) {
+		return false;
+	}
+
+	uint32_t head = loadAcquire(&header->head);
+	if (head == 0 || !readSlot(head - 1, record) || record.index != head - 1) {
+		return false;
+	}
+
+	if ((int32_t)(head - cursor) > 0) {
+		cursor = head;
+	}
+	return true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+// Live pitch and control stream for other local processes.
+//
+// The publisher writes one record per audio block into a ring in shared
+// memory (/dev/shm/tripno-control on Linux, a named mapping on Windows).
+// Every slot is guarded by its own sequence lock: the publisher never waits,
+// readers copy the record out and retry if it changed under them. Any number
+// of readers follow the stream with their own cursor, a reader that falls
+// more than the ring behind skips the lost records and counts them.
+//
+// Readers only need this header and controlStream.cpp, no openFrameworks.
+
+#define CONTROL_STREAM_NAME "tripno-control"
+#define CONTROL_STREAM_CAPACITY 256 // records, ~6 s of 1024 sample hops
+
+struct t_controlRecord {
+	uint32_t index;			// block number since the publisher started
+	uint32_t reserved;
+	uint64_t timeMicros;	// controlStreamTime() at publish
+	double freq;			// Hz, 0 when no pitch
+	double freqLog;
+	float control;
+	float peak;
+};
+
+// monotonic clock shared by all processes of the machine, in microseconds
+uint64_t controlStreamTime();
+
+struct t_controlStreamHeader;
+struct t_controlSlot;
+
+class controlPublisher {
+
+	public:
+		controlPublisher();
+		~controlPublisher();
+
+		// creates (or takes over) the stream, capacity is rounded up to a power of 2
+		bool open(const std::string& name = CONTROL_STREAM_NAME, int capacity = CONTROL_STREAM_CAPACITY);
+		void close();
+		bool isOpen() const { return header != NULL; }
+
+		// wait-free, the record index and time are filled in here
+		void publish(const t_controlRecord& record);
+
+	private:
+		void* mapping;
+		t_controlStreamHeader* header;
+		t_controlSlot* slots;
+		uint32_t next;
+};
+
+class controlReader {
+
+	public:
+		controlReader();
+		~controlReader();
+
+		// fails until a publisher has created the stream
+		bool open(const std::string& name = CONTROL_STREAM_NAME);
+		void close();
+		bool isOpen() const { return header != NULL; }
+
+		// next record after the last one read, false when there is no new one
+		bool read(t_controlRecord& record);
+		// skips to the most recent record
+		bool latest(t_controlRecord& record);
+
+		// records overwritten before this reader got to them
+		unsigned long long getLost() const { return lost; }
+
+	private:
+		bool readSlot(uint32_t index, t_controlRecord& record);
+		bool sync();
+
+		void* mapping;
+		t_controlStreamHeader* header;
+		t_controlSlot* slots;
+		uint32_t session;
+		uint32_t cursor;
+		unsigned long long lost;
+};
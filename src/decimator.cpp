@@ -0,0 +1,189 @@
+#include "decimator.h"
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DECIMATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+//--------------------------------------------------------------
+// One filter output: dot product of the reversed taps with the input run
+static double filterOutput(const double* a, const double* b, int count) {
+	int i = 0;
+	double sum = 0;
+
+#ifdef DECIMATOR_SSE2
+	__m128d acc0 = _mm_setzero_pd();
+	__m128d acc1 = _mm_setzero_pd();
+	for (; i + 4 <= count; i += 4) {
+		acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+		acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+	}
+	double lanes[2];
+	_mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+	sum = lanes[0] + lanes[1];
+#endif
+
+	for (; i < count; i++) {
+		sum += a[i] * b[i];
+	}
+	return sum;
+}
+
+static float filterOutput(const float* a, const float* b, int count) {
+	int i = 0;
+	float sum = 0;
+
+#ifdef DECIMATOR_SSE2
+	__m128 acc0 = _mm_setzero_ps();
+	__m128 acc1 = _mm_setzero_ps();
+	for (; i + 8 <= count; i += 8) {
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+		acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+	}
+	float lanes[4];
+	_mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+	sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+
+	for (; i < count; i++) {
+		sum += a[i] * b[i];
+	}
+	return sum;
+}
+
+static int16_t filterOutput(const int16_t* a, const int16_t* b, int count) {
+	int i = 0;
+	int32_t sum = 0;
+
+#ifdef DECIMATOR_SSE2
+	__m128i acc = _mm_setzero_si128();
+	for (; i + 8 <= count; i += 8) {
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(a + i)),
+			_mm_loadu_si128((const __m128i*)(b + i))));
+	}
+	int32_t lanes[4];
+	_mm_storeu_si128((__m128i*)lanes, acc);
+	sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+	for (; i < count; i++) {
+		sum += (int32_t)a[i] * b[i];
+	}
+
+	// Q15 back to samples, rounded and saturated
+	sum = (sum + (1 << 14)) >> 15;
+	return (int16_t)(sum > 32767 ? 32767 : sum < -32768 ? -32768 : sum);
+}
+
+//--------------------------------------------------------------
+// Taps in the sample type
+static void quantizeTaps(const std::vector<double>& taps, std::vector<double>& out) {
+	out = taps;
+}
+
+static void quantizeTaps(const std::vector<double>& taps, std::vector<float>& out) {
+	out.assign(taps.begin(), taps.end());
+}
+
+static void quantizeTaps(const std::vector<double>& taps, std::vector<int16_t>& out) {
+	out.resize(taps.size());
+	int sum = 0;
+	for (size_t i = 0; i < taps.size(); i++) {
+		out[i] = (int16_t)floor(taps[i] * 32768 + 0.5);
+		sum += out[i];
+	}
+	// rounding leftover goes to the center tap, for an exact unity DC gain
+	out[out.size() / 2] += 32768 - sum;
+}
+
+//--------------------------------------------------------------
+template<typename T>
+polyphaseDecimator<T>::polyphaseDecimator() {
+	setup(1);
+}
+
+//--------------------------------------------------------------
+template<typename T>
+void polyphaseDecimator<T>::setup(int factor, int taps) {
+	this->factor = factor < 1 ? 1 : factor;
+	reversedTaps.clear();
+
+	if (this->factor > 1) {
+		int count = taps > 0 ? taps : 24 * this->factor;
+
+		// Blackman-windowed sinc, cutoff at 0.8 of the output Nyquist.
+		// The transition band (~5.5 / count of the input rate) then ends
+		// right at the output Nyquist.
+		double cutoff = 0.8 * 0.5 / this->factor;
+		double gain = 0;
+		std::vector<double> design(count);
+		for (int i = 0; i < count; i++) {
+			double t = i - (count - 1) / 2.0;
+			double sinc = t == 0 ? 2 * cutoff : sin(2 * M_PI * cutoff * t) / (M_PI * t);
+			double window = 0.42 - 0.5 * cos(2 * M_PI * i / (count - 1))
+				+ 0.08 * cos(4 * M_PI * i / (count - 1));
+			design[count - 1 - i] = sinc * window;
+			gain += sinc * window;
+		}
+		// unity gain at DC
+		for (int i = 0; i < count; i++) {
+			design[i] /= gain;
+		}
+		quantizeTaps(design, reversedTaps);
+	}
+
+	reset();
+}
+
+//--------------------------------------------------------------
+template<typename T>
+void polyphaseDecimator<T>::reset() {
+	// Start from silence so the first block is already filtered
+	history.assign(reversedTaps.empty() ? 0 : reversedTaps.size() - 1, T(0));
+	position = 0;
+}
+
+//--------------------------------------------------------------
+template<typename T>
+int polyphaseDecimator<T>::process(const T* in, int count, T* out, float* outFloat) {
+
+	if (factor == 1) {
+		for (int i = 0; i < count; i++) {
+			out[i] = in[i];
+			if (outFloat) {
+				outFloat[i] = sampleTraits<T>::toFloat(in[i]);
+			}
+		}
+		return count;
+	}
+
+	history.insert(history.end(), in, in + count);
+
+	const size_t taps = reversedTaps.size();
+	int written = 0;
+	for (; position + taps <= history.size(); position += factor) {
+		T y = filterOutput(&reversedTaps[0], &history[position], taps);
+		out[written] = y;
+		if (outFloat) {
+			outFloat[written] = sampleTraits<T>::toFloat(y);
+		}
+		written++;
+	}
+
+	// keep the unconsumed tail as filter state for the next block
+	history.erase(history.begin(), history.begin() + position);
+	position = 0;
+
+	return written;
+}
+
+template class polyphaseDecimator<double>;
+template class polyphaseDecimator<float>;
+template class polyphaseDecimator<int16_t>;
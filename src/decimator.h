@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "sampleTypes.h"
+
+// Streaming decimator with a windowed-sinc anti-alias FIR.
+//
+// The filter is evaluated only at output instants, i.e. the polyphase form
+// of the decimating FIR: each output is one dot product of the reversed
+// taps with a contiguous run of input, so no sample that is later thrown
+// away is ever computed. Filter state carries over between blocks.
+//
+// With the default design the response is flat (-0.1 dB) up to ~0.32 of the
+// output rate (3.5 kHz for 44100 / 4), which keeps the voice band below
+// MAX_VOICE_FREQ intact, and is below -60 dB past the output Nyquist.
+//
+// Instantiated for double, float and int16_t. The int16_t filter has Q15
+// taps and accumulates in 32 bits: the taps' absolute sum stays below 2, so
+// a full scale input cannot overflow the accumulator.
+template<typename T>
+class polyphaseDecimator {
+
+	public:
+		polyphaseDecimator();
+
+		// factor : decimation ratio, 1 disables the filter
+		// taps   : FIR length, 0 picks 24 taps per unit of factor
+		void setup(int factor, int taps = 0);
+		void reset();
+
+		int getFactor() const { return factor; }
+
+		// Consumes count input samples, writes up to count / factor + 1
+		// outputs to out (and the same values as float to outFloat if not
+		// NULL). out may alias in. Returns the number of outputs written.
+		int process(const T* in, int count, T* out, float* outFloat = NULL);
+
+	private:
+		int factor;
+		std::vector<T> reversedTaps;
+		std::vector<T> history;
+		size_t position;
+};
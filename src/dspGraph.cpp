@@ -0,0 +1,118 @@
+#include "dspGraph.h"
+
+#include <sstream>
+
+struct t_stageInfo {
+	const char* name;
+	dspStage input;
+	bool passThrough;	// can be left out, its readers then get its input
+};
+
+static const t_stageInfo stageInfo[STAGE_COUNT] = {
+	{ "gate", STAGE_INPUT, false },
+	{ "fft", STAGE_GATE, false },
+	{ "spectralGate", STAGE_FFT, true },
+	{ "pitch", STAGE_GATE, false },
+	{ "range", STAGE_PITCH, false },
+	{ "smoother", STAGE_RANGE, true },
+};
+
+struct t_consumerInfo {
+	const char* name;
+	dspStage input;
+};
+
+static const t_consumerInfo consumerInfo[CONSUMER_COUNT] = {
+	{ "game", STAGE_SMOOTHER },
+	{ "stream", STAGE_SMOOTHER },
+	{ "controlPlot", STAGE_SMOOTHER },
+	{ "spectrumPlot", STAGE_SPECTRAL_GATE },
+	{ "recorder", STAGE_INPUT },
+	{ "shadow", STAGE_SMOOTHER },
+};
+
+//--------------------------------------------------------------
+dspGraph::dspGraph() {
+	std::string errors;
+	setup("", "", errors);
+}
+
+//--------------------------------------------------------------
+bool dspGraph::setup(const std::string& stages, const std::string& consumers, std::string& errors) {
+	std::ostringstream report;
+	std::string name;
+
+	declared = 0;
+	std::istringstream stageList(stages.empty() ? DSP_DEFAULT_STAGES : stages);
+	while (stageList >> name) {
+		int i = 0;
+		while (i < STAGE_COUNT && name != stageInfo[i].name) {
+			i++;
+		}
+		if (i == STAGE_COUNT) {
+			report << "unknown stage " << name << ". ";
+			continue;
+		}
+		declared |= 1 << i;
+	}
+
+	enabled = 0;
+	std::istringstream consumerList(consumers.empty() ? DSP_DEFAULT_CONSUMERS : consumers);
+	while (consumerList >> name) {
+		int i = 0;
+		while (i < CONSUMER_COUNT && name != consumerInfo[i].name) {
+			i++;
+		}
+		if (i == CONSUMER_COUNT) {
+			report << "unknown consumer " << name << ". ";
+			continue;
+		}
+		enabled |= 1 << i;
+	}
+
+	// walk from every consumer back to the input
+	needed = 0;
+	for (int i = 0; i < CONSUMER_COUNT; i++) {
+		if (!has((dspConsumer)i)) {
+			continue;
+		}
+
+		unsigned path = 0;
+		dspStage stage = consumerInfo[i].input;
+		while (stage != STAGE_INPUT) {
+			if (declared & (1 << stage)) {
+				path |= 1 << stage;
+			}
+			else if (!stageInfo[stage].passThrough) {
+				report << consumerInfo[i].name << " disabled, it needs " << stageInfo[stage].name << ". ";
+				enabled &= ~(1 << i);
+				path = 0;
+				break;
+			}
+			stage = stageInfo[stage].input;
+		}
+		needed |= path;
+	}
+
+	errors = report.str();
+	return errors.empty();
+}
+
+//--------------------------------------------------------------
+std::string dspGraph::describe() const {
+	std::string text;
+	for (int i = 0; i < STAGE_COUNT; i++) {
+		if (needs((dspStage)i)) {
+			text += text.empty() ? "" : " ";
+			text += stageInfo[i].name;
+		}
+	}
+	text += text.empty() ? "input ->" : " ->";
+	for (int i = 0; i < CONSUMER_COUNT; i++) {
+		if (has((dspConsumer)i)) {
+			text += " ";
+			text += consumerInfo[i].name;
+		}
+	}
+	return text;
+}
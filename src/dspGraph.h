@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+
+// Stages of the audioIn pipeline and who reads them, as declared in
+// config.xml:
+//
+//   <stages>gate fft spectralGate pitch range smoother</stages>
+//   <consumers>game stream controlPlot recorder</consumers>
+//
+// Every stage reads one other stage (or the raw input), the consumers read
+// the end of a branch:
+//
+//   input - gate - fft - spectralGate        spectrumPlot
+//                \- pitch - range - smoother  game, stream, controlPlot
+//   input                                     recorder
+//   input, smoother                           shadow
+//
+// Only stages some enabled consumer depends on are evaluated. A stage left
+// out of <stages> is passed through when it only refines its input
+// (spectralGate, smoother); the consumers of any other missing stage are
+// disabled.
+
+#define DSP_DEFAULT_STAGES "gate fft spectralGate pitch range smoother"
+#define DSP_DEFAULT_CONSUMERS "game stream controlPlot recorder"
+
+enum dspStage {
+	STAGE_GATE,				// left channel, gated and decimated
+	STAGE_FFT,				// amplitude spectrum of the analysis window
+	STAGE_SPECTRAL_GATE,	// voice band, squared above the average
+	STAGE_PITCH,			// wavelet pitch of the window
+	STAGE_RANGE,			// pitch offset from the middle of the tracked range
+	STAGE_SMOOTHER,			// averaged with the previous control
+	STAGE_COUNT,
+	STAGE_INPUT = STAGE_COUNT
+};
+
+enum dspConsumer {
+	CONSUMER_GAME,			// control force of the simulation
+	CONSUMER_STREAM,		// shared memory control stream
+	CONSUMER_CONTROL_PLOT,	// pitch and control lines
+	CONSUMER_SPECTRUM_PLOT,	// spectrogram
+	CONSUMER_RECORDER,		// raw input capture
+	CONSUMER_SHADOW,		// candidate analyzers compared to this one
+	CONSUMER_COUNT
+};
+
+class dspGraph {
+
+	public:
+		// everything declared, the default consumers
+		dspGraph();
+
+		// space separated names, empty for the defaults. Unknown names and
+		// consumers that cannot be fed are described in errors.
+		bool setup(const std::string& stages, const std::string& consumers, std::string& errors);
+
+		bool needs(dspStage stage) const { return (needed >> stage) & 1; }
+		bool has(dspConsumer consumer) const { return (enabled >> consumer) & 1; }
+
+		// the evaluated stages, for the log
+		std::string describe() const;
+
+	private:
+		unsigned declared;
+		unsigned enabled;
+		unsigned needed;
+};
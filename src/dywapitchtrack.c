@@ -102,240 +102,204 @@ typedef struct _minmax {
 	struct _minmax *next;
 } minmax;
 
-double _dywapitch_computeWaveletPitch(double * samples, int startsample, int samplecount) {
-	double pitchF = 0.0;
-	
-	int i, j;
-	double si, si1;
-	
-	// must be a power of 2
-	samplecount = _floor_power2(samplecount);
-	
-	double *sam = (double *)malloc(sizeof(double)*samplecount);
-	memcpy(sam, samples + startsample, sizeof(double)*samplecount);
-	int curSamNb = samplecount;
-	
-	int *distances = (int *)malloc(sizeof(int)*samplecount);
-	int *mins = (int *)malloc(sizeof(int)*samplecount);
-	int *maxs = (int *)malloc(sizeof(int)*samplecount);
-	int nbMins, nbMaxs;
-	
-	// algorithm parameters
+// algorithm parameters
+#define DYWA_MAXF 3000.
+#define DYWA_DIFFERENCELEVELSN 3
+#define DYWA_MAXIMATHRESHOLDRATIO 0.75
+
+// the DC is summed in chunks of this many samples, so that a sliding window
+// can keep per-chunk sums and still get the very same value
+#define DYWA_CHUNK 32
+
+// extremum candidate types
+#define DYWA_MIN 1
+#define DYWA_MAX 2
+
+// an extremum candidate : sample i where the slope changes sign.
+// prev is the extremum itself (sample i-1), value is sample i.
+// Candidates only depend on the samples, not on the DC nor the threshold,
+// so they can be kept from one window to the next.
+// (one struct per sample type, in dywapitchtrack_template.h)
+
+// number of wavelet levels for the given samplerate
+int _dywapitch_levelcount(double sampleRate) {
 	int maxFLWTlevels = 6;
-	double maxF = 3000.;
-	int differenceLevelsN = 3;
-	double maximaThresholdRatio = 0.75;
-	
-	double ampltitudeThreshold;  
-	double theDC = 0.0;
-	
-	{ // compute ampltitudeThreshold and theDC
-		//first compute the DC and maxAMplitude
-		double maxValue = 0.0;
-		double minValue = 0.0;
-		for (i = 0; i < samplecount;i++) {
-			si = sam[i];
-			theDC = theDC + si;
-			if (si > maxValue) maxValue = si;
-			if (si < minValue) minValue = si;
-		}
-		theDC = theDC/samplecount;
-		maxValue = maxValue - theDC;
-		minValue = minValue - theDC;
-		double amplitudeMax = (maxValue > -minValue ? maxValue : -minValue);
-		
-		ampltitudeThreshold = amplitudeMax*maximaThresholdRatio;
-		//asLog("dywapitch theDC=%f ampltitudeThreshold=%f\n", theDC, ampltitudeThreshold);
-		
+
+	// data below 44100 Hz is already downsampled : drop the levels it skipped
+	double levelRate = 44100.;
+	while (maxFLWTlevels > 1 && levelRate/2 >= sampleRate) {
+		levelRate /= 2;
+		maxFLWTlevels--;
 	}
-	
-	// levels, start without downsampling..
-	int curLevel = 0;
-	double curModeDistance = -1.;
-	int delta;
-	
-	while(1) {
-		
-		// delta
-		delta = 44100./(_2power(curLevel)*maxF);
-		//("dywapitch doing level=%ld delta=%ld\n", curLevel, delta);
-		
-		if (curSamNb < 2) goto cleanup;
-		
-		// compute the first maximums and minumums after zero-crossing
-		// store if greater than the min threshold
-		// and if at a greater distance than delta
-		double dv, previousDV = -1000;
-		nbMins = nbMaxs = 0;   
-		int lastMinIndex = -1000000;
-		int lastmaxIndex = -1000000;
-		int findMax = 0;
-		int findMin = 0;
-		for (i = 2; i < curSamNb; i++) {
-			si = sam[i] - theDC;
-			si1 = sam[i-1] - theDC;
-			
-			if (si1 <= 0 && si > 0) findMax = 1;
-			if (si1 >= 0 && si < 0) findMin = 1;
-			
-			// min or max ?
-			dv = si - si1;
-			
-			if (previousDV > -1000) {
-				
-				if (findMin && previousDV < 0 && dv >= 0) { 
-					// minimum
-					if (fabs(si) >= ampltitudeThreshold) {
-						if (i > lastMinIndex + delta) {
-							mins[nbMins++] = i;
-							lastMinIndex = i;
-							findMin = 0;
-							//if DEBUGG then put "min ok"&&si
-							//
-						} else {
-							//if DEBUGG then put "min too close to previous"&&(i - lastMinIndex)
-							//
-						}
-					} else {
-						// if DEBUGG then put "min "&abs(si)&" < thresh = "&ampltitudeThreshold
-						//--
-					}
-				}
-				
-				if (findMax && previousDV > 0 && dv <= 0) {
-					// maximum
-					if (fabs(si) >= ampltitudeThreshold) {
-						if (i > lastmaxIndex + delta) {
-							maxs[nbMaxs++] = i;
-							lastmaxIndex = i;
-							findMax = 0;
-						} else {
-							//if DEBUGG then put "max too close to previous"&&(i - lastmaxIndex)
-							//--
-						}
-					} else {
-						//if DEBUGG then put "max "&abs(si)&" < thresh = "&ampltitudeThreshold
-						//--
-					}
-				}
-			}
-			
-			previousDV = dv;
-		}
-		
-		if (nbMins == 0 && nbMaxs == 0) {
-			// no best distance !
-			//asLog("dywapitch no mins nor maxs, exiting\n");
-			
-			// if DEBUGG then put "no mins nor maxs, exiting"
-			goto cleanup;
-		}
-		//if DEBUGG then put count(maxs)&&"maxs &"&&count(mins)&&"mins"
-		
-		// maxs = [5, 20, 100,...]
-		// compute distances
-		int d;
-		memset(distances, 0, samplecount*sizeof(int));
-		for (i = 0 ; i < nbMins ; i++) {
-			for (j = 1; j < differenceLevelsN; j++) {
-				if (i+j < nbMins) {
-					d = _iabs(mins[i] - mins[i+j]);
-					//asLog("dywapitch i=%ld j=%ld d=%ld\n", i, j, d);
-					distances[d] = distances[d] + 1;
-				}
+	return maxFLWTlevels;
+}
+
+// extremum candidate type at sample i, given the slopes into samples i-1
+// and i. The slope is taken on the raw samples : the DC cancels out
+int _dywapitch_eventtype(double previousDV, double dv) {
+	if (previousDV < 0 && dv >= 0) return DYWA_MIN;
+	if (previousDV > 0 && dv <= 0) return DYWA_MAX;
+	return 0;
+}
+
+// amplitude threshold from the DC and the extreme values of the window
+double _dywapitch_amplitudethreshold(double theDC, double maxValue, double minValue) {
+	maxValue = maxValue - theDC;
+	minValue = minValue - theDC;
+	double amplitudeMax = (maxValue > -minValue ? maxValue : -minValue);
+
+	return amplitudeMax*DYWA_MAXIMATHRESHOLDRATIO;
+}
+
+// One level of the wavelet algorithm : from the kept minimums and maximums
+// of the level (see _dywapitch_extrema), return the mode of their distances
+// in *distAvg.
+// Returns 0 if no mins nor maxs were found.
+int _dywapitch_modedistance(int * mins, int nbMins, int * maxs, int nbMaxs, int delta,
+							int curSamNb, int samplecount, int * distances, double * distAvgOut) {
+	int i, j;
+
+	if (nbMins == 0 && nbMaxs == 0) {
+		// no best distance !
+		return 0;
+	}
+
+	// maxs = [5, 20, 100,...]
+	// compute distances
+	// (distances is all zeros on entry and is cleared again before returning)
+	int d;
+	for (i = 0 ; i < nbMins ; i++) {
+		for (j = 1; j < DYWA_DIFFERENCELEVELSN; j++) {
+			if (i+j < nbMins) {
+				d = _iabs(mins[i] - mins[i+j]);
+				distances[d] = distances[d] + 1;
 			}
 		}
-		for (i = 0 ; i < nbMaxs ; i++) {
-			for (j = 1; j < differenceLevelsN; j++) {
-				if (i+j < nbMaxs) {
-					d = _iabs(maxs[i] - maxs[i+j]);
-					//asLog("dywapitch i=%ld j=%ld d=%ld\n", i, j, d);
-					distances[d] = distances[d] + 1;
-				}
+	}
+	for (i = 0 ; i < nbMaxs ; i++) {
+		for (j = 1; j < DYWA_DIFFERENCELEVELSN; j++) {
+			if (i+j < nbMaxs) {
+				d = _iabs(maxs[i] - maxs[i+j]);
+				distances[d] = distances[d] + 1;
 			}
 		}
-		
-		// find best summed distance
-		int bestDistance = -1;
-		int bestValue = -1;
-		for (i = 0; i< curSamNb; i++) {
-			int summed = 0;
-			for (j = -delta ; j <= delta ; j++) {
-				if (i+j >=0 && i+j < curSamNb)
-					summed += distances[i+j];
-			}
-			//asLog("dywapitch i=%ld summed=%ld bestDistance=%ld\n", i, summed, bestDistance);
-			if (summed == bestValue) {
-				if (i == 2*bestDistance)
-					bestDistance = i;
-				
-			} else if (summed > bestValue) {
-				bestValue = summed;
+	}
+
+	// find best summed distance
+	// summed is the sum of distances[i-delta..i+delta], kept as a running sum
+	int bestDistance = -1;
+	int bestValue = -1;
+	int summed = 0;
+	for (j = 0; j < delta && j < curSamNb; j++) summed += distances[j];
+	for (i = 0; i< curSamNb; i++) {
+		if (i+delta < curSamNb) summed += distances[i+delta];
+		if (i-delta-1 >= 0) summed -= distances[i-delta-1];
+
+		if (summed == bestValue) {
+			if (i == 2*bestDistance)
 				bestDistance = i;
-			}
-		}
-		//asLog("dywapitch bestDistance=%ld\n", bestDistance);
-		
-		// averaging
-		double distAvg = 0.0;
-		double nbDists = 0;
-		for (j = -delta ; j <= delta ; j++) {
-			if (bestDistance+j >=0 && bestDistance+j < samplecount) {
-				int nbDist = distances[bestDistance+j];
-				if (nbDist > 0) {
-					nbDists += nbDist;
-					distAvg += (bestDistance+j)*nbDist;
-				}
-			}
+
+		} else if (summed > bestValue) {
+			bestValue = summed;
+			bestDistance = i;
 		}
-		// this is our mode distance !
-		distAvg /= nbDists;
-		//asLog("dywapitch distAvg=%f\n", distAvg);
-		
-		// continue the levels ?
-		if (curModeDistance > -1.) {
-			double similarity = fabs(distAvg*2 - curModeDistance);
-			if (similarity <= 2*delta) {
-				//if DEBUGG then put "similarity="&similarity&&"delta="&delta&&"ok"
- 				//asLog("dywapitch similarity=%f OK !\n", similarity);
-				// two consecutive similar mode distances : ok !
-				pitchF = 44100./(_2power(curLevel-1)*curModeDistance);
-				goto cleanup;
+	}
+
+	// averaging
+	double distAvg = 0.0;
+	double nbDists = 0;
+	for (j = -delta ; j <= delta ; j++) {
+		if (bestDistance+j >=0 && bestDistance+j < samplecount) {
+			int nbDist = distances[bestDistance+j];
+			if (nbDist > 0) {
+				nbDists += nbDist;
+				distAvg += (bestDistance+j)*nbDist;
 			}
-			//if DEBUGG then put "similarity="&similarity&&"delta="&delta&&"not"
-		}
-		
-		// not similar, continue next level
-		curModeDistance = distAvg;
-		
-		curLevel = curLevel + 1;
-		if (curLevel >= maxFLWTlevels) {
-			// put "max levels reached, exiting"
- 			//asLog("dywapitch max levels reached, exiting\n");
-			goto cleanup;
 		}
-		
-		// downsample
-		if (curSamNb < 2) {
- 			//asLog("dywapitch not enough samples, exiting\n");
-			goto cleanup;
-		}
-		for (i = 0; i < curSamNb/2; i++) {
-			sam[i] = (sam[2*i] + sam[2*i + 1])/2.;
+	}
+	// this is our mode distance !
+	distAvg /= nbDists;
+	*distAvgOut = distAvg;
+
+	// clear what was counted, for the next level
+	for (i = 0 ; i + 1 < nbMins ; i++) {
+		for (j = 1; j < DYWA_DIFFERENCELEVELSN && i+j < nbMins; j++) distances[_iabs(mins[i] - mins[i+j])] = 0;
+	}
+	for (i = 0 ; i + 1 < nbMaxs ; i++) {
+		for (j = 1; j < DYWA_DIFFERENCELEVELSN && i+j < nbMaxs; j++) distances[_iabs(maxs[i] - maxs[i+j])] = 0;
+	}
+
+	return 1;
+}
+
+// Level to level decision. Returns 1 when the search is over, with the
+// pitch (or 0.0) in *pitchF.
+int _dywapitch_nextlevel(double distAvg, int delta, double sampleRate, int maxFLWTlevels,
+						 int * curLevel, double * curModeDistance, double * pitchF) {
+	// continue the levels ?
+	if (*curModeDistance > -1.) {
+		double similarity = fabs(distAvg*2 - *curModeDistance);
+		if (similarity <= 2*delta) {
+			// two consecutive similar mode distances : ok !
+			*pitchF = sampleRate/(_2power(*curLevel-1)*(*curModeDistance));
+			return 1;
 		}
-		curSamNb /= 2;
 	}
-	
-	///
-cleanup:
-	free(distances);
-	free(mins);
-	free(maxs);
-	free(sam);
-	
-	return pitchF;
+
+	// not similar, continue next level
+	*curModeDistance = distAvg;
+
+	*curLevel = *curLevel + 1;
+	if (*curLevel >= maxFLWTlevels) {
+		// put "max levels reached, exiting"
+		return 1;
+	}
+	return 0;
 }
 
+// ***********************************
+// the sample types
+// ***********************************
+
+/***
+The levels, candidates and DC are computed in the type of the samples :
+double and float as given, 16 bit integer samples as exact integer sums
+(the levels are not averaged, each one is 2x the scale of the previous).
+Everything else works on indexes and distances and is shared.
+
+The sliding window keeps, for every wavelet level, the last samples of the
+level (a ring) and the extremum candidates found in them. Pushing samples
+only computes the new pyramid values and candidates ; dropping the ones that
+left the window is a matter of moving the ring heads.
+The DC and amplitude of the window come from per-chunk sums and extremes.
+As long as the window starts on a chunk boundary, every level of the
+window is exactly the one a from-scratch call would compute.
+***/
+
+#define DYWA_SAMPLE double
+#define DYWA_LEVEL double
+#define DYWA_SUM double
+#define DYWA_FIXED 0
+#define DYWA_PAIR(a, b) (((a) + (b))/2.)
+#define DYWA_NAME(x) x##_d
+#include "dywapitchtrack_template.h"
+
+#define DYWA_SAMPLE float
+#define DYWA_LEVEL float
+#define DYWA_SUM double
+#define DYWA_FIXED 0
+#define DYWA_PAIR(a, b) (((a) + (b))*0.5f)
+#define DYWA_NAME(x) x##_f
+#include "dywapitchtrack_template.h"
+
+#define DYWA_SAMPLE int16_t
+#define DYWA_LEVEL int32_t
+#define DYWA_SUM long long
+#define DYWA_FIXED 1
+#define DYWA_PAIR(a, b) ((a) + (b))
+#define DYWA_NAME(x) x##_s16
+#include "dywapitchtrack_template.h"
+
 // ***********************************
 // the dynamic postprocess
 // ***********************************
@@ -437,12 +401,100 @@ double _dywapitch_dynamicprocess(dywapitchtracker *pitchtracker, double pitch) {
 void dywapitch_inittracking(dywapitchtracker *pitchtracker) {
 	pitchtracker->_prevPitch = -1.;
 	pitchtracker->_pitchConfidence = -1;
+	pitchtracker->_sampleRate = 44100.;
+}
+
+void dywapitch_setsamplerate(dywapitchtracker *pitchtracker, double sampleRate) {
+	pitchtracker->_sampleRate = sampleRate;
 }
 
 double dywapitch_computepitch(dywapitchtracker *pitchtracker, double * samples, int startsample, int samplecount) {
-	double raw_pitch = _dywapitch_computeWaveletPitch(samples, startsample, samplecount);
+	double raw_pitch = _dywapitch_computeWaveletPitch_d(samples, startsample, samplecount, pitchtracker->_sampleRate);
+	return _dywapitch_dynamicprocess(pitchtracker, raw_pitch);
+}
+
+double dywapitch_computepitch_f(dywapitchtracker *pitchtracker, float * samples, int startsample, int samplecount) {
+	double raw_pitch = _dywapitch_computeWaveletPitch_f(samples, startsample, samplecount, pitchtracker->_sampleRate);
+	return _dywapitch_dynamicprocess(pitchtracker, raw_pitch);
+}
+
+double dywapitch_computepitch_s16(dywapitchtracker *pitchtracker, int16_t * samples, int startsample, int samplecount) {
+	double raw_pitch = _dywapitch_computeWaveletPitch_s16(samples, startsample, samplecount, pitchtracker->_sampleRate);
 	return _dywapitch_dynamicprocess(pitchtracker, raw_pitch);
 }
 
+int dywapitch_initwindowtype(dywapitchwindow *window, int windowsize, double sampleRate, int sampletype) {
+	memset(window, 0, sizeof(dywapitchwindow));
+
+	// must be a power of 2, made of whole chunks
+	window->_windowSize = _floor_power2(windowsize);
+	window->_sampleRate = sampleRate;
+	window->_sampleType = sampletype;
+
+	switch (sampletype) {
+		case DYWAPITCH_DOUBLE: return _dywapitch_initwindow_d(window);
+		case DYWAPITCH_FLOAT: return _dywapitch_initwindow_f(window);
+		case DYWAPITCH_INT16: return _dywapitch_initwindow_s16(window);
+	}
+	return 0;
+}
+
+int dywapitch_initwindow(dywapitchwindow *window, int windowsize, double sampleRate) {
+	return dywapitch_initwindowtype(window, windowsize, sampleRate, DYWAPITCH_DOUBLE);
+}
+
+void dywapitch_freewindow(dywapitchwindow *window) {
+	switch (window->_sampleType) {
+		case DYWAPITCH_DOUBLE: _dywapitch_freewindow_d(window); break;
+		case DYWAPITCH_FLOAT: _dywapitch_freewindow_f(window); break;
+		case DYWAPITCH_INT16: _dywapitch_freewindow_s16(window); break;
+	}
+	memset(window, 0, sizeof(dywapitchwindow));
+}
+
+void dywapitch_pushsamples(dywapitchwindow *window, double * samples, int startsample, int samplecount) {
+	if (window->_state && window->_sampleType == DYWAPITCH_DOUBLE) {
+		_dywapitch_pushsamples_d(window, samples, startsample, samplecount);
+	}
+}
+
+void dywapitch_pushsamples_f(dywapitchwindow *window, float * samples, int startsample, int samplecount) {
+	if (window->_state && window->_sampleType == DYWAPITCH_FLOAT) {
+		_dywapitch_pushsamples_f(window, samples, startsample, samplecount);
+	}
+}
+
+void dywapitch_pushsamples_s16(dywapitchwindow *window, int16_t * samples, int startsample, int samplecount) {
+	if (window->_state && window->_sampleType == DYWAPITCH_INT16) {
+		_dywapitch_pushsamples_s16(window, samples, startsample, samplecount);
+	}
+}
 
+double dywapitch_computewindowpitch(dywapitchtracker *pitchtracker, dywapitchwindow *window) {
+	return dywapitch_computerecentpitch(pitchtracker, window, window->_windowSize);
+}
 
+int dywapitch_recentsamplecount(dywapitchwindow *window, int samplecount) {
+	// a power of 2 the levels hold, as for dywapitch_initwindow
+	samplecount = _floor_power2(samplecount);
+	if (samplecount > window->_windowSize) samplecount = window->_windowSize;
+	while (samplecount < window->_windowSize
+		   && (samplecount < 2*DYWA_CHUNK || (samplecount >> (_dywapitch_levelcount(window->_sampleRate) - 1)) < 4)) {
+		samplecount *= 2;
+	}
+	return samplecount;
+}
+
+double dywapitch_computerecentpitch(dywapitchtracker *pitchtracker, dywapitchwindow *window, int samplecount) {
+	double raw_pitch = 0.0;
+	if (window->_state) {
+		samplecount = dywapitch_recentsamplecount(window, samplecount);
+
+		switch (window->_sampleType) {
+			case DYWAPITCH_DOUBLE: raw_pitch = _dywapitch_computeWindowPitch_d(window, samplecount); break;
+			case DYWAPITCH_FLOAT: raw_pitch = _dywapitch_computeWindowPitch_f(window, samplecount); break;
+			case DYWAPITCH_INT16: raw_pitch = _dywapitch_computeWindowPitch_s16(window, samplecount); break;
+		}
+	}
+	return _dywapitch_dynamicprocess(pitchtracker, raw_pitch);
+}
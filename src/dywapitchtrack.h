@@ -57,8 +57,9 @@
  over time and makes assumptions about human voice capabilities and reallife conditions
  (as documented inside the code).
  
- Note : The algorithm currently assumes a 44100Hz audio sampling rate. If you use a different
- samplerate, you can just multiply the resulting pitch by the ratio between your samplerate and 44100.
+ Note : The algorithm assumes a 44100Hz audio sampling rate by default. For other rates (e.g. a
+ decimated analysis buffer), call dywapitch_setsamplerate after dywapitch_inittracking : the peak
+ spacing, the number of wavelet levels and the returned pitch then follow the given rate.
 */
 
 /* Usage
@@ -72,11 +73,26 @@
  // For each available audio buffer, call 'dywapitch_computepitch'
  double thepitch = dywapitch_computepitch(&pitchtracker, samples, start, count);
  
+ // With overlapping windows (a hop smaller than the window), keep a 'dywapitchwindow'
+ // instead : it remembers the wavelet levels and extremum candidates of the window,
+ // so each hop only processes the samples that entered it.
+ dywapitchwindow window;
+ dywapitch_initwindow(&window, 4096, 44100.);
+ 
+ // For each hop
+ dywapitch_pushsamples(&window, samples, start, hopcount);
+ double thepitch = dywapitch_computewindowpitch(&pitchtracker, &window);
+ 
+ // When done
+ dywapitch_freewindow(&window);
+ 
 */
 
 #ifndef dywapitchtrack__H
 #define dywapitchtrack__H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -85,8 +101,24 @@ extern "C" {
 typedef struct _dywapitchtracker {
 	double	_prevPitch;
 	int		_pitchConfidence;
+	double	_sampleRate;
 } dywapitchtracker;
 
+// sample types of a sliding window
+enum {
+	DYWAPITCH_DOUBLE,
+	DYWAPITCH_FLOAT,
+	DYWAPITCH_INT16
+};
+
+// structure to hold a sliding analysis window
+typedef struct _dywapitchwindow {
+	int		_windowSize;
+	double	_sampleRate;
+	int		_sampleType;
+	void	*_state;		// levels, candidates and DC chunks, in the sample type
+} dywapitchwindow;
+
 // returns the number of samples needed to compute pitch for fequencies equal and above the given minFreq (in Hz)
 // useful to allocate large enough audio buffer 
 // ex : for frequencies above 130Hz, you need 1024 samples (assuming a 44100 Hz samplerate)
@@ -95,6 +127,11 @@ int dywapitch_neededsamplecount(int minFreq);
 // call before computing any pitch, passing an allocated dywapitchtracker structure
 void dywapitch_inittracking(dywapitchtracker *pitchtracker);
 
+// sets the samplerate of the buffers passed to dywapitch_computepitch (44100 by default)
+// lower rates skip the wavelet levels that would only halve the rate further,
+// so the coarsest analysis level stays at 44100/32 Hz
+void dywapitch_setsamplerate(dywapitchtracker *pitchtracker, double sampleRate);
+
 // computes the pitch. Pass the inited dywapitchtracker structure
 // samples : a pointer to the sample buffer
 // startsample : the index of teh first sample to use in teh sample buffer
@@ -102,6 +139,43 @@ void dywapitch_inittracking(dywapitchtracker *pitchtracker);
 // return 0.0 if no pitch was found (sound too low, noise, etc..)
 double dywapitch_computepitch(dywapitchtracker *pitchtracker, double * samples, int startsample, int samplecount);
 
+// same on float or 16 bit samples, without converting them : 16 bit samples are
+// tracked with integer arithmetic only, the result is the one of the double version
+double dywapitch_computepitch_f(dywapitchtracker *pitchtracker, float * samples, int startsample, int samplecount);
+double dywapitch_computepitch_s16(dywapitchtracker *pitchtracker, int16_t * samples, int startsample, int samplecount);
+
+// allocates a sliding window of windowsize samples (a power of 2, at least 64) at the given samplerate
+// the window starts filled with silence
+// returns 0 if the window is too small for the number of wavelet levels
+int dywapitch_initwindow(dywapitchwindow *window, int windowsize, double sampleRate);
+
+// same for samples of the given type (DYWAPITCH_DOUBLE, DYWAPITCH_FLOAT or DYWAPITCH_INT16),
+// they must then be pushed with the matching dywapitch_pushsamples variant
+int dywapitch_initwindowtype(dywapitchwindow *window, int windowsize, double sampleRate, int sampletype);
+
+// releases the buffers of the window
+void dywapitch_freewindow(dywapitchwindow *window);
+
+// appends samples to the window, the oldest ones leave it
+void dywapitch_pushsamples(dywapitchwindow *window, double * samples, int startsample, int samplecount);
+void dywapitch_pushsamples_f(dywapitchwindow *window, float * samples, int startsample, int samplecount);
+void dywapitch_pushsamples_s16(dywapitchwindow *window, int16_t * samples, int startsample, int samplecount);
+
+// computes the pitch of the current window content, same result as dywapitch_computepitch
+// on the same samples. Incremental as long as a multiple of 32 samples was pushed in total,
+// otherwise falls back to a full computation.
+double dywapitch_computewindowpitch(dywapitchtracker *pitchtracker, dywapitchwindow *window);
+
+// same on the newest samplecount samples of the window only : a shorter window for higher
+// pitches, see dywapitch_neededsamplecount. Same result as dywapitch_computepitch on those
+// samples. samplecount is taken as dywapitch_recentsamplecount gives it.
+double dywapitch_computerecentpitch(dywapitchtracker *pitchtracker, dywapitchwindow *window, int samplecount);
+
+// the samples dywapitch_computerecentpitch works on when asked for samplecount : rounded
+// down to a power of 2, at most the window size, raised until the coarsest wavelet level
+// holds 4 samples and there are 2 chunks of 32 (128 at 44100 Hz, 64 at 22050 Hz and below)
+int dywapitch_recentsamplecount(dywapitchwindow *window, int samplecount);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -0,0 +1,495 @@
+/* dywapitchtrack_template.h
+
+ Dynamic Wavelet Algorithm Pitch Tracking library
+ Released under the MIT open source licence
+
+ Copyright (c) 2010 Antoine Schmitt
+
+ See dywapitchtrack.c for the full licence text.
+*/
+
+/* The sample type dependent part of the algorithm : the wavelet levels, the
+ extremum candidates, the DC and the amplitude threshold.
+ Included by dywapitchtrack.c once per sample type, with :
+
+ DYWA_SAMPLE	type of the samples given to the API
+ DYWA_LEVEL		type of the wavelet level values
+ DYWA_SUM		type of the DC sums
+ DYWA_FIXED		1 : the levels are integer sums, no averaging
+ DYWA_PAIR(a,b)	next level value from two samples
+ DYWA_NAME(x)	x with the type suffix
+
+ With DYWA_FIXED the levels are kept as sums of 2^level samples and the DC
+ as the sum of the window, so every comparison is done on exact integers
+ scaled to the same unit : the result is the one of the floating point
+ algorithm on the same samples, without any rounding.
+*/
+
+// an extremum candidate, see _dywapitchevent in dywapitchtrack.c
+struct DYWA_NAME(_dywapitchevent) {
+	long long index;
+	int type;
+	DYWA_LEVEL prev;
+	DYWA_LEVEL value;
+};
+
+// the DC and amplitude threshold of a window
+struct DYWA_NAME(_dywapitchdc) {
+#if DYWA_FIXED
+	long long sum;			// sum of the window
+	long long amplitude;	// amplitude * samplecount
+	int count;				// samplecount
+#else
+	double dc;
+	double threshold;
+#endif
+};
+
+void DYWA_NAME(_dywapitch_dcinit)(struct DYWA_NAME(_dywapitchdc) *dc, DYWA_SUM sum,
+								  DYWA_LEVEL maxValue, DYWA_LEVEL minValue, int samplecount) {
+#if DYWA_FIXED
+	long long above = (long long)maxValue*samplecount - sum;
+	long long below = sum - (long long)minValue*samplecount;
+	dc->sum = sum;
+	dc->amplitude = above > below ? above : below;
+	dc->count = samplecount;
+#else
+	dc->dc = sum/samplecount;
+	dc->threshold = _dywapitch_amplitudethreshold(dc->dc, maxValue, minValue);
+#endif
+}
+
+// sign of value - DC, value being of the given level
+int DYWA_NAME(_dywapitch_dcsign)(const struct DYWA_NAME(_dywapitchdc) *dc, DYWA_LEVEL value, int level) {
+#if DYWA_FIXED
+	long long centered = (long long)value*dc->count - dc->sum*((long long)1 << level);
+	return (centered > 0) - (centered < 0);
+#else
+	(void)level;
+	return (value > dc->dc) - (value < dc->dc);
+#endif
+}
+
+// 1 if |value - DC| reaches the amplitude threshold
+int DYWA_NAME(_dywapitch_loud)(const struct DYWA_NAME(_dywapitchdc) *dc, DYWA_LEVEL value, int level) {
+#if DYWA_FIXED
+	// DYWA_MAXIMATHRESHOLDRATIO is 3/4
+	long long centered = (long long)value*dc->count - dc->sum*((long long)1 << level);
+	if (centered < 0) centered = -centered;
+	return 4*centered >= 3*dc->amplitude*((long long)1 << level);
+#else
+	(void)level;
+	return fabs(value - dc->dc) >= dc->threshold;
+#endif
+}
+
+// DC sum, in DYWA_CHUNK chunks
+DYWA_SUM DYWA_NAME(_dywapitch_chunkedsum)(DYWA_LEVEL * sam, int samplecount) {
+	DYWA_SUM total = 0;
+	int c, i;
+	for (c = 0; c < samplecount; c += DYWA_CHUNK) {
+		DYWA_SUM part = 0;
+		int end = min(c + DYWA_CHUNK, samplecount);
+		for (i = c; i < end; i++) part += sam[i];
+		total += part;
+	}
+	return total;
+}
+
+// From the extremum candidates of a level, keep the first maximums and
+// minimums after zero-crossing that are greater than the threshold and at a
+// greater distance than delta.
+// events is a ring (mask + 1 entries) holding count candidates from head on,
+// indexed from base. firstValue is sample 1 of the level.
+//
+// Between two consecutive candidates the signal is monotonic, so a
+// zero-crossing in between shows in the values at both ends : this gives
+// exactly what a sample by sample scan would find.
+void DYWA_NAME(_dywapitch_extrema)(struct DYWA_NAME(_dywapitchevent) * events, int head, int count, int mask,
+								   long long base, DYWA_LEVEL firstValue,
+								   const struct DYWA_NAME(_dywapitchdc) *dc, int level, int delta,
+								   int * mins, int * nbMinsOut, int * maxs, int * nbMaxsOut) {
+	int i, k;
+	int nbMins = 0, nbMaxs = 0;
+	int lastMinIndex = -1000000;
+	int lastmaxIndex = -1000000;
+	int findMax = 0;
+	int findMin = 0;
+	int segmentStart = DYWA_NAME(_dywapitch_dcsign)(dc, firstValue, level); // at the previous candidate
+
+	for (k = 0; k < count; k++) {
+		struct DYWA_NAME(_dywapitchevent) *e = &events[(head + k) & mask];
+		int prev = DYWA_NAME(_dywapitch_dcsign)(dc, e->prev, level);
+		int value = DYWA_NAME(_dywapitch_dcsign)(dc, e->value, level);
+		i = (int)(e->index - base);
+
+		// zero-crossings since the previous candidate, then at i itself
+		if ((segmentStart <= 0 && prev > 0) || (prev <= 0 && value > 0)) findMax = 1;
+		if ((segmentStart >= 0 && prev < 0) || (prev >= 0 && value < 0)) findMin = 1;
+		segmentStart = value;
+
+		// the extremum is sample i-1 : test its amplitude, not the one of the
+		// sample after it, which matters at low (decimated) rates
+		if (e->type == DYWA_MIN && findMin) {
+			// minimum
+			if (DYWA_NAME(_dywapitch_loud)(dc, e->prev, level)) {
+				if (i > lastMinIndex + delta) {
+					mins[nbMins++] = i;
+					lastMinIndex = i;
+					findMin = 0;
+				} else {
+					//if DEBUGG then put "min too close to previous"&&(i - lastMinIndex)
+				}
+			}
+		}
+
+		if (e->type == DYWA_MAX && findMax) {
+			// maximum
+			if (DYWA_NAME(_dywapitch_loud)(dc, e->prev, level)) {
+				if (i > lastmaxIndex + delta) {
+					maxs[nbMaxs++] = i;
+					lastmaxIndex = i;
+					findMax = 0;
+				} else {
+					//if DEBUGG then put "max too close to previous"&&(i - lastmaxIndex)
+				}
+			}
+		}
+	}
+
+	*nbMinsOut = nbMins;
+	*nbMaxsOut = nbMaxs;
+}
+
+double DYWA_NAME(_dywapitch_computeWaveletPitch)(DYWA_SAMPLE * samples, int startsample, int samplecount, double sampleRate) {
+	double pitchF = 0.0;
+
+	int i;
+
+	// must be a power of 2
+	samplecount = _floor_power2(samplecount);
+
+	DYWA_LEVEL *sam = (DYWA_LEVEL *)malloc(sizeof(DYWA_LEVEL)*samplecount);
+	for (i = 0; i < samplecount; i++) sam[i] = samples[startsample + i];
+	int curSamNb = samplecount;
+
+	int *distances = (int *)malloc(sizeof(int)*samplecount);
+	int *mins = (int *)malloc(sizeof(int)*samplecount);
+	int *maxs = (int *)malloc(sizeof(int)*samplecount);
+	struct DYWA_NAME(_dywapitchevent) *events =
+		(struct DYWA_NAME(_dywapitchevent) *)malloc(sizeof(struct DYWA_NAME(_dywapitchevent))*samplecount);
+	memset(distances, 0, samplecount*sizeof(int));
+
+	int maxFLWTlevels = _dywapitch_levelcount(sampleRate);
+
+	struct DYWA_NAME(_dywapitchdc) dc;
+
+	{ // compute ampltitudeThreshold and theDC
+		//first compute the DC and maxAMplitude
+		DYWA_LEVEL maxValue = 0;
+		DYWA_LEVEL minValue = 0;
+		for (i = 0; i < samplecount;i++) {
+			if (sam[i] > maxValue) maxValue = sam[i];
+			if (sam[i] < minValue) minValue = sam[i];
+		}
+		DYWA_NAME(_dywapitch_dcinit)(&dc, DYWA_NAME(_dywapitch_chunkedsum)(sam, samplecount), maxValue, minValue, samplecount);
+	}
+
+	// levels, start without downsampling..
+	int curLevel = 0;
+	double curModeDistance = -1.;
+	int delta;
+
+	while(1) {
+
+		// delta
+		delta = sampleRate/(_2power(curLevel)*DYWA_MAXF);
+		//("dywapitch doing level=%ld delta=%ld\n", curLevel, delta);
+
+		if (curSamNb < 2) goto cleanup;
+
+		// extremum candidates of this level
+		int nbEvents = 0;
+		for (i = 3; i < curSamNb; i++) {
+			int type = _dywapitch_eventtype(sam[i-1] - sam[i-2], sam[i] - sam[i-1]);
+			if (type) {
+				events[nbEvents].index = i;
+				events[nbEvents].type = type;
+				events[nbEvents].prev = sam[i-1];
+				events[nbEvents].value = sam[i];
+				nbEvents++;
+			}
+		}
+
+		int nbMins, nbMaxs;
+		double distAvg;
+		DYWA_NAME(_dywapitch_extrema)(events, 0, nbEvents, samplecount - 1, 0, sam[1], &dc, curLevel, delta,
+									  mins, &nbMins, maxs, &nbMaxs);
+		if (!_dywapitch_modedistance(mins, nbMins, maxs, nbMaxs, delta, curSamNb, samplecount, distances, &distAvg)) {
+			// no best distance !
+			//asLog("dywapitch no mins nor maxs, exiting\n");
+			goto cleanup;
+		}
+
+		if (_dywapitch_nextlevel(distAvg, delta, sampleRate, maxFLWTlevels, &curLevel, &curModeDistance, &pitchF)) {
+			goto cleanup;
+		}
+
+		// downsample
+		if (curSamNb < 2) {
+			//asLog("dywapitch not enough samples, exiting\n");
+			goto cleanup;
+		}
+		for (i = 0; i < curSamNb/2; i++) {
+			sam[i] = DYWA_PAIR(sam[2*i], sam[2*i + 1]);
+		}
+		curSamNb /= 2;
+	}
+
+	///
+cleanup:
+	free(distances);
+	free(mins);
+	free(maxs);
+	free(events);
+	free(sam);
+
+	return pitchF;
+}
+
+// ***********************************
+// the sliding window
+// ***********************************
+
+struct DYWA_NAME(_dywapitchlevel) {
+	DYWA_LEVEL *sam;		// ring, size entries
+	int size;				// samples of the window at this level
+	long long pushed;		// samples ever pushed at this level
+
+	struct DYWA_NAME(_dywapitchevent) *events;	// ring, size entries
+	int eventHead;
+	int eventCount;
+};
+
+struct DYWA_NAME(_dywapitchwindowstate) {
+	int nbLevels;
+	struct DYWA_NAME(_dywapitchlevel) *levels;
+
+	// per chunk sums and extremes of the level 0 ring, for the DC and amplitude
+	int nbChunks;
+	int chunkHead;
+	DYWA_SUM *chunkSums;
+	DYWA_LEVEL *chunkMaxs;
+	DYWA_LEVEL *chunkMins;
+	int partialCount;
+	DYWA_SUM partialSum;
+	DYWA_LEVEL partialMax;
+	DYWA_LEVEL partialMin;
+
+	// work buffers
+	int *distances;
+	int *mins;
+	int *maxs;
+	DYWA_SAMPLE *scratch;
+};
+
+void DYWA_NAME(_dywapitch_levelpush)(struct DYWA_NAME(_dywapitchwindowstate) *state, int level, DYWA_LEVEL value) {
+	struct DYWA_NAME(_dywapitchlevel) *l = &state->levels[level];
+	int mask = l->size - 1;
+	long long p = l->pushed;
+
+	l->sam[p & mask] = value;
+	l->pushed = p + 1;
+
+	// forget the candidates that left the window (the first 3 samples
+	// of a window cannot hold one)
+	long long firstIndex = l->pushed - l->size + 3;
+	while (l->eventCount > 0 && l->events[l->eventHead].index < firstIndex) {
+		l->eventHead = (l->eventHead + 1) & mask;
+		l->eventCount--;
+	}
+
+	DYWA_LEVEL s1 = l->sam[(p-1) & mask];
+	int type = _dywapitch_eventtype(s1 - l->sam[(p-2) & mask], value - s1);
+	if (type) {
+		struct DYWA_NAME(_dywapitchevent) *e = &l->events[(l->eventHead + l->eventCount) & mask];
+		e->index = p;
+		e->type = type;
+		e->prev = s1;
+		e->value = value;
+		l->eventCount++;
+	}
+
+	// every second sample completes a pair for the next level
+	if ((p & 1) && level + 1 < state->nbLevels) {
+		DYWA_NAME(_dywapitch_levelpush)(state, level + 1, DYWA_PAIR(s1, value));
+	}
+}
+
+void DYWA_NAME(_dywapitch_freewindow)(dywapitchwindow *window) {
+	struct DYWA_NAME(_dywapitchwindowstate) *state = (struct DYWA_NAME(_dywapitchwindowstate) *)window->_state;
+	int level;
+
+	if (!state) return;
+	if (state->levels) {
+		for (level = 0; level < state->nbLevels; level++) {
+			free(state->levels[level].sam);
+			free(state->levels[level].events);
+		}
+	}
+	free(state->levels);
+	free(state->chunkSums);
+	free(state->chunkMaxs);
+	free(state->chunkMins);
+	free(state->distances);
+	free(state->mins);
+	free(state->maxs);
+	free(state->scratch);
+	free(state);
+}
+
+int DYWA_NAME(_dywapitch_initwindow)(dywapitchwindow *window) {
+	int level;
+	int windowsize = window->_windowSize;
+
+	struct DYWA_NAME(_dywapitchwindowstate) *state =
+		(struct DYWA_NAME(_dywapitchwindowstate) *)calloc(1, sizeof(struct DYWA_NAME(_dywapitchwindowstate)));
+	state->nbLevels = _dywapitch_levelcount(window->_sampleRate);
+	if (windowsize < 2*DYWA_CHUNK || (windowsize >> (state->nbLevels - 1)) < 4) {
+		free(state);
+		return 0;
+	}
+
+	state->levels = (struct DYWA_NAME(_dywapitchlevel) *)calloc(state->nbLevels, sizeof(struct DYWA_NAME(_dywapitchlevel)));
+	for (level = 0; level < state->nbLevels; level++) {
+		struct DYWA_NAME(_dywapitchlevel) *l = &state->levels[level];
+		l->size = windowsize >> level;
+		l->sam = (DYWA_LEVEL *)calloc(l->size, sizeof(DYWA_LEVEL));
+		l->events = (struct DYWA_NAME(_dywapitchevent) *)calloc(l->size, sizeof(struct DYWA_NAME(_dywapitchevent)));
+		// the window starts full of silence
+		l->pushed = l->size;
+	}
+
+	state->nbChunks = windowsize / DYWA_CHUNK;
+	state->chunkSums = (DYWA_SUM *)calloc(state->nbChunks, sizeof(DYWA_SUM));
+	state->chunkMaxs = (DYWA_LEVEL *)calloc(state->nbChunks, sizeof(DYWA_LEVEL));
+	state->chunkMins = (DYWA_LEVEL *)calloc(state->nbChunks, sizeof(DYWA_LEVEL));
+
+	state->distances = (int *)calloc(windowsize, sizeof(int));
+	state->mins = (int *)malloc(sizeof(int)*windowsize);
+	state->maxs = (int *)malloc(sizeof(int)*windowsize);
+	state->scratch = (DYWA_SAMPLE *)malloc(sizeof(DYWA_SAMPLE)*windowsize);
+
+	window->_state = state;
+	return 1;
+}
+
+void DYWA_NAME(_dywapitch_pushsamples)(dywapitchwindow *window, DYWA_SAMPLE * samples, int startsample, int samplecount) {
+	struct DYWA_NAME(_dywapitchwindowstate) *state = (struct DYWA_NAME(_dywapitchwindowstate) *)window->_state;
+	int i;
+
+	for (i = startsample; i < startsample + samplecount; i++) {
+		DYWA_LEVEL si = samples[i];
+
+		if (state->partialCount == 0) {
+			state->partialSum = 0;
+			state->partialMax = si;
+			state->partialMin = si;
+		}
+		state->partialSum += si;
+		if (si > state->partialMax) state->partialMax = si;
+		if (si < state->partialMin) state->partialMin = si;
+
+		if (++state->partialCount == DYWA_CHUNK) {
+			state->chunkSums[state->chunkHead] = state->partialSum;
+			state->chunkMaxs[state->chunkHead] = state->partialMax;
+			state->chunkMins[state->chunkHead] = state->partialMin;
+			state->chunkHead = (state->chunkHead + 1) % state->nbChunks;
+			state->partialCount = 0;
+		}
+
+		DYWA_NAME(_dywapitch_levelpush)(state, 0, si);
+	}
+}
+
+// the pitch of the newest samplecount samples of the window (a power of 2,
+// between 2*DYWA_CHUNK and the window size). Every level then starts at a
+// multiple of its pair count, so the stored levels and candidates are the
+// ones a from-scratch call on those samples would build.
+double DYWA_NAME(_dywapitch_computeWindowPitch)(dywapitchwindow *window, int samplecount) {
+	struct DYWA_NAME(_dywapitchwindowstate) *state = (struct DYWA_NAME(_dywapitchwindowstate) *)window->_state;
+	double pitchF = 0.0;
+	int i;
+
+	if (state->partialCount != 0) {
+		// not on a chunk boundary : levels and DC would not line up with a
+		// from-scratch call, do one on a copy of the window
+		struct DYWA_NAME(_dywapitchlevel) *l = &state->levels[0];
+		for (i = 0; i < samplecount; i++) {
+			state->scratch[i] = (DYWA_SAMPLE)l->sam[(l->pushed - samplecount + i) & (l->size - 1)];
+		}
+		return DYWA_NAME(_dywapitch_computeWaveletPitch)(state->scratch, 0, samplecount, window->_sampleRate);
+	}
+
+	struct DYWA_NAME(_dywapitchdc) dc;
+
+	{ // ampltitudeThreshold and theDC from the newest chunks, oldest first
+		int nbChunks = samplecount / DYWA_CHUNK;
+		DYWA_SUM sum = 0;
+		DYWA_LEVEL maxValue = 0;
+		DYWA_LEVEL minValue = 0;
+		for (i = 0; i < nbChunks; i++) {
+			int c = (state->chunkHead - nbChunks + i + state->nbChunks) % state->nbChunks;
+			sum = sum + state->chunkSums[c];
+			if (state->chunkMaxs[c] > maxValue) maxValue = state->chunkMaxs[c];
+			if (state->chunkMins[c] < minValue) minValue = state->chunkMins[c];
+		}
+		DYWA_NAME(_dywapitch_dcinit)(&dc, sum, maxValue, minValue, samplecount);
+	}
+
+	int curLevel = 0;
+	double curModeDistance = -1.;
+	int delta;
+
+	while(1) {
+		struct DYWA_NAME(_dywapitchlevel) *l = &state->levels[curLevel];
+		int mask = l->size - 1;
+		int size = samplecount >> curLevel;
+		long long base = l->pushed - size;
+
+		delta = window->_sampleRate/(_2power(curLevel)*DYWA_MAXF);
+
+		if (size < 2) break;
+
+		// skip the candidates older than the samples analysed (sorted by index)
+		int first = 0, last = l->eventCount;
+		while (first < last) {
+			int middle = (first + last) / 2;
+			if (l->events[(l->eventHead + middle) & mask].index < base + 3) first = middle + 1;
+			else last = middle;
+		}
+
+		int nbMins, nbMaxs;
+		double distAvg;
+		DYWA_NAME(_dywapitch_extrema)(l->events, (l->eventHead + first) & mask, l->eventCount - first, mask, base,
+									  l->sam[(base + 1) & mask], &dc, curLevel, delta,
+									  state->mins, &nbMins, state->maxs, &nbMaxs);
+		if (!_dywapitch_modedistance(state->mins, nbMins, state->maxs, nbMaxs, delta, size, samplecount,
+									 state->distances, &distAvg)) {
+			break;
+		}
+
+		if (_dywapitch_nextlevel(distAvg, delta, window->_sampleRate, state->nbLevels, &curLevel, &curModeDistance, &pitchF)) {
+			break;
+		}
+	}
+
+	return pitchF;
+}
+
+#undef DYWA_SAMPLE
+#undef DYWA_LEVEL
+#undef DYWA_SUM
+#undef DYWA_FIXED
+#undef DYWA_PAIR
+#undef DYWA_NAME
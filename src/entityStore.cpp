@@ -0,0 +1,200 @@
+#include "entityStore.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENTITY_SSE2
+#include <emmintrin.h>
+#endif
+
+//--------------------------------------------------------------
+entityStore::entityStore() {
+	maxWidth = 0;
+	shuffled = false;
+}
+
+//--------------------------------------------------------------
+void entityStore::clear() {
+	x.clear();
+	y.clear();
+	width.clear();
+	height.clear();
+	vx.clear();
+	vy.clear();
+	kind.clear();
+	removed.clear();
+	maxWidth = 0;
+	shuffled = false;
+}
+
+//--------------------------------------------------------------
+void entityStore::reserve(int count) {
+	x.reserve(count);
+	y.reserve(count);
+	width.reserve(count);
+	height.reserve(count);
+	vx.reserve(count);
+	vy.reserve(count);
+	kind.reserve(count);
+	removed.reserve(count);
+}
+
+//--------------------------------------------------------------
+void entityStore::add(entityKind kind, float x, float y, float width, float height, float vx, float vy) {
+	if (!this->x.empty() && x < this->x.back()) {
+		shuffled = true;
+	}
+
+	this->x.push_back(x);
+	this->y.push_back(y);
+	this->width.push_back(width);
+	this->height.push_back(height);
+	this->vx.push_back(vx);
+	this->vy.push_back(vy);
+	this->kind.push_back(kind);
+	this->removed.push_back(0);
+
+	maxWidth = std::max(maxWidth, width);
+}
+
+//--------------------------------------------------------------
+void entityStore::remove(int index) {
+	removed[index] = 1;
+}
+
+//--------------------------------------------------------------
+void entityStore::update(float dt, float minX) {
+	const int count = size();
+
+	// move and compact in one pass, the order is kept
+	int kept = 0;
+	maxWidth = 0;
+	for (int i = 0; i < count; i++) {
+		float nextX = x[i] + vx[i] * dt;
+		if (removed[i] || nextX + width[i] < minX) {
+			continue;
+		}
+
+		x[kept] = nextX;
+		y[kept] = y[i] + vy[i] * dt;
+		width[kept] = width[i];
+		height[kept] = height[i];
+		vx[kept] = vx[i];
+		vy[kept] = vy[i];
+		kind[kept] = kind[i];
+		removed[kept] = 0;
+		maxWidth = std::max(maxWidth, width[i]);
+		kept++;
+	}
+
+	x.resize(kept);
+	y.resize(kept);
+	width.resize(kept);
+	height.resize(kept);
+	vx.resize(kept);
+	vy.resize(kept);
+	kind.resize(kept);
+	removed.resize(kept);
+
+	sort();
+}
+
+//--------------------------------------------------------------
+void entityStore::swap(int a, int b) {
+	std::swap(x[a], x[b]);
+	std::swap(y[a], y[b]);
+	std::swap(width[a], width[b]);
+	std::swap(height[a], height[b]);
+	std::swap(vx[a], vx[b]);
+	std::swap(vy[a], vy[b]);
+	std::swap(kind[a], kind[b]);
+	std::swap(removed[a], removed[b]);
+}
+
+//--------------------------------------------------------------
+void entityStore::sort() {
+	const int count = size();
+
+	if (shuffled) {
+		// added in any order : a full sort through a permutation
+		order.resize(count);
+		for (int i = 0; i < count; i++) {
+			order[i] = std::make_pair(x[i], i);
+		}
+		std::sort(order.begin(), order.end());
+
+		position.resize(count);
+		for (int i = 0; i < count; i++) {
+			position[order[i].second] = i;
+		}
+		// apply the permutation cycle by cycle
+		for (int i = 0; i < count; i++) {
+			while (position[i] != i) {
+				int target = position[i];
+				swap(i, target);
+				std::swap(position[i], position[target]);
+			}
+		}
+		shuffled = false;
+		return;
+	}
+
+	// moved a little since the last sort : nearly in order already
+	for (int i = 1; i < count; i++) {
+		for (int j = i; j > 0 && x[j] < x[j - 1]; j--) {
+			swap(j, j - 1);
+		}
+	}
+}
+
+//--------------------------------------------------------------
+void entityStore::range(float fromX, float toX, int& first, int& last) const {
+	// nothing starting left of fromX - maxWidth reaches fromX
+	first = std::lower_bound(x.begin(), x.end(), fromX - maxWidth) - x.begin();
+	last = std::upper_bound(x.begin() + first, x.end(), toX) - x.begin();
+}
+
+//--------------------------------------------------------------
+int entityStore::collide(float cx, float cy, float radius, int* hits, int maxHits) const {
+	int first, last;
+	range(cx - radius, cx + radius, first, last);
+
+	const float radius2 = radius * radius;
+	int count = 0;
+	int i = first;
+
+	// closest point of each rectangle to the centre, then its distance
+#ifdef ENTITY_SSE2
+	const __m128 centerX = _mm_set1_ps(cx);
+	const __m128 centerY = _mm_set1_ps(cy);
+	const __m128 limit = _mm_set1_ps(radius2);
+
+	for (; i + 4 <= last && count < maxHits; i += 4) {
+		__m128 left = _mm_loadu_ps(&x[i]);
+		__m128 bottom = _mm_loadu_ps(&y[i]);
+		__m128 right = _mm_add_ps(left, _mm_loadu_ps(&width[i]));
+		__m128 top = _mm_add_ps(bottom, _mm_loadu_ps(&height[i]));
+
+		__m128 dx = _mm_sub_ps(centerX, _mm_min_ps(_mm_max_ps(centerX, left), right));
+		__m128 dy = _mm_sub_ps(centerY, _mm_min_ps(_mm_max_ps(centerY, bottom), top));
+		__m128 distance2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+
+		int mask = _mm_movemask_ps(_mm_cmple_ps(distance2, limit));
+		for (int k = 0; mask && count < maxHits; k++, mask >>= 1) {
+			if ((mask & 1) && !removed[i + k]) {
+				hits[count++] = i + k;
+			}
+		}
+	}
+#endif
+
+	for (; i < last && count < maxHits; i++) {
+		float dx = cx - std::min(std::max(cx, x[i]), x[i] + width[i]);
+		float dy = cy - std::min(std::max(cy, y[i]), y[i] + height[i]);
+		if (dx * dx + dy * dy <= radius2 && !removed[i]) {
+			hits[count++] = i;
+		}
+	}
+
+	return count;
+}
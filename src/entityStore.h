@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <utility>
+
+enum entityKind {
+	ENTITY_OBSTACLE,
+	ENTITY_PICKUP
+};
+
+// Moving rectangles of the level (obstacles, pickups), one array per field.
+//
+// The entities are kept sorted by their left edge along the scroll axis,
+// so the broadphase is a sweep and prune: a binary search finds the first
+// one that can reach a query circle, and the candidates are the contiguous
+// run up to its right edge. The narrow phase tests that run against the
+// circle four at a time with SSE. update() moves everything and restores the
+// order with an insertion sort, which is linear while entities only move a
+// little per step.
+//
+// Units are up to the caller, x and y only have to share a scale.
+class entityStore {
+
+	public:
+		entityStore();
+
+		void clear();
+		void reserve(int count);
+
+		// x, y is the lower left corner. Queries find the entity after the next
+		// update(), update(0, ...) puts a batch of adds in place.
+		void add(entityKind kind, float x, float y, float width, float height, float vx = 0, float vy = 0);
+		// dropped at the next update(), collide() skips it until then
+		void remove(int index);
+
+		// moves by dt, drops removed entities and those ending left of minX
+		void update(float dt, float minX);
+
+		// indices of the entities overlapping the circle, at most maxHits of them
+		int collide(float cx, float cy, float radius, int* hits, int maxHits) const;
+		// indices [first, last) of the entities that may overlap [fromX, toX]
+		void range(float fromX, float toX, int& first, int& last) const;
+
+		int size() const { return (int)x.size(); }
+		float getX(int i) const { return x[i]; }
+		float getY(int i) const { return y[i]; }
+		float getWidth(int i) const { return width[i]; }
+		float getHeight(int i) const { return height[i]; }
+		entityKind getKind(int i) const { return (entityKind)kind[i]; }
+		bool isRemoved(int i) const { return removed[i] != 0; }
+
+	private:
+		void sort();
+		void swap(int a, int b);
+
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> width;
+		std::vector<float> height;
+		std::vector<float> vx;
+		std::vector<float> vy;
+		std::vector<uint8_t> kind;
+		std::vector<uint8_t> removed;
+
+		float maxWidth;		// how far left of a query the broadphase looks
+		bool shuffled;		// added out of order since the last sort
+
+		// the permutation of a full sort, kept so sorting does not allocate
+		std::vector<std::pair<float, int> > order;
+		std::vector<int> position;
+};
@@ -0,0 +1,110 @@
+#include "envelopeFollower.h"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENVELOPE_SSE2
+#include <emmintrin.h>
+#endif
+
+//--------------------------------------------------------------
+// peak |x| of frames of channel 0
+static float channelPeak(const float* input, int frames, int nChannels) {
+	float peak = 0;
+	int i = 0;
+
+#ifdef ENVELOPE_SSE2
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	__m128 peak4 = _mm_setzero_ps();
+
+	if (nChannels == 1) {
+		for (; i + 4 <= frames; i += 4) {
+			peak4 = _mm_max_ps(peak4, _mm_and_ps(_mm_loadu_ps(input + i), absMask));
+		}
+	}
+	else if (nChannels == 2) {
+		for (; i + 4 <= frames; i += 4) {
+			// L0 R0 L1 R1 | L2 R2 L3 R3 -> L0 L1 L2 L3
+			__m128 a = _mm_loadu_ps(input + i * 2);
+			__m128 b = _mm_loadu_ps(input + i * 2 + 4);
+			__m128 x = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+			peak4 = _mm_max_ps(peak4, _mm_and_ps(x, absMask));
+		}
+	}
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, peak4);
+	peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+
+	// tail, and channel layouts the vector path does not cover
+	for (; i < frames; i++) {
+		peak = std::max(peak, std::fabs(input[i * nChannels]));
+	}
+	return peak;
+}
+
+//--------------------------------------------------------------
+envelopeFollower::envelopeFollower() {
+	enabled = false;
+	blend = 0;
+	gain = 0;
+	subBlock = ENVELOPE_MAX_BLOCK;
+	attack = release = 0;
+	envelope = 0;
+	pendingPeak = 0;
+	pendingFrames = 0;
+}
+
+//--------------------------------------------------------------
+void envelopeFollower::setup(const t_config& config, int sampleRate) {
+	enabled = config.envelopeBlend > 0;
+
+	// a power of two, so it divides ENVELOPE_AUDIO_BLOCK
+	subBlock = ENVELOPE_MIN_BLOCK;
+	while (subBlock * 2 <= std::min(config.envelopeBlock, ENVELOPE_MAX_BLOCK)) {
+		subBlock *= 2;
+	}
+
+	// one pole smoothing per sub-block, times to 1 - 1/e of a step
+	const double subBlockTime = subBlock / (double)sampleRate;
+	attack = config.envelopeAttack > 0 ? exp(-subBlockTime / config.envelopeAttack) : 0;
+	release = config.envelopeRelease > 0 ? exp(-subBlockTime / config.envelopeRelease) : 0;
+
+	envelope = 0;
+	pendingPeak = 0;
+	pendingFrames = 0;
+	setConfig(config);
+}
+
+//--------------------------------------------------------------
+void envelopeFollower::setConfig(const t_config& config) {
+	blend = std::min(1.0, std::max(0.0, config.envelopeBlend));
+	gain = config.envelopeGain;
+}
+
+//--------------------------------------------------------------
+float envelopeFollower::process(const float* input, int frames, int nChannels) {
+	// sub-blocks run across audioIn blocks
+	int i = 0;
+	while (i < frames) {
+		int count = std::min(frames - i, subBlock - pendingFrames);
+		pendingPeak = std::max(pendingPeak, channelPeak(input + i * nChannels, count, nChannels));
+		pendingFrames += count;
+		i += count;
+
+		if (pendingFrames == subBlock) {
+			float kept = pendingPeak > envelope ? attack : release;
+			envelope = pendingPeak + (envelope - pendingPeak) * kept;
+			pendingPeak = 0;
+			pendingFrames = 0;
+		}
+	}
+	return envelope;
+}
+
+//--------------------------------------------------------------
+float envelopeFollower::mix(float pitchControl) const {
+	return (1 - blend) * pitchControl + blend * gain * envelope;
+}
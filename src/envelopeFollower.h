@@ -0,0 +1,53 @@
+#pragma once
+
+#include "tripnoConfig.h"
+
+#define ENVELOPE_AUDIO_BLOCK 128 // frames per audioIn while the envelope is mixed in
+#define ENVELOPE_MIN_BLOCK 32
+#define ENVELOPE_MAX_BLOCK 128
+
+// Loudness as a control, for players who cannot steer with pitch.
+//
+// The peak |x| of the analysis channel is taken per sub-block of
+// envelopeBlock frames (32 to 128, ~1-3 ms at 44100 Hz) and follows it
+// with separate attack and release times. The pitch control needs a full
+// analysis window before it moves, the envelope only needs one sub-block.
+//
+// The game control is the pitch control and the envelope times
+// envelopeGain, mixed by envelopeBlend: 0 - pitch only, 1 - loudness only.
+// Louder pushes tripno up, silence lets it settle back. Free of
+// openFrameworks.
+class envelopeFollower {
+
+	public:
+		envelopeFollower();
+
+		// from config: blend, sub-block, attack and release times, gain
+		void setup(const t_config& config, int sampleRate);
+		// blend and gain only, the rest applies on setup
+		void setConfig(const t_config& config);
+
+		// the envelope is mixed in, audioIn runs on ENVELOPE_AUDIO_BLOCK frames
+		bool isEnabled() const { return enabled; }
+
+		// follows the sub-blocks of input, channel 0 of nChannels
+		// interleaved. Returns the envelope at the end of the block.
+		float process(const float* input, int frames, int nChannels);
+		float getEnvelope() const { return envelope; }
+
+		// the game control from the latest pitch control and envelope
+		float mix(float pitchControl) const;
+
+	private:
+		bool enabled;
+		double blend;
+		double gain;
+		int subBlock;
+		float attack;		// per sub-block, the part of the distance kept
+		float release;
+		float envelope;
+
+		// the sub-block in progress
+		float pendingPeak;
+		int pendingFrames;
+};
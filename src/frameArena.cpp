@@ -0,0 +1,70 @@
+#include "frameArena.h"
+
+#include <cstdlib>
+
+//--------------------------------------------------------------
+frameArena::frameArena() {
+	block = NULL;
+	size = 0;
+	used = 0;
+	spilledBytes = 0;
+	spills = 0;
+}
+
+//--------------------------------------------------------------
+frameArena::~frameArena() {
+	releaseSpills();
+	free(block);
+}
+
+//--------------------------------------------------------------
+void frameArena::setup(size_t size) {
+	releaseSpills();
+	free(block);
+
+	block = (char*)malloc(size);
+	this->size = block ? size : 0;
+	used = 0;
+}
+
+//--------------------------------------------------------------
+void frameArena::reset() {
+	// the block becomes as big as the busiest frame, with some room
+	if (!spilled.empty()) {
+		size_t needed = used + spilledBytes;
+		setup(needed + needed / 4);
+	}
+	used = 0;
+}
+
+//--------------------------------------------------------------
+void frameArena::releaseSpills() {
+	for (size_t i = 0; i < spilled.size(); i++) {
+		free(spilled[i]);
+	}
+	spilled.clear();
+	spilledBytes = 0;
+}
+
+//--------------------------------------------------------------
+void* frameArena::allocate(size_t bytes, size_t align) {
+	// aligned as an address, whatever malloc gave the block
+	size_t start = used;
+	if (block) {
+		start = (((uintptr_t)block + used + align - 1) & ~(uintptr_t)(align - 1)) - (uintptr_t)block;
+	}
+	if (block && start + bytes <= size) {
+		used = start + bytes;
+		return block + start;
+	}
+
+	// past the block: a heap block, aligned by hand, freed on reset
+	char* spill = (char*)malloc(bytes + align);
+	if (!spill) {
+		abort();
+	}
+	spilled.push_back(spill);
+	spilledBytes += bytes + align;
+	spills++;
+	return (void*)(((uintptr_t)spill + align - 1) & ~(uintptr_t)(align - 1));
+}
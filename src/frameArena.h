@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define FRAME_ARENA_SIZE (2 << 20) // bytes at startup, a full spectrogram is ~800 kB
+#define FRAME_ARENA_ALIGN 16
+
+// Memory for what one frame of update() and draw() builds and drops: a
+// bump allocator over one block, reset at the start of every frame.
+// Nothing is freed on its own, reset() drops everything at once.
+//
+// A frame that needs more than the block gets heap blocks for the rest,
+// counted as spills. The next reset() grows the block to what that frame
+// used, so the heap is only touched until the frame loop has warmed up.
+// One thread only. Free of openFrameworks.
+class frameArena {
+
+	public:
+		frameArena();
+		~frameArena();
+
+		// allocates the block
+		void setup(size_t size);
+		// drops what the last frame allocated
+		void reset();
+
+		// never NULL, aligned to align (a power of two)
+		void* allocate(size_t bytes, size_t align = FRAME_ARENA_ALIGN);
+		template<typename T> T* allocate(size_t count) { return (T*)allocate(sizeof(T) * count); }
+
+		size_t getSize() const { return size; }
+		// of the frame so far, spills included
+		size_t getUsed() const { return used + spilledBytes; }
+		uint32_t getSpills() const { return spills; }
+
+	private:
+		void releaseSpills();
+
+		char* block;
+		size_t size;
+		size_t used;
+
+		std::vector<char*> spilled;	// heap blocks of this frame
+		size_t spilledBytes;
+		uint32_t spills;			// since setup
+};
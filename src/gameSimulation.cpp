@@ -0,0 +1,312 @@
+#include "gameSimulation.h"
+#include "allocCounter.h"
+
+#include <algorithm>
+
+//--------------------------------------------------------------
+gameSimulation::gameSimulation() {
+	startTime = 0;
+	signal = 0;
+	pendingControl = 0;
+	hasPendingControl = false;
+	paused = 0;
+	state = published[0] = published[1] = t_sceneState();
+}
+
+//--------------------------------------------------------------
+void gameSimulation::setup(const t_config& config, const ofRectangle& viewPort) {
+	this->config = nextConfig = config;
+	this->viewPort = nextViewPort = viewPort;
+
+	state = t_sceneState();
+	state.firstSegment = -1;
+	state.tripno.mass = 1.0;
+	state.tripno.velocity = 0;
+	state.tripno.position = ofPoint(0, 0);
+	entities.clear();
+	updateSegments();
+	entities.update(0, state.scroll - 1);
+
+	signal = 0;
+	hasPendingControl = false;
+
+	published[0] = published[1] = state;
+	startTime = ofGetElapsedTimeMicros();
+}
+
+//--------------------------------------------------------------
+void gameSimulation::setConfig(const t_config& config) {
+	inputMutex.lock();
+	nextConfig = config;
+	inputMutex.unlock();
+}
+
+//--------------------------------------------------------------
+void gameSimulation::setViewPort(const ofRectangle& viewPort) {
+	inputMutex.lock();
+	nextViewPort = viewPort;
+	inputMutex.unlock();
+}
+
+//--------------------------------------------------------------
+void gameSimulation::pushControl(float control) {
+	inputMutex.lock();
+	// the strongest control since the last step
+	pendingControl = hasPendingControl ? std::max(pendingControl, control) : control;
+	hasPendingControl = true;
+	inputMutex.unlock();
+}
+
+//--------------------------------------------------------------
+void gameSimulation::setPaused(bool paused) {
+	storeRelease(&this->paused, paused ? 1 : 0);
+}
+
+//--------------------------------------------------------------
+ofRectangle gameSimulation::getGameField(const ofRectangle& viewPort) {
+	ofRectangle gameField = viewPort;
+	gameField.height = gameFieldHeight(viewPort.width);
+	gameField.y = (viewPort.height - gameField.height) / 2;
+	return gameField;
+}
+
+//--------------------------------------------------------------
+double gameSimulation::getTripnoAbsoluteY(double y) const {
+	return viewPort.height * 0.5 - y;
+}
+
+//--------------------------------------------------------------
+t_sceneState gameSimulation::getScene(unsigned long long now) {
+	lock();
+	t_sceneState previous = published[0];
+	t_sceneState scene = published[1];
+	unlock();
+
+	// show the state of one step ago, it always lies between two published steps
+	double time = (now - startTime) / 1000000.0 - 1.0 / SIMULATION_RATE;
+	double span = scene.time - previous.time;
+	double alpha = span > 0 ? (time - previous.time) / span : 1;
+	alpha = std::min(1.0, std::max(0.0, alpha));
+
+	scene.time = previous.time + span * alpha;
+	scene.scroll = previous.scroll + (scene.scroll - previous.scroll) * alpha;
+	scene.tripno.position.y = previous.tripno.position.y
+		+ (scene.tripno.position.y - previous.tripno.position.y) * alpha;
+	return scene;
+}
+
+//--------------------------------------------------------------
+void gameSimulation::threadedFunction() {
+	const double dt = 1.0 / SIMULATION_RATE;
+	TRACE_THREAD_NAME("simulation");
+	ALLOC_THREAD_NAME("simulation");
+
+	while (isThreadRunning()) {
+		double now = (ofGetElapsedTimeMicros() - startTime) / 1000000.0;
+
+		if (loadAcquire(&paused)) {
+			// the clock follows, so nothing is replayed on resume
+			state.time = now;
+			lock();
+			published[0] = published[1] = state;
+			unlock();
+
+			ofSleepMillis(IDLE_POLL_MILLIS);
+			continue;
+		}
+
+		// a stall longer than the catch-up limit is not replayed
+		if (now - state.time > SIMULATION_MAX_CATCHUP * dt) {
+			state.time = now - SIMULATION_MAX_CATCHUP * dt;
+		}
+
+		if (state.time + dt <= now) {
+			TRACE_ZONE("simulate");
+
+			inputMutex.lock();
+			config = nextConfig;
+			viewPort = nextViewPort;
+			if (hasPendingControl) {
+				// hold the last control until the next audio hop
+				signal = pendingControl * config.signalAmp;
+				hasPendingControl = false;
+			}
+			inputMutex.unlock();
+
+			t_sceneState previous = state;
+			while (state.time + dt <= now) {
+				previous = state;
+				step(dt);
+			}
+
+			lock();
+			published[0] = previous;
+			published[1] = state;
+			unlock();
+		}
+
+		ofSleepMillis(1);
+	}
+	ALLOC_THREAD_EXIT();
+}
+
+//--------------------------------------------------------------
+void gameSimulation::updateSegments() {
+	// keep one segment behind the view for the interpolated frames
+	int first = std::max(0, (int)floor(state.scroll) - 1);
+	int shift = std::min(first - state.firstSegment, SEGMENTS_STORED);
+
+	if (shift > 0) {
+		for (int i = 0; i < SEGMENTS_STORED - shift; ++i) {
+			state.ceilHeights[i] = state.ceilHeights[i + shift];
+			state.floorHeights[i] = state.floorHeights[i + shift];
+		}
+		for (int i = SEGMENTS_STORED - shift; i < SEGMENTS_STORED; ++i) {
+			state.floorHeights[i] = state.ceilHeights[i] = 0;
+		}
+		state.firstSegment = first;
+	}
+
+	ofRectangle gameField = getGameField(viewPort);
+	float maxSegmentHeight = gameField.height * SEGMENT_MAX_HEIGHT_PART;
+	float minSegmentHeight = maxSegmentHeight / 2;
+	double segmentWidth = ceil(gameField.width / SEGMENTS_PER_VIEWPORT);
+
+	for (int i = 0; i < SEGMENTS_STORED && gameField.height > 0; ++i) {
+		if (state.ceilHeights[i] == 0) { // generate hights
+			state.ceilHeights[i] = ofRandom(minSegmentHeight, maxSegmentHeight);
+			state.floorHeights[i] = ofRandom(minSegmentHeight, maxSegmentHeight);
+
+			// the corridor left between them, in segments
+			spawnEntities(state.firstSegment + i,
+				getTripnoAbsoluteY(gameField.y + state.ceilHeights[i]) / segmentWidth,
+				getTripnoAbsoluteY(gameField.y + gameField.height - state.floorHeights[i]) / segmentWidth);
+		}
+	}
+}
+
+//--------------------------------------------------------------
+void gameSimulation::spawnEntities(int segment, float ceilLimit, float floorLimit) {
+	// the first screen is left free
+	if (segment < SEGMENTS_PER_VIEWPORT / 2) {
+		return;
+	}
+
+	const double rates[2] = { config.obstaclesPerSegment, config.pickupsPerSegment };
+	const entityKind kinds[2] = { ENTITY_OBSTACLE, ENTITY_PICKUP };
+
+	for (int k = 0; k < 2; k++) {
+		int count = (int)rates[k];
+		count += ofRandom(0, 1) < rates[k] - count ? 1 : 0;
+
+		for (int n = 0; n < count; n++) {
+			float size = kinds[k] == ENTITY_PICKUP ? 0.4f : ofRandom(0.5f, 1.0f);
+			if (ceilLimit - floorLimit < size) {
+				continue;
+			}
+			// obstacles drift towards tripno
+			entities.add(kinds[k], segment + ofRandom(0, 1 - size * 0.5f), ofRandom(floorLimit, ceilLimit - size),
+				size, size, kinds[k] == ENTITY_OBSTACLE ? ofRandom(-0.3f, 0) : 0);
+		}
+	}
+}
+
+//--------------------------------------------------------------
+void gameSimulation::collideEntities(double segmentWidth) {
+	movableObject& tripno = state.tripno;
+
+	float cx = state.scroll + tripno.position.x / segmentWidth;
+	float cy = tripno.position.y / segmentWidth;
+	int hits[MAX_ENTITY_HITS];
+	int count = entities.collide(cx, cy, TRIPNO_RADIUS, hits, MAX_ENTITY_HITS);
+
+	for (int h = 0; h < count; h++) {
+		int i = hits[h];
+		if (entities.getKind(i) == ENTITY_PICKUP) {
+			entities.remove(i);
+			state.pickups++;
+		}
+		else {
+			// away from the obstacle centre
+			bool above = cy > entities.getY(i) + entities.getHeight(i) / 2;
+			tripno.velocity = above ? fabs(tripno.velocity) : -fabs(tripno.velocity);
+		}
+	}
+}
+
+//--------------------------------------------------------------
+void gameSimulation::collectEntities() {
+	int first, last;
+	entities.range(state.scroll - 1, state.scroll + SEGMENTS_PER_VIEWPORT + 1, first, last);
+
+	state.entityCount = 0;
+	for (int i = first; i < last && state.entityCount < SCENE_MAX_ENTITIES; i++) {
+		if (entities.isRemoved(i)) {
+			continue;
+		}
+		t_sceneEntity& entity = state.entities[state.entityCount++];
+		entity.x = entities.getX(i);
+		entity.y = entities.getY(i);
+		entity.width = entities.getWidth(i);
+		entity.height = entities.getHeight(i);
+		entity.kind = entities.getKind(i);
+	}
+}
+
+//--------------------------------------------------------------
+void gameSimulation::step(double dt) {
+	movableObject& tripno = state.tripno;
+	const double scrollFrom = state.scroll;
+
+	state.time += dt;
+	state.scroll += MOVEMENT_SPEED * dt;
+	updateSegments();
+	// moves the entities, those just spawned take their place
+	entities.update(dt, state.scroll - 1);
+
+	ofRectangle gameField = getGameField(viewPort);
+	double segmentWidth = ceil(gameField.width / SEGMENTS_PER_VIEWPORT);
+	tripno.position.x = gameField.width * 0.3;
+
+	double control = signal != signal ? 0 : signal;
+	tripno.dbgSignal = control ? control : tripno.dbgSignal;
+
+	t_tripnoMotion motion;
+	motion.y = tripno.position.y;
+	motion.velocity = tripno.velocity;
+	integrateTripno(motion, control, tripno.mass, config, dt);
+
+	tripno.elastic = motion.elastic;
+	tripno.resistance = motion.resistance;
+
+	if (segmentWidth <= 0) {
+		tripno.position.y = motion.y;
+		tripno.velocity = motion.velocity;
+		collectEntities();
+		return;
+	}
+
+	// Swept collision: the lowest ceiling and highest floor of every
+	// segment under tripno during the step, tripno is bounced back
+	// by what it went past them.
+	int from = floor(scrollFrom + tripno.position.x / segmentWidth) - state.firstSegment;
+	int to = floor(state.scroll + tripno.position.x / segmentWidth) - state.firstSegment;
+	from = std::max(0, from);
+	to = std::min(SEGMENTS_STORED - 1, to);
+
+	double ceilY = -1e9;
+	double floorY = 1e9;
+	for (int i = from; i <= to; i++) {
+		ceilY = std::max(ceilY, (double)gameField.y + state.ceilHeights[i]);
+		floorY = std::min(floorY, (double)gameField.y + gameField.height - state.floorHeights[i]);
+	}
+
+	// back from absolute to tripno coordinates
+	bounceTripno(motion, getTripnoAbsoluteY(ceilY), getTripnoAbsoluteY(floorY));
+
+	tripno.position.y = motion.y;
+	tripno.velocity = motion.velocity;
+
+	collideEntities(segmentWidth);
+	collectEntities();
+}
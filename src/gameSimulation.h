@@ -0,0 +1,110 @@
+#pragma once
+
+#include "ofMain.h"
+#include "tripnoConfig.h"
+#include "traceZones.h"
+#include "entityStore.h"
+#include "tripnoPhysics.h"
+#include "idleMonitor.h"
+#include "atomicOps.h"
+
+#define SEGMENTS_PER_VIEWPORT 20
+#define SEGMENTS_STORED (SEGMENTS_PER_VIEWPORT + 2) // one behind the view, one ahead
+#define SIMULATION_MAX_CATCHUP 24 // steps, a longer stall is dropped
+#define TRIPNO_RADIUS 0.6 // segments
+#define SCENE_MAX_ENTITIES 256 // entities drawn
+#define MAX_ENTITY_HITS 16 // per step
+
+struct movableObject {
+	double mass;
+
+	ofPoint position;
+	double velocity;
+
+	double elastic;
+	double resistance;
+
+	double dbgSignal;
+};
+
+// Obstacle or pickup in view, in segments: x from the level start,
+// y up from the middle of the field
+struct t_sceneEntity {
+	float x, y;
+	float width, height;
+	entityKind kind;
+};
+
+// Everything draw() needs of one simulation step
+struct t_sceneState {
+	double time;			// s since the simulation started
+	double scroll;			// segments scrolled
+	int firstSegment;		// scroll index of the heights[0] segment
+	float ceilHeights[SEGMENTS_STORED];
+	float floorHeights[SEGMENTS_STORED];
+	movableObject tripno;
+
+	int pickups;			// taken since setup
+	int entityCount;
+	t_sceneEntity entities[SCENE_MAX_ENTITIES];
+};
+
+// The game world, stepped at a fixed SIMULATION_RATE on its own thread.
+//
+// Each step moves the walls and integrates tripno, and collides it against
+// every wall segment passed under it during the step. The whole step path is
+// tested, so a late frame cannot make tripno tunnel through a wall.
+// Obstacles and pickups spawned with the segments live in an entityStore,
+// tripno bounces off the obstacles and takes the pickups.
+// After each batch of steps, the last two states are published. draw() takes
+// them with getScene() and interpolates one step behind real time. The lock
+// is held only for the copy, so neither thread waits on the other's work.
+class gameSimulation : public ofThread {
+
+	public:
+		gameSimulation();
+
+		// resets the world, call before startThread()
+		void setup(const t_config& config, const ofRectangle& viewPort);
+
+		// inputs, from any thread
+		void setConfig(const t_config& config);
+		void setViewPort(const ofRectangle& viewPort);
+		void pushControl(float control);
+		// while paused the world holds still and the thread mostly sleeps
+		void setPaused(bool paused);
+
+		// interpolated scene at now (ofGetElapsedTimeMicros)
+		t_sceneState getScene(unsigned long long now);
+
+		// part of the viewport the walls live in
+		static ofRectangle getGameField(const ofRectangle& viewPort);
+
+	private:
+		void threadedFunction();
+		void step(double dt);
+		void updateSegments();
+		void spawnEntities(int segment, float ceilLimit, float floorLimit);
+		void collideEntities(double segmentWidth);
+		void collectEntities();
+		double getTripnoAbsoluteY(double y) const;
+
+		// owned by the simulation thread
+		t_sceneState state;
+		t_config config;
+		ofRectangle viewPort;
+		double signal;
+		entityStore entities;
+
+		// published[0] is the step before published[1], guarded by lock()
+		t_sceneState published[2];
+		unsigned long long startTime;
+
+		// written by the other threads
+		ofMutex inputMutex;
+		t_config nextConfig;
+		ofRectangle nextViewPort;
+		float pendingControl;
+		bool hasPendingControl;
+		uint32_t paused;
+};
@@ -0,0 +1,32 @@
+#include "idleMonitor.h"
+
+//--------------------------------------------------------------
+idleMonitor::idleMonitor() {
+	setup(0, 0, 0);
+}
+
+//--------------------------------------------------------------
+void idleMonitor::setup(double hopSeconds, double timeout, double wakePeak) {
+	this->hopSeconds = hopSeconds;
+	this->timeout = timeout;
+	this->wakePeak = wakePeak;
+	silence = 0;
+	peak = 0;
+	idle = false;
+}
+
+//--------------------------------------------------------------
+bool idleMonitor::listen(float peak) {
+	this->peak = peak;
+	if (idle && peak >= wakePeak) {
+		idle = false;
+		silence = timeout > IDLE_WAKE_GRACE ? timeout - IDLE_WAKE_GRACE : 0;
+	}
+	return !idle;
+}
+
+//--------------------------------------------------------------
+void idleMonitor::update(bool voiced) {
+	silence = voiced && peak >= wakePeak ? 0 : silence + hopSeconds;
+	idle = timeout > 0 && silence >= timeout;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#define IDLE_FRAME_RATE 10 // frames per second while idle
+#define IDLE_POLL_MILLIS 20 // sleeps of the idle main and simulation threads, under one hop
+#define IDLE_WAKE_GRACE 3 // s a wake lasts when no voice follows it
+
+// Tells when nobody is playing, from the audio thread.
+//
+// Idle comes after timeout seconds without a voiced hop. While idle the
+// analysis stops at the level of each hop: the first hop whose peak reaches
+// wakePeak wakes the game, and that same hop is analysed in full. A noise
+// that wakes it without a voice lets it fall idle again IDLE_WAKE_GRACE
+// seconds later. The other threads follow isIdle() within IDLE_POLL_MILLIS.
+class idleMonitor {
+
+	public:
+		idleMonitor();
+
+		// timeout 0 : never idle
+		void setup(double hopSeconds, double timeout, double wakePeak);
+
+		// before the analysis of a hop, with its peak. False when the hop
+		// is quiet and the game idle, the analysis can stop there.
+		bool listen(float peak);
+		// after a hop analysed in full. A pitch quieter than wakePeak does not
+		// count, it could not have woken the game either.
+		void update(bool voiced);
+
+		bool isIdle() const { return idle; }
+
+	private:
+		double hopSeconds;
+		double timeout;
+		double wakePeak;
+
+		double silence;		// s since the last voiced hop
+		float peak;			// of the hop being analysed
+		bool idle;
+};
@@ -1,13 +1,45 @@
 #include "ofMain.h"
 #include "testApp.h"
+#include "renderBench.h"
 
 //========================================================================
-int main( ){
+int main(int argc, char** argv){
+	string traceFile;
+	bool benchmark = false;
+	string benchmarkFile;
+
+	for (int i = 1; i < argc; i++) {
+		// -trace [file] : write the timeline on exit, in builds with TRIPNO_TRACE
+		if (string(argv[i]) == "-trace") {
+			traceFile = i + 1 < argc && argv[i + 1][0] != '-' ? argv[i + 1] : ofToDataPath("trace.json");
+		}
+		// -renderBench [file] : time the drawing offscreen instead of playing
+		if (string(argv[i]) == "-renderBench") {
+			benchmark = true;
+			benchmarkFile = i + 1 < argc && argv[i + 1][0] != '-' ? argv[i + 1] : "";
+		}
+	}
+
+	if (benchmark) {
+#ifdef TARGET_LINUX
+		// Mesa llvmpipe, unless asked otherwise
+		setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+#endif
+		ofSetupOpenGL(RENDER_BENCH_WIDTH, RENDER_BENCH_HEIGHT, OF_WINDOW);
+		ofRunApp(new renderBench(benchmarkFile));
+		return 0;
+	}
+
 	ofSetupOpenGL(1024,768,OF_WINDOW);			// <-------- setup the GL context
 
+	testApp* app = new testApp();
+	if (!traceFile.empty()) {
+		app->setTraceFile(traceFile);
+	}
+
 	// this kicks off the running of my app
 	// can be OF_WINDOW or OF_FULLSCREEN
 	// pass in width and height too:
-	ofRunApp(new testApp());
+	ofRunApp(app);
 
 }
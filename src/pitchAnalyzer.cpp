@@ -0,0 +1,263 @@
+#include "pitchAnalyzer.h"
+#include "traceZones.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+
+//--------------------------------------------------------------
+template<typename T>
+pitchAnalyzer<T>::pitchAnalyzer() {
+	minFreqLog = 100;
+	maxFreqLog = 0;
+	maxSignal = 0;
+	voicedSeconds = 0;
+	lastControl = 0;
+	hasControl = false;
+
+	analysisRate = SAMPLE_RATE;
+	windowSize = 0;
+	hopSize = 0;
+	hopPart = 0;
+	memset(&pitchWindow, 0, sizeof(pitchWindow));
+	pitchWindowMin = pitchWindowMax = pitchWindowSize = 0;
+	pitchInterval = 1;
+	pitchCountdown = 0;
+	heldFreq = 0;
+
+	left = NULL;
+	samples = NULL;
+}
+
+//--------------------------------------------------------------
+template<typename T>
+pitchAnalyzer<T>::~pitchAnalyzer() {
+	delete[] left;
+	delete[] samples;
+	dywapitch_freewindow(&pitchWindow);
+}
+
+//--------------------------------------------------------------
+template<typename T>
+void pitchAnalyzer<T>::setup(const t_config& config) {
+	setConfig(config);
+
+	// analysis runs on the decimated stream when config asks for it
+	int decimation = config.decimation;
+	if (decimation < 1 || AUDIO_BUFFER_SIZE % decimation != 0) {
+		std::cerr << "decimation=" << decimation << " does not divide the audio buffer, disabled" << std::endl;
+		decimation = 1;
+	}
+	decimator.setup(decimation);
+	analysisRate = (double)SAMPLE_RATE / decimation;
+	windowSize = AUDIO_BUFFER_SIZE / decimation;
+
+	delete[] left;
+	delete[] samples;
+	left = new float[AUDIO_BUFFER_SIZE];
+	samples = new T[AUDIO_BUFFER_SIZE];
+	memset(left, 0, sizeof(float) * AUDIO_BUFFER_SIZE);
+
+	// analysis window slides by one hop per process()
+	dywapitch_freewindow(&pitchWindow);
+	dywapitch_initwindowtype(&pitchWindow, windowSize, analysisRate, sampleTraits<T>::pitchType);
+
+	// window bounds come at 44100 Hz, 0 or out of range - the whole window
+	// and as many samples as dywapitch takes for them
+	pitchWindowMax = config.windowMax > 0 && config.windowMax < AUDIO_BUFFER_SIZE ? config.windowMax / decimation : windowSize;
+	pitchWindowMax = dywapitch_recentsamplecount(&pitchWindow, pitchWindowMax);
+	pitchWindowMin = config.windowMin > 0 ? std::min(config.windowMin / decimation, pitchWindowMax) : pitchWindowMax;
+	pitchWindowMin = dywapitch_recentsamplecount(&pitchWindow, pitchWindowMin);
+	pitchWindowSize = pitchWindowMax;
+	pitchCountdown = 0;
+	heldFreq = 0;
+}
+
+//--------------------------------------------------------------
+template<typename T>
+void pitchAnalyzer<T>::setConfig(const t_config& config) {
+	this->config = config;
+}
+
+//--------------------------------------------------------------
+template<typename T>
+t_analysis pitchAnalyzer<T>::process(const float* input, int bufferSize, int nChannels) {
+	TRACE_ZONE("analysis");
+	t_analysis result = t_analysis();
+
+	gate(input, bufferSize, nChannels, result);
+	pitch(result);
+	mapRange(result);
+	smooth(result);
+	return result;
+}
+
+//--------------------------------------------------------------
+template<typename T>
+void pitchAnalyzer<T>::gate(const float* input, int bufferSize, int nChannels, t_analysis& result) {
+	const bool decimate = decimator.getFactor() > 1;
+	hopSize = bufferSize / decimator.getFactor();
+
+	// Clamp rates are given per analysis window, windows overlap
+	hopPart = (double)bufferSize / AUDIO_BUFFER_SIZE;
+	const double maxSignalClampRate = pow(config.maxSignalClampRate, hopPart);
+
+	// Slide the fft window by one hop, the new samples go to its end
+	memmove(left, left + hopSize, sizeof(float) * (windowSize - hopSize));
+	float* hop = left + windowSize - hopSize;
+
+	// Deinterleave the left channel, find max signal and gate it
+	// with a part of maxSignal value in one pass.
+	result.peak = audioFrontend(input, bufferSize, nChannels, 0,
+		maxSignal, maxSignalClampRate, config.gateThreshold,
+		samples, decimate ? NULL : hop);
+
+	// Low-pass and drop to the analysis rate, the pitch tracker
+	// then works on the smaller buffer.
+	if (decimate) {
+		TRACE_ZONE("decimate");
+		decimator.process(samples, bufferSize, samples, hop);
+	}
+}
+
+//--------------------------------------------------------------
+template<typename T>
+void pitchAnalyzer<T>::pitch(t_analysis& result) {
+	// Get pitch, only the new hop is analysed, the rest of the
+	// window is reused from the previous calls
+	sampleTraits<T>::pushPitch(&pitchWindow, samples, 0, hopSize);
+
+	// between estimates the hop still enters the window, the pitch is held
+	if (--pitchCountdown <= 0) {
+		dywapitchtracker pitchtracker;
+		dywapitch_inittracking(&pitchtracker);
+		dywapitch_setsamplerate(&pitchtracker, analysisRate);
+		heldFreq = std::max(0.0, dywapitch_computerecentpitch(&pitchtracker, &pitchWindow, pitchWindowSize));
+		pitchCountdown = pitchInterval;
+		sizePitchWindow();
+	}
+
+	result.freq = heldFreq;
+	result.freqLog = result.freq > 0 ? log(result.freq) : 0;
+}
+
+//--------------------------------------------------------------
+template<typename T>
+void pitchAnalyzer<T>::skipPitch(t_analysis& result) {
+	sampleTraits<T>::pushPitch(&pitchWindow, samples, 0, hopSize);
+
+	// no held pitch, the next pitch() estimates at once
+	pitchCountdown = 0;
+	heldFreq = 0;
+	pitchWindowSize = pitchWindowMax;
+	result.freq = 0;
+	result.freqLog = 0;
+}
+
+//--------------------------------------------------------------
+template<typename T>
+void pitchAnalyzer<T>::sizePitchWindow() {
+	// lost: the whole window, whatever the voice comes back at
+	if (heldFreq <= 0) {
+		pitchWindowSize = pitchWindowMax;
+		return;
+	}
+
+	double lowest = heldFreq;
+	if (minFreqLog <= maxFreqLog) {
+		lowest = std::min(lowest, exp(minFreqLog));
+	}
+	lowest /= PITCH_WINDOW_MARGIN;
+
+	// dywapitch_neededsamplecount is for 44100 Hz
+	int needed = dywapitch_neededsamplecount(std::max(1, (int)lowest)) * analysisRate / SAMPLE_RATE;
+	needed = dywapitch_recentsamplecount(&pitchWindow, std::max(pitchWindowMin, std::min(pitchWindowMax, needed)));
+
+	if (needed > pitchWindowSize) {
+		pitchWindowSize = needed;
+	}
+	else if (needed < pitchWindowSize) {
+		pitchWindowSize = std::max(needed, pitchWindowSize / 2);
+	}
+}
+
+//--------------------------------------------------------------
+template<typename T>
+void pitchAnalyzer<T>::mapRange(t_analysis& result) {
+	const double rangeClampRate = pow(1.0 + config.rangeClampRate, hopPart) - 1.0;
+	const double freqLog = result.freqLog;
+	double delta = 0;
+
+	// Calculate delata (control signal)
+	if (result.freq > 0)
+	{
+		if (freqLog < minFreqLog) {
+			minFreqLog = freqLog;
+		}
+		else {
+			minFreqLog *= 1.0 + rangeClampRate;
+		}
+
+		if (freqLog > maxFreqLog) {
+			maxFreqLog = freqLog;
+		}
+		else {
+			maxFreqLog *= 1.0 - rangeClampRate;
+		}
+
+		double centralFreqLog = (minFreqLog + maxFreqLog) /2;
+		voicedSeconds += hopPart * AUDIO_BUFFER_SIZE / SAMPLE_RATE;
+
+		delta = freqLog - centralFreqLog;
+	}
+
+	result.control = delta;
+}
+
+//--------------------------------------------------------------
+template<typename T>
+t_calibration pitchAnalyzer<T>::getCalibration() const {
+	t_calibration calibration;
+	calibration.minFreqLog = minFreqLog;
+	calibration.maxFreqLog = maxFreqLog;
+	calibration.maxSignal = maxSignal;
+	calibration.voicedSeconds = voicedSeconds;
+	return calibration;
+}
+
+//--------------------------------------------------------------
+template<typename T>
+void pitchAnalyzer<T>::setCalibration(const t_calibration& calibration) {
+	minFreqLog = calibration.minFreqLog;
+	maxFreqLog = calibration.maxFreqLog;
+	maxSignal = calibration.maxSignal;
+	voicedSeconds = calibration.voicedSeconds;
+	hasControl = false;
+}
+
+//--------------------------------------------------------------
+template<typename T>
+void pitchAnalyzer<T>::smooth(t_analysis& result) {
+	// unvoiced hops stay 0, the next voiced one is averaged with that
+	if (result.freq > 0) {
+		result.control = smoothSignal(result.control);
+	}
+
+	lastControl = result.control;
+	hasControl = true;
+}
+
+//--------------------------------------------------------------
+template<typename T>
+float pitchAnalyzer<T>::smoothSignal(float rawVal) {
+	if (!hasControl) {
+		return rawVal;
+	}
+
+	return (lastControl + rawVal) / 2.0f;
+}
+
+template class pitchAnalyzer<double>;
+template class pitchAnalyzer<float>;
+template class pitchAnalyzer<int16_t>;
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "tripnoConfig.h"
+#include "dywapitchtrack.h"
+#include "audioFrontend.h"
+#include "decimator.h"
+#include "sampleTypes.h"
+#include "calibration.h"
+
+#define SAMPLE_RATE 44100
+#define AUDIO_BUFFER_SIZE 4096 // analysis window
+#define AUDIO_HOP_SIZE 1024 // samples per audioIn, windows overlap by the rest
+#define MIN_VOICE_FREQ 40
+#define MAX_VOICE_FREQ 3000
+#define PITCH_WINDOW_MARGIN 2 // the window reaches an octave below the tracked pitch
+
+// result of one hop
+struct t_analysis {
+	double freq;	// Hz, 0 when no pitch
+	double freqLog;	// 0 when no pitch
+	float control;	// smoothed offset of freqLog from the middle of the tracked range
+	float peak;		// peak |x| of the hop
+};
+
+// The audio analysis chain behind testApp::audioIn: gate, decimation,
+// pitch tracking, adaptive range mapping and smoothing. Free of
+// openFrameworks so the headless tools can run it too.
+// T is the sample type the chain runs in after the front-end: double,
+// float or int16_t (see sampleTypes.h).
+//
+// The pitch is tracked on the newest part of the analysis window only, as
+// much as dywapitch needs for the lowest of the tracked range and the last
+// pitch, with PITCH_WINDOW_MARGIN below it, within windowMin and windowMax
+// of config. Sizes are rounded the way dywapitch takes them
+// (dywapitch_recentsamplecount): a power of 2, no less than 128 samples
+// undecimated, 256 at 44100 Hz with decimation 4. The getters give the
+// rounded sizes. High voices get a short window: less cpu, and the estimate
+// sits closer to the end of the hop. It grows at once when the pitch drops
+// below what it covers or is lost, and shrinks one halving per estimate.
+template<typename T>
+class pitchAnalyzer {
+
+	public:
+		pitchAnalyzer();
+		~pitchAnalyzer();
+
+		// allocates buffers, the decimation factor is taken from config here only
+		void setup(const t_config& config);
+		// gate and range parameters, can change between hops
+		void setConfig(const t_config& config);
+		// hops per pitch estimate, the pitch is held in between (see qualityGovernor.h)
+		void setPitchInterval(int hops) { pitchInterval = hops > 1 ? hops : 1; }
+
+		// all the stages below, in order
+		t_analysis process(const float* input, int bufferSize, int nChannels);
+
+		// The stages one by one, for callers that only need some of them
+		// (see dspGraph.h). Each fills its part of result. A stage skipped
+		// for a while leaves the ones after it a window of stale state.
+
+		// peak, the gated and decimated hop into the analysis window
+		void gate(const float* input, int bufferSize, int nChannels, t_analysis& result);
+		// freq and freqLog of the window
+		void pitch(t_analysis& result);
+		// instead of pitch() while idle: the hop only enters the pitch window,
+		// so the next pitch() sees the window it would have had
+		void skipPitch(t_analysis& result);
+		// control as the offset of freqLog from the middle of the tracked range
+		void mapRange(t_analysis& result);
+		// control averaged with the previous one
+		void smooth(t_analysis& result);
+
+		// gated analysis window as float (for the spectral stage), oldest sample first
+		float* getSignal() { return left; }
+		int getWindowSize() const { return windowSize; }
+		// samples of the window the last pitch was tracked on
+		int getPitchWindowSize() const { return pitchWindowSize; }
+		// its bounds, as dywapitch takes them
+		int getPitchWindowMin() const { return pitchWindowMin; }
+		int getPitchWindowMax() const { return pitchWindowMax; }
+		double getAnalysisRate() const { return analysisRate; }
+
+		double getMinFreqLog() const { return minFreqLog; }
+		double getMaxFreqLog() const { return maxFreqLog; }
+
+		// the tracked range and input peak, to carry a player over sessions
+		t_calibration getCalibration() const;
+		// takes over from the next hop, the smoothing starts afresh
+		void setCalibration(const t_calibration& calibration);
+
+	private:
+		t_config config;
+
+		double minFreqLog;
+		double maxFreqLog;
+		double maxSignal;
+		double voicedSeconds;
+		float lastControl;
+		bool hasControl;
+
+		polyphaseDecimator<T> decimator;
+		double analysisRate;
+		int windowSize;
+		int hopSize;		// of the last gate(), at the analysis rate
+		double hopPart;		// of the analysis window
+		dywapitchwindow pitchWindow;
+		int pitchWindowMin;	// at the analysis rate
+		int pitchWindowMax;
+		int pitchWindowSize;
+		int pitchInterval;
+		int pitchCountdown;	// hops until the next estimate
+		double heldFreq;
+
+		// analysis channel: float for the fft, T for the pitch tracker
+		float* left;
+		T* samples;
+
+		float smoothSignal(float rawVal);
+		// the pitch window for the next estimate
+		void sizePitchWindow();
+};
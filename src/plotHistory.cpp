@@ -0,0 +1,97 @@
+#include "plotHistory.h"
+
+#include <cstring>
+#include <algorithm>
+
+//--------------------------------------------------------------
+// the count newest of a ring of size items, next written at next, oldest
+// first into out
+static void copyRing(const float* ring, int size, int count, int next, int stride, float* out) {
+	if (count == 0) {
+		return;
+	}
+	const int first = (next - count + size) % size;
+	const int head = std::min(count, size - first);
+	memcpy(out, ring + first * stride, sizeof(float) * head * stride);
+	memcpy(out + head * stride, ring, sizeof(float) * (count - head) * stride);
+}
+
+//--------------------------------------------------------------
+plotHistory::plotHistory() {
+	spectrum = NULL;
+	pitches = NULL;
+	control = NULL;
+	lines = bands = points = 0;
+	lineCount = lineNext = 0;
+	pointCount = pointNext = 0;
+}
+
+//--------------------------------------------------------------
+plotHistory::~plotHistory() {
+	release();
+}
+
+//--------------------------------------------------------------
+void plotHistory::release() {
+	delete[] spectrum;
+	delete[] pitches;
+	delete[] control;
+	spectrum = pitches = control = NULL;
+}
+
+//--------------------------------------------------------------
+void plotHistory::setup(int lines, int bands, int points) {
+	release();
+
+	this->lines = std::max(lines, 1);
+	this->bands = std::max(bands, 1);
+	this->points = std::max(points, 1);
+	spectrum = new float[this->lines * this->bands];
+	pitches = new float[this->points];
+	control = new float[this->points];
+	lineCount = lineNext = 0;
+	pointCount = pointNext = 0;
+}
+
+//--------------------------------------------------------------
+void plotHistory::pushLine(const float* amplitudes) {
+	float* line = spectrum + lineNext * bands;
+	const float maxAmp = *std::max_element(amplitudes, amplitudes + bands);
+	for (int i = 0; i < bands; i++) {
+		line[i] = maxAmp > 0 ? amplitudes[i] / maxAmp : amplitudes[i];
+	}
+
+	lineNext = (lineNext + 1) % lines;
+	lineCount = std::min(lineCount + 1, lines);
+}
+
+//--------------------------------------------------------------
+void plotHistory::pushPoint(float freqLog, float control) {
+	pitches[pointNext] = freqLog;
+	this->control[pointNext] = control;
+
+	pointNext = (pointNext + 1) % points;
+	pointCount = std::min(pointCount + 1, points);
+}
+
+//--------------------------------------------------------------
+t_plotFrame plotHistory::copy(frameArena& arena, bool withSpectrum) const {
+	t_plotFrame frame;
+	frame.bands = bands;
+	frame.lines = withSpectrum ? lineCount : 0;
+	frame.points = pointCount;
+
+	float* out = arena.allocate<float>(frame.lines * bands);
+	copyRing(spectrum, lines, frame.lines, lineNext, bands, out);
+	frame.spectrum = out;
+
+	out = arena.allocate<float>(pointCount);
+	copyRing(pitches, points, pointCount, pointNext, 1, out);
+	frame.pitches = out;
+
+	out = arena.allocate<float>(pointCount);
+	copyRing(control, points, pointCount, pointNext, 1, out);
+	frame.control = out;
+
+	return frame;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "frameArena.h"
+
+// What the analysis plots draw, as flat arrays, oldest first.
+struct t_plotFrame {
+	const float* spectrum;	// lines of bands each
+	int lines;
+	int bands;
+	const float* pitches;	// log frequency
+	const float* control;
+	int points;
+};
+
+// The spectrogram lines and the pitch and control history of the plots,
+// in rings allocated once by setup(). The audio thread pushes, draw()
+// copies a frame into its frameArena; the caller holds the lock between
+// the two. Once full, the oldest line or point is overwritten. Free of
+// openFrameworks.
+class plotHistory {
+
+	public:
+		plotHistory();
+		~plotHistory();
+
+		// lines of bands each, points of pitch and control
+		void setup(int lines, int bands, int points);
+
+		// amplitudes of the bands, scaled to the strongest one
+		void pushLine(const float* amplitudes);
+		void pushPoint(float freqLog, float control);
+
+		// no spectrogram lines without withSpectrum
+		t_plotFrame copy(frameArena& arena, bool withSpectrum) const;
+
+		int getBands() const { return bands; }
+
+	private:
+		void release();
+
+		float* spectrum;
+		int lines;
+		int bands;
+		int lineCount;
+		int lineNext;
+
+		float* pitches;
+		float* control;
+		int points;
+		int pointCount;
+		int pointNext;
+};
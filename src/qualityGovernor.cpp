@@ -0,0 +1,106 @@
+#include "qualityGovernor.h"
+
+#include <algorithm>
+
+static const char* tierNames[TIER_COUNT] = {
+	"full", "noSpectrum", "halfPitch", "quarterPitch"
+};
+
+//--------------------------------------------------------------
+qualityGovernor::qualityGovernor() {
+	setup(0, false, true);
+}
+
+//--------------------------------------------------------------
+void qualityGovernor::setup(double hopSeconds, bool enabled, bool spectrum) {
+	this->enabled = enabled;
+	spectrumStage = spectrum;
+	this->hopSeconds = hopSeconds;
+	load = 0;
+	tier = TIER_FULL;
+	sinceChange = 0;
+	lowHops = 0;
+	holdHops = GOVERNOR_HOLD_HOPS;
+	rose = false;
+}
+
+//--------------------------------------------------------------
+void qualityGovernor::update(double workSeconds, double intervalSeconds) {
+	if (hopSeconds <= 0) {
+		return;
+	}
+
+	double hopLoad = workSeconds / hopSeconds;
+	load += (hopLoad - load) / GOVERNOR_AVERAGE_HOPS;
+	sinceChange++;
+
+	if (!enabled) {
+		return;
+	}
+
+	// a late callback means the input queue is running dry, whoever made it late
+	bool overrun = hopLoad > GOVERNOR_OVERRUN || intervalSeconds > GOVERNOR_LATE * hopSeconds;
+
+	if ((overrun || load > GOVERNOR_HIGH_LOAD) && sinceChange >= GOVERNOR_SETTLE_HOPS
+		&& stepTier(1) != tier) {
+
+		// the tier we rose to did not hold, wait longer before trying it again
+		if (rose && sinceChange < holdHops) {
+			holdHops = std::min(holdHops * 2, GOVERNOR_MAX_HOLD_HOPS);
+		}
+		setTier(stepTier(1));
+		rose = false;
+		return;
+	}
+
+	lowHops = load < GOVERNOR_LOW_LOAD ? lowHops + 1 : 0;
+
+	// a rise that lasted : the next one may come sooner
+	if (rose && sinceChange == holdHops) {
+		holdHops = std::max(holdHops / 2, GOVERNOR_HOLD_HOPS);
+	}
+
+	if (lowHops >= holdHops && tier > TIER_FULL) {
+		setTier(stepTier(-1));
+		rose = true;
+	}
+}
+
+//--------------------------------------------------------------
+void qualityGovernor::setTier(qualityTier next) {
+	tier = next;
+	sinceChange = 0;
+	lowHops = 0;
+}
+
+//--------------------------------------------------------------
+void qualityGovernor::setSpectrumStage(bool spectrum) {
+	spectrumStage = spectrum;
+	if (!spectrumStage && tier == TIER_NO_SPECTRUM) {
+		// the same cost as full now
+		tier = TIER_FULL;
+	}
+}
+
+//--------------------------------------------------------------
+qualityTier qualityGovernor::stepTier(int step) const {
+	int next = tier + step;
+	if (next == TIER_NO_SPECTRUM && !spectrumStage) {
+		next += step;
+	}
+	return next >= TIER_FULL && next < TIER_COUNT ? (qualityTier)next : tier;
+}
+
+//--------------------------------------------------------------
+int qualityGovernor::getPitchInterval() const {
+	switch (tier) {
+		case TIER_HALF_PITCH: return 2;
+		case TIER_QUARTER_PITCH: return 4;
+		default: return 1;
+	}
+}
+
+//--------------------------------------------------------------
+const char* qualityGovernor::tierName(qualityTier tier) {
+	return tier >= 0 && tier < TIER_COUNT ? tierNames[tier] : "?";
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+// Analysis quality tiers, from the best to the cheapest. Each tier keeps
+// what the one above it skips:
+//
+//   full          every stage on every hop
+//   noSpectrum    fft and spectral gate paused, the spectrogram stops
+//   halfPitch     + pitch tracked on every second hop, held in between
+//   quarterPitch  + pitch tracked on every fourth hop
+//
+// The samples still enter the pitch window on every hop, so a skipped hop
+// only delays the next pitch, it does not lose it. The held pitch adds up to
+// (interval - 1) hops of lag, 23 ms each. Without a spectral stage there is
+// nothing for noSpectrum to pause, and the governor steps over it.
+enum qualityTier {
+	TIER_FULL,
+	TIER_NO_SPECTRUM,
+	TIER_HALF_PITCH,
+	TIER_QUARTER_PITCH,
+	TIER_COUNT
+};
+
+#define GOVERNOR_HIGH_LOAD 0.5 // of the hop period, average above which the tier drops
+#define GOVERNOR_LOW_LOAD 0.15 // average below which the tier may rise
+#define GOVERNOR_OVERRUN 0.9 // a single hop above this drops the tier at once
+#define GOVERNOR_LATE 2.0 // hop periods between callbacks that count as an overrun
+#define GOVERNOR_AVERAGE_HOPS 16 // load averaging time constant
+#define GOVERNOR_SETTLE_HOPS 8 // after a change, before the next drop
+#define GOVERNOR_HOLD_HOPS 172 // ~4 s below the low load before rising
+#define GOVERNOR_MAX_HOLD_HOPS 2752 // a tier that keeps failing is retried at most every ~1 min
+
+// Watches the time audioIn takes against the hop period and picks the
+// quality tier of the next hop. Drops a tier when the averaged load is high
+// or a hop overruns, rises one when the load stayed low for a while. A rise
+// undone within the hold time doubles the hold time, one that lasts halves
+// it back, so a tier that does not fit is not retried every few seconds.
+//
+// Called from the audio thread only.
+class qualityGovernor {
+
+	public:
+		qualityGovernor();
+
+		// hopSeconds : audio per callback. Disabled, the tier stays full.
+		// spectrum : the fft runs for an enabled consumer (see dspGraph.h)
+		void setup(double hopSeconds, bool enabled, bool spectrum);
+		// the graph changed, noSpectrum is left if it saves nothing now
+		void setSpectrumStage(bool spectrum);
+
+		// once per callback : time spent in it, and since the previous one began
+		void update(double workSeconds, double intervalSeconds);
+
+		qualityTier getTier() const { return tier; }
+		// averaged part of the hop period spent in audioIn
+		double getLoad() const { return load; }
+
+		bool hasSpectrum() const { return tier < TIER_NO_SPECTRUM; }
+		// hops per pitch estimate
+		int getPitchInterval() const;
+
+		static const char* tierName(qualityTier tier);
+
+	private:
+		void setTier(qualityTier next);
+		// the next tier down (step 1) or up (-1) that saves something
+		qualityTier stepTier(int step) const;
+
+		bool enabled;
+		bool spectrumStage;
+		double hopSeconds;
+		double load;
+		qualityTier tier;
+
+		int sinceChange;	// hops at the current tier
+		int lowHops;		// consecutive hops below the low load
+		int holdHops;		// low hops needed to rise
+		bool rose;			// the current tier was reached by a rise
+};
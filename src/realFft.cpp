@@ -0,0 +1,206 @@
+#include "realFft.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FFT_SSE2
+#include <emmintrin.h>
+#endif
+
+//--------------------------------------------------------------
+realFft::realFft() {
+	size = half = 0;
+	source = NULL;
+	windowRe = windowIm = NULL;
+	twiddleRe = twiddleIm = NULL;
+	splitRe = splitIm = NULL;
+	scratch = NULL;
+}
+
+//--------------------------------------------------------------
+realFft::~realFft() {
+	release();
+}
+
+//--------------------------------------------------------------
+void realFft::release() {
+	delete[] source;
+	delete[] windowRe;
+	delete[] windowIm;
+	delete[] twiddleRe;
+	delete[] twiddleIm;
+	delete[] splitRe;
+	delete[] splitIm;
+	delete[] scratch;
+	source = NULL;
+	windowRe = windowIm = twiddleRe = twiddleIm = splitRe = splitIm = scratch = NULL;
+}
+
+//--------------------------------------------------------------
+void realFft::setup(int size, fftWindow window) {
+	release();
+	this->size = size;
+	half = size / 2;
+
+	int bits = 0;
+	while ((1 << bits) < half) {
+		bits++;
+	}
+
+	// bit reversed order of the complex points, with their window
+	source = new int[half];
+	windowRe = new float[half];
+	windowIm = new float[half];
+	for (int j = 0; j < half; j++) {
+		int reversed = 0;
+		for (int b = 0; b < bits; b++) {
+			reversed |= ((j >> b) & 1) << (bits - 1 - b);
+		}
+		source[j] = reversed * 2;
+
+		for (int part = 0; part < 2; part++) {
+			int n = source[j] + part;
+			float w = window == FFT_WINDOW_HANN ? 0.5f - 0.5f * (float)cos(2 * M_PI * n / size) : 1.0f;
+			(part ? windowIm : windowRe)[j] = w;
+		}
+	}
+
+	// the twiddles of every stage in a row, so the butterflies read them in order
+	twiddleRe = new float[half];
+	twiddleIm = new float[half];
+	for (int span = 1; span < half; span *= 2) {
+		for (int j = 0; j < span; j++) {
+			twiddleRe[span - 1 + j] = (float)cos(M_PI * j / span);
+			twiddleIm[span - 1 + j] = (float)-sin(M_PI * j / span);
+		}
+	}
+
+	splitRe = new float[half + 1];
+	splitIm = new float[half + 1];
+	for (int k = 0; k <= half; k++) {
+		splitRe[k] = (float)cos(2 * M_PI * k / size);
+		splitIm[k] = (float)-sin(2 * M_PI * k / size);
+	}
+
+	scratch = new float[size];
+}
+
+//--------------------------------------------------------------
+void realFft::transform(const float* input, float* output) {
+	if (input == output) {
+		memcpy(scratch, input, sizeof(float) * size);
+		input = scratch;
+	}
+
+	float* re = output;
+	float* im = output + half;
+	for (int j = 0; j < half; j++) {
+		re[j] = input[source[j]] * windowRe[j];
+		im[j] = input[source[j] + 1] * windowIm[j];
+	}
+
+	butterflies(re, im);
+}
+
+//--------------------------------------------------------------
+void realFft::butterflies(float* re, float* im) const {
+	for (int span = 1; span < half; span *= 2) {
+		const float* wr = twiddleRe + span - 1;
+		const float* wi = twiddleIm + span - 1;
+
+		for (int group = 0; group < half; group += span * 2) {
+			float* aRe = re + group;
+			float* aIm = im + group;
+			float* bRe = aRe + span;
+			float* bIm = aIm + span;
+			int j = 0;
+
+#ifdef FFT_SSE2
+			for (; j + 4 <= span; j += 4) {
+				__m128 xr = _mm_loadu_ps(bRe + j);
+				__m128 xi = _mm_loadu_ps(bIm + j);
+				__m128 cr = _mm_loadu_ps(wr + j);
+				__m128 ci = _mm_loadu_ps(wi + j);
+				__m128 tr = _mm_sub_ps(_mm_mul_ps(xr, cr), _mm_mul_ps(xi, ci));
+				__m128 ti = _mm_add_ps(_mm_mul_ps(xr, ci), _mm_mul_ps(xi, cr));
+
+				__m128 yr = _mm_loadu_ps(aRe + j);
+				__m128 yi = _mm_loadu_ps(aIm + j);
+				_mm_storeu_ps(bRe + j, _mm_sub_ps(yr, tr));
+				_mm_storeu_ps(bIm + j, _mm_sub_ps(yi, ti));
+				_mm_storeu_ps(aRe + j, _mm_add_ps(yr, tr));
+				_mm_storeu_ps(aIm + j, _mm_add_ps(yi, ti));
+			}
+#endif
+
+			for (; j < span; j++) {
+				float tr = bRe[j] * wr[j] - bIm[j] * wi[j];
+				float ti = bRe[j] * wi[j] + bIm[j] * wr[j];
+				bRe[j] = aRe[j] - tr;
+				bIm[j] = aIm[j] - ti;
+				aRe[j] += tr;
+				aIm[j] += ti;
+			}
+		}
+	}
+}
+
+//--------------------------------------------------------------
+void realFft::amplitude(const float* transformed, float* amplitudes, int from, int to) const {
+	const float* re = transformed;
+	const float* im = transformed + half;
+	if (to > half + 1) {
+		to = half + 1;
+	}
+
+	// X[k] = E[k] + w^k O[k] with E, O the spectra of the even and odd
+	// samples: E = (Z[k] + Z*[half - k]) / 2, O = -i (Z[k] - Z*[half - k]) / 2
+	int k = from < 0 ? 0 : from;
+
+	if (k == 0 && k < to) {
+		amplitudes[0] = fabs(re[0] + im[0]);
+		k++;
+	}
+
+#ifdef FFT_SSE2
+	const __m128 halfScale = _mm_set1_ps(0.5f);
+	for (; k + 4 <= to && k + 3 < half; k += 4) {
+		const int m = half - k - 3;
+		__m128 zr = _mm_loadu_ps(re + k);
+		__m128 zi = _mm_loadu_ps(im + k);
+		// Z[half - k] for the four k, in their order
+		__m128 cr = _mm_shuffle_ps(_mm_loadu_ps(re + m), _mm_loadu_ps(re + m), _MM_SHUFFLE(0, 1, 2, 3));
+		__m128 ci = _mm_shuffle_ps(_mm_loadu_ps(im + m), _mm_loadu_ps(im + m), _MM_SHUFFLE(0, 1, 2, 3));
+
+		// conjugate : ci changes sign, folded into the sums below
+		__m128 er = _mm_mul_ps(_mm_add_ps(zr, cr), halfScale);
+		__m128 ei = _mm_mul_ps(_mm_sub_ps(zi, ci), halfScale);
+		__m128 or_ = _mm_mul_ps(_mm_add_ps(zi, ci), halfScale);
+		__m128 oi = _mm_mul_ps(_mm_sub_ps(cr, zr), halfScale);
+
+		__m128 wr = _mm_loadu_ps(splitRe + k);
+		__m128 wi = _mm_loadu_ps(splitIm + k);
+		__m128 xr = _mm_add_ps(er, _mm_sub_ps(_mm_mul_ps(wr, or_), _mm_mul_ps(wi, oi)));
+		__m128 xi = _mm_add_ps(ei, _mm_add_ps(_mm_mul_ps(wr, oi), _mm_mul_ps(wi, or_)));
+
+		_mm_storeu_ps(amplitudes + k, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(xr, xr), _mm_mul_ps(xi, xi))));
+	}
+#endif
+
+	for (; k < to && k < half; k++) {
+		const int m = half - k;
+		float er = (re[k] + re[m]) * 0.5f;
+		float ei = (im[k] - im[m]) * 0.5f;
+		float or_ = (im[k] + im[m]) * 0.5f;
+		float oi = (re[m] - re[k]) * 0.5f;
+
+		float xr = er + splitRe[k] * or_ - splitIm[k] * oi;
+		float xi = ei + splitRe[k] * oi + splitIm[k] * or_;
+		amplitudes[k] = sqrt(xr * xr + xi * xi);
+	}
+
+	if (k == half && k < to) {
+		amplitudes[half] = fabs(re[0] - im[0]);
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+enum fftWindow {
+	FFT_WINDOW_RECTANGULAR,
+	FFT_WINDOW_HANN
+};
+
+// Forward FFT of a real signal, planned once at setup().
+//
+// The size real samples are taken as size / 2 complex ones (even samples
+// real, odd imaginary), transformed with radix-2 butterflies, four at a time
+// with SSE, and the real spectrum is split out of that only for the bins
+// asked for. The bit reversal, window and twiddles are tables of the plan,
+// so a transform allocates nothing. Free of openFrameworks.
+//
+// Amplitudes are not normalized: a full scale sine at a bin centre gives
+// size / 2.
+class realFft {
+
+	public:
+		realFft();
+		~realFft();
+
+		// size : power of 2, at least 16
+		void setup(int size, fftWindow window);
+
+		// Windows and transforms size samples of input into output, which may
+		// be input. output then holds the half size complex transform,
+		// real parts first, for amplitude().
+		void transform(const float* input, float* output);
+
+		// |X[k]| for the bins [from, to) of a transformed buffer, into
+		// amplitudes[from, to). Bins go up to getBinSize() - 1 (Nyquist).
+		void amplitude(const float* transformed, float* amplitudes, int from, int to) const;
+
+		int getSize() const { return size; }
+		int getBinSize() const { return size / 2 + 1; }
+
+	private:
+		void release();
+		void butterflies(float* re, float* im) const;
+
+		int size;
+		int half;			// complex points
+
+		int* source;		// input index of each complex point, bit reversed
+		float* windowRe;	// window at source[j], and at source[j] + 1
+		float* windowIm;
+		float* twiddleRe;	// per stage of span s, s entries from offset s - 1
+		float* twiddleIm;
+		float* splitRe;		// e^(-2 pi i k / size), k in [0, half]
+		float* splitIm;
+		float* scratch;		// the input when transformed in place
+};
@@ -0,0 +1,255 @@
+#include "renderBench.h"
+
+#include <cstdio>
+#include <cmath>
+
+#define RENDER_BENCH_ROUTINES 3
+#define RENDER_BENCH_HISTORY_ENTITIES 64 // entities while the history is swept
+
+static const char* routineNames[RENDER_BENCH_ROUTINES] = { "plotSpectrum", "drawScene", "drawSceneDebug" };
+
+static const int histories[] = { 128, 256, 512, SPECTRUM_HISTORY };
+static const int entityCounts[] = { 0, 64, 128, SCENE_MAX_ENTITIES };
+
+//--------------------------------------------------------------
+countingRenderer::countingRenderer() {
+	drawCalls = 0;
+	vertices = 0;
+	circleResolution = 20;
+}
+
+//--------------------------------------------------------------
+void countingRenderer::drawLine(float x1, float y1, float z1, float x2, float y2, float z2) {
+	drawCalls++;
+	vertices += 2;
+	ofGLRenderer::drawLine(x1, y1, z1, x2, y2, z2);
+}
+
+//--------------------------------------------------------------
+void countingRenderer::drawRectangle(float x, float y, float z, float w, float h) {
+	drawCalls++;
+	vertices += 4;
+	ofGLRenderer::drawRectangle(x, y, z, w, h);
+}
+
+//--------------------------------------------------------------
+void countingRenderer::drawCircle(float x, float y, float z, float radius) {
+	drawCalls++;
+	vertices += circleResolution;
+	ofGLRenderer::drawCircle(x, y, z, radius);
+}
+
+//--------------------------------------------------------------
+void countingRenderer::drawString(string text, float x, float y, float z, ofDrawBitmapMode mode) {
+	drawCalls++;
+	vertices += 4 * text.size();
+	ofGLRenderer::drawString(text, x, y, z, mode);
+}
+
+//--------------------------------------------------------------
+void countingRenderer::setCircleResolution(int resolution) {
+	circleResolution = resolution;
+	ofGLRenderer::setCircleResolution(resolution);
+}
+
+//--------------------------------------------------------------
+renderBench::renderBench(const std::string& path) {
+	this->path = path;
+	file = NULL;
+	hasTimer = false;
+	query = 0;
+	plot = t_plotFrame();
+}
+
+//--------------------------------------------------------------
+void renderBench::setup() {
+	ofSetVerticalSync(false);
+
+	renderer = ofPtr<countingRenderer>(new countingRenderer());
+	ofSetCurrentRenderer(renderer, true);
+	ofSetCircleResolution(6);
+
+	fbo.allocate(RENDER_BENCH_WIDTH, RENDER_BENCH_HEIGHT, GL_RGBA);
+	scene.setViewPort(ofRectangle(0, 0, RENDER_BENCH_WIDTH, RENDER_BENCH_HEIGHT));
+
+	ofLogNotice() << "renderBench: " << (const char*)glGetString(GL_RENDERER) << ", " << (const char*)glGetString(GL_VERSION);
+
+#if defined(GL_TIME_ELAPSED) && !defined(TARGET_OPENGLES)
+	hasTimer = GLEW_ARB_timer_query || GLEW_VERSION_3_3;
+	if (hasTimer) {
+		glGenQueries(1, &query);
+	}
+#endif
+	if (!hasTimer) {
+		ofLogWarning() << "renderBench: no GL timer queries, gpu time is not measured";
+	}
+
+	if (!path.empty()) {
+		file = fopen(path.c_str(), "w");
+		if (file) {
+			fprintf(file, "history,entities,routine,cpuMicros,gpuMicros,drawCalls,vertices\n");
+		}
+		else {
+			ofLogWarning() << "renderBench: cannot write " << path;
+		}
+	}
+
+	ofLogNotice() << "renderBench: history entities routine cpu us gpu us draws vertices, per frame";
+	for (size_t i = 0; i < sizeof(histories) / sizeof(histories[0]); i++) {
+		run(histories[i], RENDER_BENCH_HISTORY_ENTITIES);
+	}
+	for (size_t i = 0; i < sizeof(entityCounts) / sizeof(entityCounts[0]); i++) {
+		run(SPECTRUM_HISTORY, entityCounts[i]);
+	}
+
+	if (file) {
+		fclose(file);
+		ofLogNotice() << "renderBench: written to " << path;
+	}
+
+#if defined(GL_TIME_ELAPSED) && !defined(TARGET_OPENGLES)
+	if (hasTimer) {
+		glDeleteQueries(1, &query);
+	}
+#endif
+}
+
+//--------------------------------------------------------------
+void renderBench::update() {
+	// everything ran in setup()
+	ofExit(0);
+}
+
+//--------------------------------------------------------------
+void renderBench::run(int history, int entities) {
+	fillScene(history, entities);
+
+	t_routineTime times[RENDER_BENCH_ROUTINES];
+	for (int frame = 0; frame < RENDER_BENCH_WARMUP + RENDER_BENCH_FRAMES; frame++) {
+		// the warmup frames are measured and dropped
+		if (frame == 0 || frame == RENDER_BENCH_WARMUP) {
+			for (int r = 0; r < RENDER_BENCH_ROUTINES; r++) {
+				times[r] = t_routineTime();
+			}
+		}
+
+		fbo.begin();
+		ofClear(47, 52, 64, 255);
+		for (int r = 0; r < RENDER_BENCH_ROUTINES; r++) {
+			measure(r, times[r]);
+		}
+		fbo.end();
+	}
+
+	for (int r = 0; r < RENDER_BENCH_ROUTINES; r++) {
+		const t_routineTime& time = times[r];
+		const double cpu = time.cpuMicros / RENDER_BENCH_FRAMES;
+		const double gpu = time.gpuMicros / RENDER_BENCH_FRAMES;
+		const uint64_t drawCalls = time.drawCalls / RENDER_BENCH_FRAMES;
+		const uint64_t vertices = time.vertices / RENDER_BENCH_FRAMES;
+
+		ofLogNotice() << "renderBench: " << history << " " << entities << " " << routineNames[r] << " "
+			<< ofToString(cpu, 1) << " " << (hasTimer ? ofToString(gpu, 1) : "-") << " " << drawCalls << " " << vertices;
+		if (file) {
+			fprintf(file, "%d,%d,%s,%.1f,", history, entities, routineNames[r], cpu);
+			if (hasTimer) {
+				fprintf(file, "%.1f", gpu);
+			}
+			fprintf(file, ",%llu,%llu\n", (unsigned long long)drawCalls, (unsigned long long)vertices);
+		}
+	}
+}
+
+//--------------------------------------------------------------
+// the same frame every time, a scene halfway through a level
+void renderBench::fillScene(int history, int entities) {
+	const ofRectangle gameField = gameSimulation::getGameField(scene.getViewPort());
+	const double maxHeight = gameField.height * SEGMENT_MAX_HEIGHT_PART;
+
+	state = t_sceneState();
+	state.time = 60;
+	state.scroll = 120.5;
+	state.firstSegment = 120;
+	for (int i = 0; i < SEGMENTS_STORED; i++) {
+		state.ceilHeights[i] = maxHeight * (0.5 + 0.5 * sin(i * 0.7));
+		state.floorHeights[i] = maxHeight * (0.5 + 0.5 * cos(i * 0.9));
+	}
+
+	state.tripno.position = ofPoint(RENDER_BENCH_WIDTH * 0.3, 40);
+	state.tripno.dbgSignal = 30;
+	state.tripno.elastic = -20;
+	state.tripno.resistance = 5;
+	state.pickups = 12;
+
+	// spread over the stored segments, obstacles and pickups in turn
+	state.entityCount = min(entities, SCENE_MAX_ENTITIES);
+	for (int i = 0; i < state.entityCount; i++) {
+		t_sceneEntity& entity = state.entities[i];
+		entity.kind = i % 2 ? ENTITY_PICKUP : ENTITY_OBSTACLE;
+		entity.x = state.firstSegment + (double)i * SEGMENTS_STORED / state.entityCount;
+		entity.y = (i % 5) - 2;
+		entity.width = entity.height = entity.kind == ENTITY_PICKUP ? 0.6 : 1;
+	}
+
+	// every line has one strongest band at 1, like processSpectrum gives
+	spectrum.assign(history * MAX_FBAND, 0);
+	pitches.resize(history);
+	control.resize(history);
+	for (int l = 0; l < history; l++) {
+		float* line = &spectrum[l * MAX_FBAND];
+		const int strongest = 20 + (l * 7) % 100;
+		for (int j = 0; j < MAX_FBAND; j++) {
+			line[j] = j == strongest ? 1 : 0.4 + 0.4 * sin(j * 0.3 + l * 0.1);
+		}
+
+		pitches[l] = log(110 + 100 * (0.5 + 0.5 * sin(l * 0.05)));
+		control[l] = sin(l * 0.05);
+	}
+
+	plot.spectrum = &spectrum[0];
+	plot.lines = history;
+	plot.bands = MAX_FBAND;
+	plot.pitches = &pitches[0];
+	plot.control = &control[0];
+	plot.points = history;
+}
+
+//--------------------------------------------------------------
+void renderBench::measure(int routine, t_routineTime& time) {
+	renderer->drawCalls = 0;
+	renderer->vertices = 0;
+
+#if defined(GL_TIME_ELAPSED) && !defined(TARGET_OPENGLES)
+	if (hasTimer) {
+		glBeginQuery(GL_TIME_ELAPSED, query);
+	}
+#endif
+	uint64_t start = ofGetElapsedTimeMicros();
+
+	switch (routine) {
+	case 0:
+		scene.plotSpectrum(plot, log(100.0), log(400.0));
+		break;
+	case 1:
+		scene.drawScene(state);
+		break;
+	default:
+		scene.drawSceneDebug(state);
+		break;
+	}
+
+	time.cpuMicros += ofGetElapsedTimeMicros() - start;
+
+#if defined(GL_TIME_ELAPSED) && !defined(TARGET_OPENGLES)
+	if (hasTimer) {
+		// waits for the routine to be drawn, the next one starts on an idle gpu
+		glEndQuery(GL_TIME_ELAPSED);
+		GLuint64 nanos = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanos);
+		time.gpuMicros += nanos / 1000.0;
+	}
+#endif
+
+	time.drawCalls += renderer->drawCalls;
+	time.vertices += renderer->vertices;
+}
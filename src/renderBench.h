@@ -0,0 +1,81 @@
+#pragma once
+
+#include "ofMain.h"
+#include "sceneRenderer.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define RENDER_BENCH_WIDTH 1024
+#define RENDER_BENCH_HEIGHT 768
+#define RENDER_BENCH_FRAMES 120 // timed per point of a sweep
+#define RENDER_BENCH_WARMUP 10
+
+// Draw calls and vertices the drawing routines hand to the renderer. Every
+// ofLine, ofRect, ofCircle and ofDrawBitmapString is one draw call, a glyph
+// counts as a 4 vertex quad.
+class countingRenderer : public ofGLRenderer {
+
+	public:
+		countingRenderer();
+
+		void drawLine(float x1, float y1, float z1, float x2, float y2, float z2);
+		void drawRectangle(float x, float y, float z, float w, float h);
+		void drawCircle(float x, float y, float z, float radius);
+		void drawString(string text, float x, float y, float z, ofDrawBitmapMode mode);
+		void setCircleResolution(int resolution);
+
+		uint64_t drawCalls;
+		uint64_t vertices;
+
+	private:
+		int circleResolution;
+};
+
+// Renders a fixed scene into an offscreen fbo with vsync off, instead of
+// the game. Started by `tripno -renderBench [file]`, it exits when done.
+//
+// The spectrogram and plot history is swept with a fixed number of scene
+// entities, then the entities with a fixed history. Per point and per
+// routine (plotSpectrum, drawScene, drawSceneDebug) it reports the cpu time
+// of the calls, the gpu time from timer queries when the GL has them, and
+// the draw calls and vertices of a frame. On Linux, Mesa is asked for its
+// software rasterizer (llvmpipe) unless LIBGL_ALWAYS_SOFTWARE is set, so
+// results compare between machines. Results go to the log and, as csv, to
+// file.
+class renderBench : public ofBaseApp {
+
+	public:
+		renderBench(const std::string& path);
+
+		void setup();
+		void update();
+
+	private:
+		struct t_routineTime {
+			double cpuMicros;
+			double gpuMicros;
+			uint64_t drawCalls;
+			uint64_t vertices;
+		};
+
+		void run(int history, int entities);
+		void fillScene(int history, int entities);
+		void measure(int routine, t_routineTime& time);
+
+		ofPtr<countingRenderer> renderer;
+		sceneRenderer scene;
+		ofFbo fbo;
+		bool hasTimer;
+		unsigned int query;
+
+		t_sceneState state;
+		std::vector<float> spectrum; // lines of MAX_FBAND bands
+		std::vector<float> pitches;
+		std::vector<float> control;
+		t_plotFrame plot;
+
+		std::string path;
+		FILE* file;
+};
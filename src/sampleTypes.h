@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+#include <cmath>
+#include "dywapitchtrack.h"
+
+// Sample types the analysis chain (front-end, decimator, pitch tracker) can
+// run in. All stages share one source per type through these traits:
+//   double  - reference precision
+//   float   - half the memory traffic, twice the SIMD lanes
+//   int16_t - native 16-bit PCM, fixed-point filter and exact integer tracker
+//
+// The app picks its type at compile time, e.g. -DTRIPNO_SAMPLE_TYPE=int16_t
+#ifndef TRIPNO_SAMPLE_TYPE
+#define TRIPNO_SAMPLE_TYPE double
+#endif
+
+template<typename T> struct sampleTraits;
+
+template<> struct sampleTraits<double> {
+	static const int pitchType = DYWAPITCH_DOUBLE;
+	static const char* name() { return "double"; }
+
+	static double fromFloat(float x) { return x; }
+	static float toFloat(double x) { return (float)x; }
+	static void pushPitch(dywapitchwindow* window, double* samples, int start, int count) {
+		dywapitch_pushsamples(window, samples, start, count);
+	}
+};
+
+template<> struct sampleTraits<float> {
+	static const int pitchType = DYWAPITCH_FLOAT;
+	static const char* name() { return "float"; }
+
+	static float fromFloat(float x) { return x; }
+	static float toFloat(float x) { return x; }
+	static void pushPitch(dywapitchwindow* window, float* samples, int start, int count) {
+		dywapitch_pushsamples_f(window, samples, start, count);
+	}
+};
+
+// full scale is +-32767, rounded to nearest (as the SIMD conversion) and saturated
+template<> struct sampleTraits<int16_t> {
+	static const int pitchType = DYWAPITCH_INT16;
+	static const char* name() { return "int16"; }
+
+	static int16_t fromFloat(float x) {
+		float scaled = x * 32767.0f;
+		if (scaled >= 32767.0f) return 32767;
+		if (scaled <= -32768.0f) return -32768;
+		return (int16_t)lrintf(scaled);
+	}
+	static float toFloat(int16_t x) { return x * (1.0f / 32767.0f); }
+	static void pushPitch(dywapitchwindow* window, int16_t* samples, int start, int count) {
+		dywapitch_pushsamples_s16(window, samples, start, count);
+	}
+};
@@ -0,0 +1,135 @@
+#include "sceneRenderer.h"
+
+//--------------------------------------------------------------
+sceneRenderer::sceneRenderer() {
+	shownPickups = 0;
+}
+
+//--------------------------------------------------------------
+void sceneRenderer::drawScene(const t_sceneState& scene) {
+	TRACE_ZONE("drawScene");
+
+	ofRectangle gameField = gameSimulation::getGameField(viewPort);
+	float segmentWidth = ceil(gameField.width / SEGMENTS_PER_VIEWPORT);
+
+	ofSetColor(63, 83, 140, 128);
+    ofFill();
+
+	ofRect(0, 0, viewPort.width, gameField.y);
+	ofRect(0, viewPort.height - gameField.y, viewPort.width, gameField.y);
+
+	for (int i = 0; i < SEGMENTS_STORED; ++i) {
+		float x = (scene.firstSegment + i - scene.scroll) * segmentWidth;
+		ofRect(x, gameField.y, segmentWidth, scene.ceilHeights[i]);
+		ofRect(x, gameField.y + gameField.height - scene.floorHeights[i], segmentWidth, scene.floorHeights[i]);
+	}
+
+	for (int i = 0; i < scene.entityCount; ++i) {
+		const t_sceneEntity& entity = scene.entities[i];
+		float x = (entity.x - scene.scroll) * segmentWidth;
+		float y = viewPort.height * 0.5 - (entity.y + entity.height) * segmentWidth;
+
+		if (entity.kind == ENTITY_PICKUP) {
+			ofSetColor(240, 200, 84, 192);
+			ofCircle(x + entity.width * segmentWidth / 2, y + entity.height * segmentWidth / 2, entity.width * segmentWidth / 2);
+		}
+		else {
+			ofSetColor(63, 83, 140, 192);
+			ofRect(x, y, entity.width * segmentWidth, entity.height * segmentWidth);
+		}
+	}
+
+	ofSetColor(255, 85, 84, 128);
+    ofFill();
+	ofCircle(scene.tripno.position.x, getTripnoAbsoluteY(scene.tripno), TRIPNO_RADIUS * segmentWidth);
+
+	if (scene.pickups > 0) {
+		ofSetColor(240, 200, 84);
+		if (scene.pickups != shownPickups) {
+			shownPickups = scene.pickups;
+			pickupsText = ofToString(shownPickups);
+		}
+		ofDrawBitmapString(pickupsText, viewPort.width - 40, 20);
+	}
+}
+
+//--------------------------------------------------------------
+double sceneRenderer::getTripnoAbsoluteY(const movableObject& tripno) {
+	return viewPort.height * 0.5 - tripno.position.y;
+}
+
+//--------------------------------------------------------------
+void sceneRenderer::drawSceneDebug(const t_sceneState& scene) {
+	const movableObject& tripno = scene.tripno;
+	const int lengthMul = 1;
+	int x = viewPort.width * 0.3;
+	int y = viewPort.height * 0.5 - tripno.position.y;
+
+	ofSetColor(255, 40, 40, 128);
+	ofLine(x+1, y, x+1, y - tripno.dbgSignal * lengthMul);
+
+	ofSetColor(40, 255, 40, 128);
+	int elasticLength = tripno.elastic * lengthMul;
+	ofLine(x, y, x, y - elasticLength);
+
+	ofSetColor(40, 40, 255, 128);
+	ofLine(x-1, y, x-1, y - tripno.resistance * lengthMul);
+
+}
+
+//--------------------------------------------------------------
+void sceneRenderer::plotSpectrum(const t_plotFrame& plot, double minFreqLog, double maxFreqLog) {
+	TRACE_ZONE("plotSpectrum");
+
+	if (plot.lines > 0) {
+		ofSetLineWidth(2);
+		double maxLog = log(MAX_FBAND) / log(2);
+		int maxHeight = viewPort.height / 2;
+
+		for (int i = 0; i < plot.lines; ++i)
+		{
+			const float* line = plot.spectrum + (plot.lines - i - 1) * plot.bands;
+
+			int yFrom = 0, yTo = 0;
+			int prevHeight = 0;
+			for (int j = 1; j < plot.bands; ++j)
+			{
+				float logFreq = log(j)/ log(2);
+				int y = logFreq / maxLog * maxHeight;
+
+				// the strongest band of the line is 1
+				if(1 == line[j])
+				{
+					yFrom = y;
+					yTo = prevHeight;
+				}
+
+				int color = 255-line[j] * 255;
+				ofSetColor(color, color, color);
+				ofLine(i, maxHeight - y, i, maxHeight - prevHeight);
+
+				prevHeight = y;
+			}
+
+			ofSetColor(240, 84, 84);
+			ofLine(i, maxHeight - yFrom, i, maxHeight - yTo);
+		}
+	}
+
+	ofSetLineWidth(1);
+
+	ofSetColor(184, 184, 184, 128);
+	const int controlBaseLine = viewPort.height - viewPort.height / 2;
+	const int signalMultiplier = 40;
+	for (int i = 0; i < plot.points; i++)
+	{
+		ofLine(i, controlBaseLine, i, controlBaseLine - plot.control[plot.points - i - 1] * signalMultiplier);
+		ofLine(i, viewPort.height, i, viewPort.height- plot.pitches[plot.points - i - 1] * signalMultiplier);
+	}
+
+	ofSetColor(184, 84, 84, 128);
+	int minFreqY = viewPort.height - minFreqLog * signalMultiplier;
+	int maxFreqY = viewPort.height - maxFreqLog * signalMultiplier;
+	ofLine(0, minFreqY, viewPort.width, minFreqY);
+	ofLine(0, maxFreqY, viewPort.width, maxFreqY);
+}
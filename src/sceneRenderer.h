@@ -0,0 +1,40 @@
+#pragma once
+
+#include "ofMain.h"
+#include "gameSimulation.h"
+#include "traceZones.h"
+#include "plotHistory.h"
+
+#include <string>
+
+#define MAX_FBAND 200
+#define SPECTRUM_HISTORY 1024 // spectrogram lines kept
+
+// The drawing of draw(): the scene, its debug lines and the analysis plots.
+// Holds no game state, everything drawn is passed in, so testApp and the
+// render benchmark (see renderBench.h) draw the same way.
+class sceneRenderer {
+
+	public:
+		sceneRenderer();
+
+		void setViewPort(const ofRectangle& viewPort) { this->viewPort = viewPort; }
+		const ofRectangle& getViewPort() const { return viewPort; }
+
+		// walls, obstacles, pickups and tripno
+		void drawScene(const t_sceneState& scene);
+		// forces on tripno
+		void drawSceneDebug(const t_sceneState& scene);
+		// spectrogram (no lines for none), pitch and control history and
+		// the tracked range
+		void plotSpectrum(const t_plotFrame& plot, double minFreqLog, double maxFreqLog);
+
+	private:
+		ofRectangle viewPort;
+
+		// the pickup count as drawn, remade only when it changes
+		int shownPickups;
+		std::string pickupsText;
+
+		double getTripnoAbsoluteY(const movableObject& tripno);
+};
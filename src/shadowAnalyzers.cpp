@@ -0,0 +1,281 @@
+#include "shadowAnalyzers.h"
+#include "atomicOps.h"
+#include "traceZones.h"
+#include "allocCounter.h"
+
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+//--------------------------------------------------------------
+// below the game, the capture writer and the rest of the desktop
+static void lowerThreadPriority() {
+#ifdef _WIN32
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(SCHED_IDLE)
+	sched_param param = sched_param();
+	pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#else
+	sched_param param = sched_param();
+	param.sched_priority = sched_get_priority_min(SCHED_OTHER);
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+#endif
+}
+
+//--------------------------------------------------------------
+// cpu time of the calling thread: a low priority thread is preempted often,
+// its wall time says little of what a candidate costs. Windows only has
+// wall time at that resolution.
+static uint64_t threadCpuMicros() {
+#ifdef _WIN32
+	return ofGetElapsedTimeMicros();
+#else
+	timespec time;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+	return (uint64_t)time.tv_sec * 1000000 + time.tv_nsec / 1000;
+#endif
+}
+
+//--------------------------------------------------------------
+shadowAnalyzers::shadowAnalyzers() {
+	slotSamples = 0;
+	channels = 0;
+	head = tail = 0;
+	active = 0;
+	shed = shedBase = lastShed = 0;
+	blockIndex = 0;
+	blocksRun = 0;
+
+	file = NULL;
+	primaryBlocks = 0;
+	primarySeconds = 0;
+}
+
+//--------------------------------------------------------------
+shadowAnalyzers::~shadowAnalyzers() {
+	stop();
+	for (size_t i = 0; i < candidates.size(); i++) {
+		delete candidates[i].analyzer;
+	}
+}
+
+//--------------------------------------------------------------
+int shadowAnalyzers::setup(const t_config& primary, const std::vector<std::string>& paths, int channels, int blockSize) {
+	for (size_t i = 0; i < paths.size() && candidates.size() < SHADOW_MAX_CANDIDATES; i++) {
+		t_config config = primary;
+		if (!readConfigFile(paths[i], config)) {
+			ofLogWarning() << "cannot read the shadow candidate " << paths[i];
+			continue;
+		}
+
+		t_candidate candidate = t_candidate();
+		candidate.name = ofFilePath::getBaseName(paths[i]);
+		candidate.analyzer = new pitchAnalyzer<TRIPNO_SAMPLE_TYPE>();
+		candidate.analyzer->setup(config);
+		candidates.push_back(candidate);
+	}
+
+	if (!candidates.empty()) {
+		this->channels = channels;
+		slotSamples = blockSize * channels;
+		slots.assign(SHADOW_QUEUE_BLOCKS, t_shadowSlot());
+		samples.assign(SHADOW_QUEUE_BLOCKS * slotSamples, 0);
+	}
+	return candidates.size();
+}
+
+//--------------------------------------------------------------
+bool shadowAnalyzers::start(const std::string& path) {
+	stop();
+
+	if (candidates.empty()) {
+		return false;
+	}
+
+	file = fopen(path.c_str(), "w");
+	if (!file) {
+		return false;
+	}
+
+	fprintf(file, "block,shed,awake,freq,control,micros");
+	for (size_t i = 0; i < candidates.size(); i++) {
+		const std::string& name = candidates[i].name;
+		fprintf(file, ",%s.freq,%s.cents,%s.control,%s.micros", name.c_str(), name.c_str(), name.c_str(), name.c_str());
+	}
+	fprintf(file, "\n");
+
+	this->path = path;
+	primaryBlocks = 0;
+	primarySeconds = 0;
+	for (size_t i = 0; i < candidates.size(); i++) {
+		t_candidate& candidate = candidates[i];
+		candidate.blocks = candidate.voicingDisagreements = candidate.bothVoiced = 0;
+		candidate.centsSum = candidate.controlSum = candidate.controlMax = candidate.cpuSeconds = 0;
+	}
+
+	// blocks queued before the start are not part of it
+	storeRelease(&tail, loadAcquire(&head));
+	storeRelease(&blocksRun, 0);
+	shedBase = loadAcquire(&shed);
+	storeRelease(&active, 1);
+
+	startThread(true, false);
+	return true;
+}
+
+//--------------------------------------------------------------
+void shadowAnalyzers::stop() {
+	if (!file) {
+		return;
+	}
+
+	storeRelease(&active, 0);
+	waitForThread(true);
+
+	drain();
+	logSummary();
+
+	fclose(file);
+	file = NULL;
+}
+
+//--------------------------------------------------------------
+uint32_t shadowAnalyzers::getShed() const {
+	return loadAcquire(&shed) - shedBase;
+}
+
+//--------------------------------------------------------------
+uint32_t shadowAnalyzers::getBlocksRun() const {
+	return loadAcquire(&blocksRun);
+}
+
+//--------------------------------------------------------------
+void shadowAnalyzers::push(const float* input, int bufferSize, int nChannels,
+	const t_analysis& primary, bool awake, uint64_t primaryMicros) {
+	uint32_t index = blockIndex++;
+
+	if (!loadAcquire(&active)) {
+		return;
+	}
+
+	// a full ring, or a block that does not fit a slot, is shed
+	int count = bufferSize * nChannels;
+	if (head - loadAcquire(&tail) >= SHADOW_QUEUE_BLOCKS || nChannels != channels || count > slotSamples) {
+		storeRelease(&shed, shed + 1);
+		return;
+	}
+
+	uint32_t slot = head & (SHADOW_QUEUE_BLOCKS - 1);
+	memcpy(&samples[slot * slotSamples], input, count * sizeof(float));
+	slots[slot].index = index;
+	slots[slot].frames = bufferSize;
+	slots[slot].shedBefore = shed - lastShed;
+	slots[slot].awake = awake;
+	slots[slot].primary = primary;
+	slots[slot].primaryMicros = primaryMicros;
+	lastShed = shed;
+
+	storeRelease(&head, head + 1);
+}
+
+//--------------------------------------------------------------
+void shadowAnalyzers::threadedFunction() {
+	TRACE_THREAD_NAME("shadow");
+	ALLOC_THREAD_NAME("shadow");
+	lowerThreadPriority();
+
+	while (isThreadRunning()) {
+		drain();
+		ofSleepMillis(SHADOW_SLEEP);
+	}
+	ALLOC_THREAD_EXIT();
+}
+
+//--------------------------------------------------------------
+void shadowAnalyzers::drain() {
+	uint32_t end = loadAcquire(&head);
+
+	while (tail != end) {
+		uint32_t slot = tail & (SHADOW_QUEUE_BLOCKS - 1);
+		run(slots[slot], &samples[slot * slotSamples]);
+
+		storeRelease(&tail, tail + 1);
+		storeRelease(&blocksRun, blocksRun + 1);
+	}
+}
+
+//--------------------------------------------------------------
+void shadowAnalyzers::run(const t_shadowSlot& block, const float* input) {
+	TRACE_ZONE("shadow");
+	const t_analysis& primary = block.primary;
+
+	fprintf(file, "%u,%u,%d,%.2f,%.4f,%llu", block.index, block.shedBefore, block.awake ? 1 : 0,
+		primary.freq, primary.control, (unsigned long long)block.primaryMicros);
+
+	if (block.awake) {
+		primaryBlocks++;
+		primarySeconds += block.primaryMicros / 1000000.0;
+	}
+
+	for (size_t i = 0; i < candidates.size(); i++) {
+		t_candidate& candidate = candidates[i];
+
+		uint64_t start = threadCpuMicros();
+		t_analysis result = candidate.analyzer->process(input, block.frames, channels);
+		uint64_t micros = threadCpuMicros() - start;
+
+		const bool bothVoiced = result.freq > 0 && primary.freq > 0;
+		const double cents = bothVoiced ? 1200 * log2(result.freq / primary.freq) : 0;
+		const double control = result.control - primary.control;
+
+		fprintf(file, ",%.2f,", result.freq);
+		if (bothVoiced) {
+			fprintf(file, "%.1f", cents);
+		}
+		fprintf(file, ",%.4f,%llu", control, (unsigned long long)micros);
+
+		if (block.awake) {
+			candidate.blocks++;
+			candidate.cpuSeconds += micros / 1000000.0;
+			candidate.controlSum += fabs(control);
+			candidate.controlMax = std::max(candidate.controlMax, fabs(control));
+			if (bothVoiced) {
+				candidate.bothVoiced++;
+				candidate.centsSum += fabs(cents);
+			}
+			else if ((result.freq > 0) != (primary.freq > 0)) {
+				candidate.voicingDisagreements++;
+			}
+		}
+	}
+	fprintf(file, "\n");
+}
+
+//--------------------------------------------------------------
+void shadowAnalyzers::logSummary() {
+	// cpu per second of audio, like tripnoBench
+	const double blockSeconds = slotSamples / channels / (double)SAMPLE_RATE;
+
+	ofLogNotice() << "shadow: " << getBlocksRun() << " blocks run, " << getShed() << " shed, to " << path;
+	ofLogNotice() << "shadow: primary audioIn " << ofToString(primaryBlocks ? primarySeconds / (primaryBlocks * blockSeconds) * 1000 : 0, 2)
+		<< " ms/s";
+
+	for (size_t i = 0; i < candidates.size(); i++) {
+		const t_candidate& candidate = candidates[i];
+		const double blocks = std::max(candidate.blocks, 1u);
+
+		ofLogNotice() << "shadow " << candidate.name << ": "
+			<< ofToString(candidate.voicingDisagreements / blocks * 100, 2) << "% voicing disagreements, "
+			<< ofToString(candidate.bothVoiced ? candidate.centsSum / candidate.bothVoiced : 0, 1) << " cents, "
+			<< "control " << ofToString(candidate.controlSum / blocks, 4) << " mean " << ofToString(candidate.controlMax, 4) << " max, "
+			<< ofToString(candidate.cpuSeconds / (blocks * blockSeconds) * 1000, 2) << " ms/s";
+	}
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "ofMain.h"
+#include "pitchAnalyzer.h"
+#include "tripnoConfig.h"
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#define SHADOW_QUEUE_BLOCKS 32 // ~0.75 s of 1024 sample hops at 44100 Hz
+#define SHADOW_SLEEP 5 // ms between drains
+#define SHADOW_MAX_CANDIDATES 8
+
+// Runs candidate analysis configurations on the live input, next to the
+// one that drives tripno, without touching it.
+//
+// Every candidate is a config file read over the primary config, so it
+// only needs the keys it changes. push() copies each audio block and the
+// primary's result of it into a single producer / single consumer ring, like
+// audioCapture, and never waits. A low priority thread runs every candidate
+// on the blocks. When it falls behind and the ring is full, blocks are
+// shed and counted, the primary never waits for it.
+//
+// Per block, path gets a csv line with the primary's pitch, control and
+// audioIn time, and for every candidate its pitch, the difference in cents
+// (empty unless both are voiced), the control difference and the cpu time
+// it took. A candidate learns its range from the blocks it sees, so the
+// control of the first seconds differs until it settles. Blocks the
+// primary spent idle are run but left out of the summary.
+class shadowAnalyzers : public ofThread {
+
+	public:
+		shadowAnalyzers();
+		~shadowAnalyzers();
+
+		// reads the candidate files over primary, allocates the ring. Call
+		// before the sound stream starts. Returns the number of candidates.
+		int setup(const t_config& primary, const std::vector<std::string>& paths, int channels, int blockSize);
+
+		// opens the csv and starts the thread
+		bool start(const std::string& path);
+		// runs what is still queued, logs the summary and closes the csv
+		void stop();
+		bool isRunning() const { return file != NULL; }
+
+		// from the audio thread, once per block, after the primary analysis
+		void push(const float* input, int bufferSize, int nChannels,
+			const t_analysis& primary, bool awake, uint64_t primaryMicros);
+
+		// blocks not run since start() because the ring was full
+		uint32_t getShed() const;
+		uint32_t getBlocksRun() const;
+		int getCandidateCount() const { return candidates.size(); }
+
+	private:
+		struct t_shadowSlot {
+			uint32_t index;
+			uint32_t frames;
+			uint32_t shedBefore;	// blocks shed between this one and the previous
+			bool awake;
+			t_analysis primary;
+			uint64_t primaryMicros;
+		};
+
+		struct t_candidate {
+			std::string name;
+			pitchAnalyzer<TRIPNO_SAMPLE_TYPE>* analyzer;
+
+			// summary, of the blocks the primary was awake
+			uint32_t blocks;
+			uint32_t voicingDisagreements;
+			uint32_t bothVoiced;
+			double centsSum;		// |cents|
+			double controlSum;		// |control difference|
+			double controlMax;
+			double cpuSeconds;
+		};
+
+		void threadedFunction();
+		void drain();
+		void run(const t_shadowSlot& block, const float* input);
+		void logSummary();
+
+		std::vector<t_candidate> candidates;
+
+		// ring, written by the audio thread at head, read by the shadow thread at tail
+		std::vector<t_shadowSlot> slots;
+		std::vector<float> samples;
+		int slotSamples;
+		int channels;
+		uint32_t head;
+		uint32_t tail;
+		uint32_t active;
+		uint32_t shed;
+		uint32_t shedBase;
+		uint32_t lastShed;		// audio thread, shed at the previous push
+		uint32_t blockIndex;
+		uint32_t blocksRun;
+
+		// owned by the shadow thread while running
+		FILE* file;
+		uint32_t primaryBlocks;
+		double primarySeconds;
+		std::string path;
+};
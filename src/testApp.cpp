@@ -5,47 +5,111 @@ void testApp::setup(){
 	// init logs
 	ofSetLogLevel(OF_LOG_VERBOSE);
 	ofLogVerbose() << "setup started";
-	
-	tripno.mass = 1.0;
-	tripno.velocity = 0;
-	tripno.position = ofPoint(0, 0);
-
-	// init scene objects
-	timeElapsed = 0;
-	currentIndex = 1;
-
-	minFreqLog = 100;
-	maxFreqLog = 0;
-	maxSignal = 0;
-
-    for (int i = 0; i < SEGMENTS_STORED; ++i) {
-        ceilHeights[i] = floorHeights[i] = 0;
-		earthline[i] = skyline[i] = ofRectangle(0,0,0,0);
-    }
-
-	gameField = paddingTop = paddingBottom = 
-		ofRectangle(0,0,0,0);
+	TRACE_THREAD_NAME("main");
+	ALLOC_THREAD_NAME("main");
+#ifdef TRIPNO_TRACE
+	traceDrawEnd = 0;
+#endif
+#ifdef TRIPNO_ALLOC_COUNT
+	allocLastCount = 0;
+	allocLastTime = 0;
+	allocFrames = 0;
+#endif
 
 	viewPort = ofGetCurrentViewport();
+	renderer.setViewPort(viewPort);
 
 	// init vertical sync and some graphics
 	ofSetVerticalSync(true);
 	ofSetCircleResolution(6);
 	ofBackground(47, 52, 64);
 
+	//update config
+	readConfig();
+
 	// init audio
 	soundStream.listDevices();
 
-	fft = ofxFft::create(AUDIO_BUFFER_SIZE, OF_FFT_WINDOW_RECTANGULAR);
+	analyzer.setup(config);
+	ofLogNotice() << "analysis samples: " << sampleTraits<TRIPNO_SAMPLE_TYPE>::name();
+
+	// nobody playing for a while : low frame rate, no scrolling, level check only
+	idle.setup((double)AUDIO_HOP_SIZE / SAMPLE_RATE, config.idleTimeout, config.idleWakePeak);
+	idleState = 0;
+	paused = false;
+	lastFrame = 0;
+
+	// the player's range and level, read while the rest starts
+	profile = config.profile.empty() ? CALIBRATION_DEFAULT_PROFILE : config.profile;
+	calibration = priorCalibration();
+	calibrationLoad = 0;
+	profileLoad = calibrations.load(getCalibrationPath(profile));
+
+	fft.setup(analyzer.getWindowSize(), FFT_WINDOW_RECTANGULAR);
+
+	fftBuffer = new float[fft.getSize()];
+	amplitudes = new float[fft.getBinSize()];
+
+	// the plots keep fixed rings, a frame copies them into the arena
+	plots.setup(SPECTRUM_HISTORY, min(fft.getBinSize(), MAX_FBAND), SPECTRUM_HISTORY);
+	arena.setup(FRAME_ARENA_SIZE);
+
+	statusTier = TIER_FULL;
+	statusLoad = -1;
+	captureOverflows = 0;
+	shadowShed = 0;
+	idleText = "idle, sing to play";
+
+	// other local processes follow the control stream through shared memory
+	if (!publisher.open()) {
+		ofLogWarning() << "cannot open the " << CONTROL_STREAM_NAME << " shared memory, not publishing";
+	}
+
+	capture.setup(SAMPLE_RATE, 2, AUDIO_HOP_SIZE);
+	if (config.capture != CAPTURE_OFF) {
+		startCapture();
+	}
+
+	// candidate analyses compared to this one on the live input
+	if (graph.has(CONSUMER_SHADOW)) {
+		vector<string> candidates = ofSplitString(config.shadow, " ", true, true);
+		for (size_t i = 0; i < candidates.size(); i++) {
+			candidates[i] = ofToDataPath(candidates[i]);
+		}
+
+		string path = ofToDataPath("shadow-" + ofGetTimestampString() + ".csv");
+		if (shadows.setup(config, candidates, 2, AUDIO_HOP_SIZE) && shadows.start(path)) {
+			ofLogNotice() << "shadowing " << shadows.getCandidateCount() << " candidates to " << path;
+		}
+		else {
+			ofLogWarning() << "no shadow candidate to run, see <shadow> in config.xml";
+		}
+	}
+
+	// loudness control: blocks of a few ms, gathered into hops for the pitch
+	envelope.setup(config, SAMPLE_RATE);
+	hopBuffer.assign(AUDIO_HOP_SIZE * 2, 0);
+	hopFrames = 0;
+	pitchControl = 0;
+
+	const int audioBlock = envelope.isEnabled() ? ENVELOPE_AUDIO_BLOCK : AUDIO_HOP_SIZE;
 
-	soundStream.setup(this, 0, 2, SAMPLE_RATE, AUDIO_BUFFER_SIZE, 4);
-	fftOutput = new float[fft->getBinSize()];
+	// the analysis steps down under cpu pressure. A hop has to fit in the
+	// audioIn block that completes it, a few ms with the envelope.
+	governor.setup((double)audioBlock / SAMPLE_RATE, config.governor != 0, graph.needs(STAGE_FFT));
+	lastAudioIn = 0;
+	audioInterval = 0;
+	shownTier = TIER_FULL;
+	shownLoad = 0;
+
+	soundStream.setup(this, 0, 2, SAMPLE_RATE, audioBlock, 4);
 
 	// seed random
 	ofSeedRandom();
 
-	//update config
-	readConfig();
+	// the scene runs on its own thread from here on
+	simulation.setup(config, viewPort);
+	simulation.startThread(true, false);
 
 	ofLogVerbose() << "setup finished";
 }
@@ -63,409 +127,506 @@ void testApp::readConfig() {
 		config.gateThreshold = ofToDouble(xmlConfig.getValue("gateThreshold"));
 		config.maxSignalClampRate = ofToDouble(xmlConfig.getValue("maxSignalClampRate"));
 		config.rangeClampRate = ofToDouble(xmlConfig.getValue("rangeClampRate"));
+		config.decimation = ofToInt(xmlConfig.getValue("decimation"));
+		config.governor = ofToInt(xmlConfig.getValue("governor"));
+		config.windowMin = ofToInt(xmlConfig.getValue("windowMin"));
+		config.windowMax = ofToInt(xmlConfig.getValue("windowMax"));
+		config.idleTimeout = ofToDouble(xmlConfig.getValue("idleTimeout"));
+		config.idleWakePeak = ofToDouble(xmlConfig.getValue("idleWakePeak"));
+		config.envelopeBlend = ofToDouble(xmlConfig.getValue("envelopeBlend"));
+		config.envelopeBlock = ofToInt(xmlConfig.getValue("envelopeBlock"));
+		config.envelopeAttack = ofToDouble(xmlConfig.getValue("envelopeAttack"));
+		config.envelopeRelease = ofToDouble(xmlConfig.getValue("envelopeRelease"));
+		config.envelopeGain = ofToDouble(xmlConfig.getValue("envelopeGain"));
+		config.capture = ofToInt(xmlConfig.getValue("capture"));
+		config.capturePreallocate = ofToDouble(xmlConfig.getValue("capturePreallocate"));
+		config.obstaclesPerSegment = ofToDouble(xmlConfig.getValue("obstaclesPerSegment"));
+		config.pickupsPerSegment = ofToDouble(xmlConfig.getValue("pickupsPerSegment"));
+		config.profile = xmlConfig.getValue("profile");
+		config.stages = xmlConfig.getValue("stages");
+		config.consumers = xmlConfig.getValue("consumers");
+		config.shadow = xmlConfig.getValue("shadow");
 	}
 	else {
 		config.signalAmp = config.elasticKoeff = 
 			config.maxSignalClampRate = config.resistanceKoeff = 0;
+		config.decimation = 1;
+		config.governor = 0;
+		config.windowMin = config.windowMax = AUDIO_BUFFER_SIZE;
+		config.idleTimeout = config.idleWakePeak = 0;
+		config.envelopeBlend = config.envelopeAttack = config.envelopeRelease = config.envelopeGain = 0;
+		config.envelopeBlock = ENVELOPE_MIN_BLOCK;
+		config.capture = CAPTURE_OFF;
+		config.capturePreallocate = 0;
+		config.obstaclesPerSegment = config.pickupsPerSegment = 0;
+		config.profile = config.stages = config.consumers = config.shadow = "";
 	}
 
 	ofLogNotice() << "Update config";
 	ofLogNotice() << "signalAmp=" << config.signalAmp;
 	ofLogNotice() << "elasticKoeff=" << config.elasticKoeff;
 	ofLogNotice() << "resistanceKoeff=" << config.resistanceKoeff;
-}
+	ofLogNotice() << "decimation=" << config.decimation << " (applied on startup)";
+	ofLogNotice() << "governor=" << config.governor << " (applied on startup)";
+	ofLogNotice() << "windowMin=" << config.windowMin << " windowMax=" << config.windowMax << " (applied on startup)";
+	ofLogNotice() << "idleTimeout=" << config.idleTimeout << " (applied on startup)";
+	ofLogNotice() << "envelopeBlend=" << config.envelopeBlend << " (loudness control turned on or off on startup)";
+	ofLogNotice() << "profile=" << config.profile << " (applied on startup)";
+
+	dspGraph nextGraph;
+	string errors;
+	if (!nextGraph.setup(config.stages, config.consumers, errors)) {
+		ofLogWarning() << errors;
+	}
+	ofLogNotice() << "pipeline: " << nextGraph.describe();
 
-//--------------------------------------------------------------
-void testApp::update(){
-    unsigned long long now = ofGetElapsedTimeMillis();
-	float dt = (now - timeElapsed)/1000.0f;
-	timeElapsed = now;
-	
-	// update scene
-	updateBackground();
-	updateTripno(dt);
+	soundMutex.lock();
+	graph = nextGraph;
+	soundMutex.unlock();
+
+	analyzer.setConfig(config);
+	envelope.setConfig(config);
+	simulation.setConfig(config);
 }
 
 //--------------------------------------------------------------
-void testApp::updateBackground() {
-
-	//offset in segments
-	float beginOffset = MOVEMENT_SPEED * timeElapsed / 1000.0f;
-
-	if (viewPort.width == 0 || viewPort.height == 0) {
-		return;
+void testApp::update(){
+	// the scene is stepped by the simulation thread
+#ifdef TRIPNO_TRACE
+	if (traceDrawEnd) {
+		TRACE_SPAN("swap", traceDrawEnd, TRACE_TIME());
 	}
+#endif
 
-	gameField = viewPort;
-
-	gameField.height = viewPort.width / VIEWPORT_ASPECT;
-	gameField.y = (viewPort.height - gameField.height) / 2;
-	float segmentWidth = ceil(gameField.width / SEGMENTS_PER_VIEWPORT);
-
-	if (paddingTop.width == 0) {
-		paddingTop = ofRectangle(0, 0, viewPort.width, gameField.y);
-	}
-	if (paddingBottom.width == 0) {
-		paddingBottom = ofRectangle(0, viewPort.height - gameField.y, viewPort.width, gameField.y);
+	// idle : a frame every 1 / IDLE_FRAME_RATE s, a voice cuts the wait short
+	if (paused) {
+		uint64_t nextFrame = lastFrame + 1000000 / IDLE_FRAME_RATE;
+		while (loadAcquire(&idleState) && ofGetElapsedTimeMicros() < nextFrame) {
+			ofSleepMillis(IDLE_POLL_MILLIS);
+		}
 	}
+	lastFrame = ofGetElapsedTimeMicros();
 
-	float maxSegmentHeight = gameField.height * SEGMENT_MAX_HEIGHT_PART;
-	float minSegmentHeight = maxSegmentHeight / 2;
-
-	// current offset in segments
-	float offset = beginOffset - currentIndex;
+	TRACE_ZONE("update");
 
-	for (int i = 0; i < SEGMENTS_STORED; ++i) {
-	    if (ceilHeights[i] == 0) {// generate hights
-            ceilHeights[i] = ofRandom(minSegmentHeight, maxSegmentHeight);
-            floorHeights[i] = ofRandom(minSegmentHeight, maxSegmentHeight);
-	    }
-
-		if (skyline[i].width == 0) { // generate rectangles
-            float startX = i==0 ? 0 : skyline[i-1].x + segmentWidth;
-
-            skyline[i] = ofRectangle(startX, gameField.y, segmentWidth, ceilHeights[i]);
-            earthline[i] = ofRectangle(startX, gameField.y + gameField.height - floorHeights[i],
-                                       segmentWidth, floorHeights[i]);
-		}
-	    else {
-			earthline[i].x = skyline[i].x = (i - offset) * segmentWidth ;
+	// what the last frame built is dropped
+	arena.reset();
 
-            if (skyline[i].x < -segmentWidth) {
-                moveSegments(i);
-            }
-	    }
+	bool isIdle = loadAcquire(&idleState) != 0;
+	if (isIdle != paused) {
+		ofLogNotice() << (isIdle ? "idle" : "awake");
+		simulation.setPaused(isIdle);
+		paused = isIdle;
 	}
-
-	moveSegments(floor(beginOffset) - currentIndex);
-	currentIndex = floor(beginOffset);
 }
 
 //--------------------------------------------------------------
-size_t lastSignalIndex = 0;
+void testApp::draw(){
+	TRACE_ZONE("draw");
 
-void testApp::updateTripno(float dt) {
+	t_sceneState scene = simulation.getScene(ofGetElapsedTimeMicros());
 
-	float signal = 0;
+	plotSpectrum();
+	
+	renderer.drawScene(scene);
+	
+	renderer.drawSceneDebug(scene);
 
-	double blockWidth = gameField.width / SEGMENTS_PER_VIEWPORT;
-	tripno.position.x = gameField.width * 0.3;
+	soundMutex.lock();
+	qualityTier tier = shownTier;
+	double load = shownLoad;
+	soundMutex.unlock();
 
-	// pop max signal from the control data
-	if (control.size() - lastSignalIndex > 1) {
-		soundMutex.lock();
-		signal = (*max_element(control.begin() + lastSignalIndex, control.end())) * config.signalAmp;
-		lastSignalIndex = control.size() - 1;
-		soundMutex.unlock();
+	int loadPercent = load * 100 + 0.5;
+	if (tier != statusTier || loadPercent != statusLoad || profile != statusProfile || statusText.empty()) {
+		statusTier = tier;
+		statusLoad = loadPercent;
+		statusProfile = profile;
+		statusText = "profile " + profile + ", quality " + string(qualityGovernor::tierName(tier))
+			+ ", audio load " + ofToString(loadPercent) + "%";
 	}
-	signal = signal != signal ? 0 : signal;
-	tripno.dbgSignal = signal ? signal : tripno.dbgSignal;
-
-	tripno.elastic = - config.elasticKoeff * tripno.position.y;
+	ofSetColor(tier == TIER_FULL ? 184 : 255, tier == TIER_FULL ? 184 : 85, tier == TIER_FULL ? 184 : 84);
+	ofDrawBitmapString(statusText, 10, 20);
 
-	tripno.resistance = - ofSign(tripno.velocity) *  tripno.velocity * tripno.velocity * config.resistanceKoeff;
+	if (paused) {
+		ofSetColor(184, 184, 184);
+		ofDrawBitmapString(idleText, viewPort.width / 2 - 72, viewPort.height / 2 - 40);
+	}
 
-	double acceleration = (signal/* as control force */ + tripno.elastic + tripno.resistance) * tripno.mass;
-	
-	tripno.position.y +=  tripno.velocity * dt + acceleration * dt * dt;
+	if (capture.isCapturing()) {
+		uint32_t overflows = capture.getOverflows();
+		if (overflows != captureOverflows || captureText.empty()) {
+			captureOverflows = overflows;
+			captureText = "capturing, " + ofToString(overflows) + " blocks dropped";
+		}
+		ofSetColor(255, 85, 84);
+		ofDrawBitmapString(captureText, 10, 40);
+	}
 
-	tripno.velocity += acceleration * dt;
+	if (shadows.isRunning()) {
+		uint32_t shed = shadows.getShed();
+		if (shed != shadowShed || shadowText.empty()) {
+			shadowShed = shed;
+			shadowText = "shadowing " + ofToString(shadows.getCandidateCount()) + " candidates, "
+				+ ofToString(shed) + " blocks shed";
+		}
+		ofSetColor(184, 184, 184);
+		ofDrawBitmapString(shadowText, 10, 60);
+	}
 
-	int blockIndex = tripno.position.x / blockWidth;
+#ifdef TRIPNO_ALLOC_COUNT
+	drawAllocations();
+#endif
 
-	int tripnoY = getTripnoAbsoluteY();
-	if (tripnoY <= gameField.y + ceilHeights[blockIndex] ||
-		tripnoY >= gameField.y + gameField.height - floorHeights[blockIndex]) {
-		tripno.velocity *= -1;
-	}
+#ifdef TRIPNO_TRACE
+	traceDrawEnd = TRACE_TIME();
+#endif
 }
 
 //--------------------------------------------------------------
-void testApp::moveSegments(int count) {
-
-	if (count <= 0) {
-		return;
-	}
+void testApp::plotSpectrum() {
+	soundMutex.lock();
+	t_plotFrame plot = plots.copy(arena, graph.has(CONSUMER_SPECTRUM_PLOT));
+	soundMutex.unlock();
 
-	for (int i = 0; i < SEGMENTS_STORED - count; ++i) {
-		ceilHeights[i] = ceilHeights[i + count];
-		floorHeights[i] = floorHeights[i + count];
+	renderer.plotSpectrum(plot, analyzer.getMinFreqLog(), analyzer.getMaxFreqLog());
+}
 
-		skyline[i] = skyline[i + count];
-		earthline[i] = earthline[i + count];
+#ifdef TRIPNO_ALLOC_COUNT
+//--------------------------------------------------------------
+// new per frame and thread since the last refresh, and the arena
+void testApp::drawAllocations() {
+	allocFrames++;
+
+	uint64_t now = ofGetElapsedTimeMicros();
+	if (now - allocLastTime >= ALLOC_OVERLAY_SECONDS * 1000000) {
+		t_allocCount counts[ALLOC_MAX_THREADS];
+		int count = allocSnapshot(counts, ALLOC_MAX_THREADS);
+
+		allocText = "allocations per frame, arena " + ofToString(arena.getSize() / 1024) + " kB, "
+			+ ofToString(arena.getSpills()) + " spills";
+		for (int i = 0; i < count; i++) {
+			// counts wrap, the difference does not
+			const t_allocCount& last = allocLast[i];
+			uint32_t allocations = counts[i].allocations - (i < allocLastCount ? last.allocations : 0);
+			uint32_t bytes = counts[i].bytes - (i < allocLastCount ? last.bytes : 0);
+			allocText += "\n" + string(counts[i].thread ? counts[i].thread : "thread " + ofToString(i)) + " "
+				+ ofToString((double)allocations / allocFrames, 1) + " new, "
+				+ ofToString((double)bytes / allocFrames, 0) + " B";
+			allocLast[i] = counts[i];
+		}
+		allocLastCount = count;
+		allocLastTime = now;
+		allocFrames = 0;
 	}
 
-	for (int i = SEGMENTS_STORED - count; i < SEGMENTS_STORED; i++)
-	{
-		floorHeights[i] = ceilHeights[i] = 0;
-		earthline[i] = skyline[i] = ofRectangle(0,0,0,0);
-	}
+	ofSetColor(184, 184, 184);
+	ofDrawBitmapString(allocText, 10, 80);
 }
+#endif
 
 //--------------------------------------------------------------
-void testApp::draw(){
-	plotSpectrum();
-	
-	drawScene();
-	
-	drawSceneDebug();
-}
+void testApp::audioIn(float * input, int bufferSize, int nChannels){	
+	TRACE_THREAD_NAME("audio");
+	ALLOC_THREAD_NAME("audio");
+	TRACE_ZONE("audioIn");
 
-//--------------------------------------------------------------
-void testApp::drawScene() {
+	// late callbacks, hop or not
+	uint64_t now = ofGetElapsedTimeMicros();
+	audioInterval = lastAudioIn ? (now - lastAudioIn) / 1000000.0 : 0;
+	lastAudioIn = now;
+
+	// only the stages the enabled consumers read are run
+	soundMutex.lock();
+	dspGraph graph = this->graph;
+	soundMutex.unlock();
 
-	ofSetColor(63, 83, 140, 128);
-    ofFill();
+	if (!envelope.isEnabled()) {
+		processHop(graph, input, bufferSize, nChannels);
+		return;
+	}
 
+	// small blocks: the envelope follows each of them, the pitch chain
+	// runs on every AUDIO_HOP_SIZE frames gathered
+	envelope.process(input, bufferSize, nChannels);
 
-	ofRect(paddingTop);
-	ofRect(paddingBottom);
+	for (int frame = 0; frame < bufferSize; ) {
+		int count = min(bufferSize - frame, AUDIO_HOP_SIZE - hopFrames);
+		copy(input + frame * nChannels, input + (frame + count) * nChannels, hopBuffer.begin() + hopFrames * nChannels);
+		hopFrames += count;
+		frame += count;
 
-	for (int i = 0; i < SEGMENTS_STORED; ++i) {
-		ofRect(skyline[i]);
-		ofRect(earthline[i]);
+		if (hopFrames == AUDIO_HOP_SIZE) {
+			processHop(graph, &hopBuffer[0], AUDIO_HOP_SIZE, nChannels);
+			hopFrames = 0;
+		}
 	}
 
-	ofSetColor(255, 85, 84, 128);
-    ofFill();
-	ofCircle(tripno.position.x, getTripnoAbsoluteY(), viewPort.width * 0.03);
-}
-
-double testApp::getTripnoAbsoluteY() {
-	return viewPort.height * 0.5 - tripno.position.y;
+	if (!idle.isIdle() && graph.has(CONSUMER_GAME)) {
+		simulation.pushControl(envelope.mix(pitchControl));
+	}
 }
 
 //--------------------------------------------------------------
-void testApp::drawSceneDebug() {
-	const int lengthMul = 1;
-	int x = viewPort.width * 0.3;
-	int y = viewPort.height * 0.5 - tripno.position.y;
-
-	ofSetColor(255, 40, 40, 128);
-	ofLine(x+1, y, x+1, y - tripno.dbgSignal * lengthMul);
+void testApp::processHop(const dspGraph& graph, float* input, int bufferSize, int nChannels) {
+	uint64_t start = ofGetElapsedTimeMicros();
 
-	ofSetColor(40, 255, 40, 128);
-	int elasticLength = tripno.elastic * lengthMul;
-	ofLine(x, y, x, y - elasticLength);
+	// the capture is stamped on the control stream clock
+	capture.push(input, bufferSize, nChannels, controlStreamTime());
 
-	ofSetColor(40, 40, 255, 128);
-	ofLine(x-1, y, x-1, y - tripno.resistance * lengthMul);
-
-}
+	// a newly selected player takes over from this hop
+	t_calibration loaded;
+	if (calibrations.take(loaded)) {
+		analyzer.setCalibration(loaded);
+	}
 
-//--------------------------------------------------------------
-void testApp::plotSpectrum() {
+	t_analysis analysis = t_analysis();
+	governor.setSpectrumStage(graph.needs(STAGE_FFT));
+	analyzer.setPitchInterval(governor.getPitchInterval());
 
-	/*soundMutex.lock();
-	vector < vector < float > > buffer(spectrum.size());
-	for (int i = 0; i < spectrum.size(); i++)
-	{
-		vector<float> newLine(spectrum[i]);
-		buffer[i] = newLine;
+	if (graph.needs(STAGE_GATE)) {
+		analyzer.gate(input, bufferSize, nChannels, analysis);
 	}
-	soundMutex.unlock();
 
-	ofSetLineWidth(2);
-	double maxLog = log(MAX_FBAND) / log(2);
-	int maxHeight = viewPort.height / 2;
+	// idle, only the level of the hop is looked at until a voice comes
+	const bool awake = idle.listen(analysis.peak);
 
-	for (int i = 0; i < buffer.size(); ++i)
-	{
-		vector<float> line = buffer[buffer.size() - i - 1];
+	if (awake && graph.needs(STAGE_FFT) && governor.hasSpectrum()) {
+		processSpectrum(graph, analyzer.getSignal(), analyzer.getWindowSize(), analyzer.getAnalysisRate());
+	}
 
-		float maxVal = 0;
-		int yFrom = 0, yTo = 0;
-		float maxFreq = 0;
-		int prevHeight = 0;
-		for (int j = 0; j < line.size(); ++j)
-		{
-			float logFreq = log(j)/ log(2);
-			int y = logFreq / maxLog * maxHeight;
-			
-			if(1 == line[j])
-			{
-				maxVal = line[j];
-				yFrom = max(0, y);
-				if (yFrom != 0) {
-					yTo = prevHeight;
-				}
-				maxFreq = logFreq;
-			}
-
-			int color = 255-line[j] * 255;
-			ofSetColor(color, color, color);
-			ofLine(i, maxHeight - y, i, maxHeight - prevHeight);
-
-			prevHeight = y;
+	if (graph.needs(STAGE_PITCH)) {
+		TRACE_ZONE("pitch");
+		if (awake) {
+			analyzer.pitch(analysis);
 		}
+		else {
+			analyzer.skipPitch(analysis);
+		}
+	}
 
-		ofSetColor(240, 84, 84);
-		ofLine(i, maxHeight - yFrom, i, maxHeight - yTo);
-
-		ofSetColor(184, 184, 184);
-		//ofLine(i, viewPort.height, i, viewPort.height - maxFreq / maxLog * maxHeight);
-	}*/
+	if (awake && graph.needs(STAGE_RANGE)) {
+		analyzer.mapRange(analysis);
+	}
 
-	ofSetLineWidth(1);
+	if (awake && graph.needs(STAGE_SMOOTHER)) {
+		analyzer.smooth(analysis);
+	}
 
-	ofSetColor(184, 184, 184, 128);
-	const int controlBaseLine = viewPort.height - viewPort.height / 2;
-	const int signalMultiplier = 40;
-	for (int i = 0; i < pitches.size(); i++)
-	{
-		ofLine(i, controlBaseLine, i, controlBaseLine - control[control.size() - i - 1] * signalMultiplier);
-		ofLine(i, viewPort.height, i, viewPort.height- pitches[pitches.size() - i - 1] * signalMultiplier);
+	if (awake) {
+		// without a pitch stage there is no telling, the game never idles
+		idle.update(analysis.freq > 0 || !graph.needs(STAGE_PITCH));
 	}
+	storeRelease(&idleState, idle.isIdle() ? 1 : 0);
 
-	ofSetColor(184, 84, 84, 128);
-	int minFreqY = viewPort.height - minFreqLog * signalMultiplier;
-	int maxFreqY = viewPort.height - maxFreqLog * signalMultiplier;
-	ofLine(0, minFreqY, viewPort.width, minFreqY);
-	ofLine(0, maxFreqY, viewPort.width, maxFreqY);
-}
+	// Append data
+	if (awake && graph.has(CONSUMER_CONTROL_PLOT)) {
+		soundMutex.lock();
+		plots.pushPoint(analysis.freqLog, analysis.control);
+		soundMutex.unlock();
+	}
 
-//--------------------------------------------------------------
-void testApp::audioIn(float * input, int bufferSize, int nChannels){	
+	if (awake && graph.has(CONSUMER_GAME)) {
+		// mixed with the envelope, audioIn pushes it on every block
+		pitchControl = analysis.control;
+		if (!envelope.isEnabled()) {
+			simulation.pushControl(analysis.control);
+		}
+	}
 
-	float* left = new float[bufferSize];
-	float* right = new float[bufferSize];
+	if (graph.has(CONSUMER_STREAM)) {
+		t_controlRecord record = t_controlRecord();
+		record.freq = analysis.freq;
+		record.freqLog = analysis.freqLog;
+		record.control = analysis.control;
+		record.peak = analysis.peak;
+		publisher.publish(record);
+	}
 
-	for (int i = 0; i < bufferSize; i++){
-		left[i]		= input[i*2];
-		right[i]	= input[i*2+1];
+	// the tier of the next hop, from the time this one took. Idle hops
+	// say nothing of the analysis cost.
+	uint64_t end = ofGetElapsedTimeMicros();
+	if (awake) {
+		governor.update((end - start) / 1000000.0, audioInterval);
 	}
 
-	// Find max signal for this sample
-	double maxSignalLocal = 0;
-	for (int i = 0; i < AUDIO_BUFFER_SIZE; i++)
-	{
-		maxSignalLocal = max(maxSignalLocal, (double)abs(left[i]));
+	// the candidates run this block later, on their own thread
+	if (graph.has(CONSUMER_SHADOW)) {
+		shadows.push(input, bufferSize, nChannels, analysis, awake, end - start);
 	}
-	// Update max signal or slightly reduce it
-	maxSignal = maxSignalLocal > maxSignal
-		? maxSignalLocal
-		: maxSignal * config.maxSignalClampRate;
 
-	// Gate signal with half of maxSignal value
-	for (int i = 0; i < AUDIO_BUFFER_SIZE; i++)
-	{
-		if (abs(left[i]) > maxSignal * config.gateThreshold) {
-			continue;
-		}
-		
-		left[i] = 0;
-	}
-
-	//Get fft
-	fft->setSignal(left);
-	size_t count = fft->getBinSize();
-	float* amplitudes = fft->getAmplitude();
-
-	// Find average aplitude and clamp signal range
-	const size_t minIndex = MIN_VOICE_FREQ * AUDIO_BUFFER_SIZE / SAMPLE_RATE;
-	const size_t maxIndex = MAX_VOICE_FREQ * AUDIO_BUFFER_SIZE / SAMPLE_RATE;
-	float averageAmp = 0;
-	for (size_t i = 0; i < count; i++)
-	{
-		if (i < minIndex || i >= maxIndex)
+	soundMutex.lock();
+	shownTier = governor.getTier();
+	shownLoad = governor.getLoad();
+	calibration = analyzer.getCalibration();
+	calibrationLoad = calibrations.getTaken();
+	soundMutex.unlock();
+}
+
+//--------------------------------------------------------------
+void testApp::processSpectrum(const dspGraph& graph, float* signal, int size, double rate) {
+	TRACE_ZONE("processSpectrum");
+
+	//Get fft, the analysis window is left as it is
+	fft.transform(signal, fftBuffer);
+	size_t count = fft.getBinSize();
+	const size_t plotted = min(count, (size_t)MAX_FBAND);
+
+	if (graph.needs(STAGE_SPECTRAL_GATE)) {
+		// Only the voice band is computed, the rest stays 0
+		const size_t minIndex = MIN_VOICE_FREQ * size / rate;
+		const size_t maxIndex = min(count, (size_t)(MAX_VOICE_FREQ * size / rate));
+		std::fill(amplitudes, amplitudes + plotted, 0.0f);
+		fft.amplitude(fftBuffer, amplitudes, minIndex, maxIndex);
+
+		// Find average aplitude
+		float averageAmp = 0;
+		for (size_t i = minIndex; i < maxIndex; i++)
 		{
-			amplitudes[i] = 0;
+			averageAmp += amplitudes[i];
 		}
+		averageAmp /= maxIndex - minIndex;
 
-		averageAmp += amplitudes[i];
+		// Gate amplitudes with average amp. And pow 2 the rest.
+		for (size_t i = minIndex; i < maxIndex; i++)
+		{
+			amplitudes[i] = amplitudes[i] > averageAmp 
+				? amplitudes[i] * amplitudes[i]
+				: 0;
+		}
 	}
-	averageAmp /= maxIndex - minIndex;
 
-	// Gate amplitudes with average amp. And pow 2 the rest.
-	for (size_t i = minIndex; i <= maxIndex; i++)
-	{
-		amplitudes[i] = amplitudes[i] > averageAmp 
-			? amplitudes[i] * amplitudes[i]
-			: 0;
+	else {
+		fft.amplitude(fftBuffer, amplitudes, 0, plotted);
 	}
 
-	// Get filtered signal with inverse fft.
-	float* filteredSignal = new float[AUDIO_BUFFER_SIZE];
-	memcpy(filteredSignal, fft->getSignal(), sizeof(float) * AUDIO_BUFFER_SIZE);
-
-	// Convert signal to double array.
-	double* samples = new double[AUDIO_BUFFER_SIZE];
-	for (int i = 0; i < AUDIO_BUFFER_SIZE; i++)
-	{
-		samples[i] = left[i];
+	if (graph.has(CONSUMER_SPECTRUM_PLOT)) {
+		// spectrogram line of the low bands, scaled to the strongest one
+		soundMutex.lock();
+		plots.pushLine(amplitudes);
+		soundMutex.unlock();
 	}
+}
 
-	// Get pitch
-	dywapitchtracker pitchtracker;
-	dywapitch_inittracking(&pitchtracker);
-	double freq =  max(0.0, dywapitch_computepitch(&pitchtracker, samples, 0, AUDIO_BUFFER_SIZE));
-
-	// Get rid off the array
-	delete[] filteredSignal;
+//--------------------------------------------------------------
+void testApp::keyPressed  (int key){ 
+	if( key == 's' ){
+		// the pause is not a late callback
+		lastAudioIn = 0;
+		soundStream.start();
+	}
+	
+	if( key == 'e' ){
+		soundStream.stop();
+	}
 
-	double freqLog = 0;
-	double delta = 0;
+	if( key == 'r' ){
+		readConfig();
+	}
 
-	// Calculate delata (control signal)
-	if (freq > 0)
-	{
-		freqLog = log(freq);
+	if( key == 't' ){
+		writeTrace(ofToDataPath("trace-" + ofGetTimestampString() + ".json"));
+	}
 
-		if (freqLog < minFreqLog) {
-			minFreqLog = freqLog;
-		}
-		else {
-			minFreqLog *= 1.0 + config.rangeClampRate;
-		}
+	// 1 - 9 : player profiles, 0 : the default one
+	if( key >= '0' && key <= '9' ){
+		selectProfile(key == '0' ? CALIBRATION_DEFAULT_PROFILE : "player" + ofToString(key - '0'));
+	}
 
-		if (freqLog > maxFreqLog) {
-			maxFreqLog = freqLog;
+	if( key == 'c' ){
+		if (capture.isCapturing()) {
+			stopCapture();
 		}
 		else {
-			maxFreqLog *= 1.0 - config.rangeClampRate;
+			startCapture();
 		}
+	}
+}
 
-		double centralFreqLog = (minFreqLog + maxFreqLog) /2;
-		
-		delta = freqLog - centralFreqLog;
-
-		delta = smoothSignal(delta, control);
+//--------------------------------------------------------------
+void testApp::selectProfile(const string& name) {
+	if (name == profile) {
+		return;
 	}
 
-	// Append data
+	saveCalibration();
+	profile = name;
+	profileLoad = calibrations.load(getCalibrationPath(profile));
+}
+
+//--------------------------------------------------------------
+void testApp::saveCalibration() {
 	soundMutex.lock();
-	control.push_back(delta);
-	pitches.push_back(freqLog);
+	t_calibration current = calibration;
+	bool ours = calibrationLoad == profileLoad;
 	soundMutex.unlock();
 
-	delete[] left;
-	delete[] right;
+	// nothing learnt, or the audio has not taken the profile up yet :
+	// the profile on disk stays as it is
+	if (!ours || current.voicedSeconds <= 0) {
+		return;
+	}
+
+	string path = getCalibrationPath(profile);
+	if (writeCalibration(path, current)) {
+		ofLogNotice() << "calibration saved to " << path;
+	}
+	else {
+		ofLogWarning() << "cannot save the calibration to " << path;
+	}
 }
 
 //--------------------------------------------------------------
-float testApp::smoothSignal(float rawVal, vector<float> signal) {
-	size_t count = signal.size();
+string testApp::getCalibrationPath(const string& name) {
+	return ofToDataPath("calibration-" + name + ".bin");
+}
 
-	if (!count) {
-		return rawVal;
+//--------------------------------------------------------------
+void testApp::startCapture() {
+	if (!graph.has(CONSUMER_RECORDER)) {
+		ofLogWarning() << "the recorder is not in the consumers of config.xml, not capturing";
+		return;
 	}
 
-	return (signal[count - 1] + rawVal) / 2.0f;
+	captureFormat format = config.capture == CAPTURE_RAW ? CAPTURE_RAW : CAPTURE_WAV;
+	string path = ofToDataPath("capture-" + ofGetTimestampString() + (format == CAPTURE_RAW ? ".raw" : ".wav"));
+
+	if (capture.start(path, format, config.capturePreallocate)) {
+		ofLogNotice() << "capturing to " << path;
+	}
+	else {
+		ofLogWarning() << "cannot capture to " << path;
+	}
 }
 
 //--------------------------------------------------------------
-void testApp::keyPressed  (int key){ 
-	if( key == 's' ){
-		soundStream.start();
-	}
-	
-	if( key == 'e' ){
-		soundStream.stop();
+void testApp::stopCapture() {
+	capture.stop();
+
+	ofLogNotice() << "captured " << capture.getBlocksWritten() << " blocks to " << capture.getPath()
+		<< ", " << capture.getOverflows() << " dropped";
+	if (capture.hasFailed()) {
+		ofLogError() << "writing " << capture.getPath() << " failed, the capture is incomplete";
 	}
+}
 
-	if( key == 'r' ){
-		readConfig();
+//--------------------------------------------------------------
+void testApp::setTraceFile(const string& path) {
+	traceFile = path;
+}
+
+//--------------------------------------------------------------
+void testApp::writeTrace(const string& path) {
+#ifdef TRIPNO_TRACE
+	if (traceWrite(path)) {
+		ofLogNotice() << "trace written to " << path << ", open it in ui.perfetto.dev";
 	}
+	else {
+		ofLogError() << "cannot write the trace to " << path;
+	}
+#else
+	ofLogWarning() << "built without TRIPNO_TRACE, no trace to write";
+#endif
 }
 
 //--------------------------------------------------------------
@@ -495,15 +656,11 @@ void testApp::mouseReleased(int x, int y, int button){
 
 //--------------------------------------------------------------
 void testApp::windowResized(int w, int h){
-	for (int i = 0; i < SEGMENTS_STORED; ++i) {
-		skyline[i] = ofRectangle(0,0,0,0);
-		earthline[i] = ofRectangle(0,0,0,0);
-	}
-
-	paddingTop = paddingBottom = ofRectangle(0,0,0,0);
-	
 	viewPort.width = w;
 	viewPort.height = h;
+
+	renderer.setViewPort(viewPort);
+	simulation.setViewPort(viewPort);
 }
 
 //--------------------------------------------------------------
@@ -518,6 +675,18 @@ void testApp::dragEvent(ofDragInfo dragInfo){
 
 //--------------------------------------------------------------
 testApp::~testApp(){
-	delete[] fftOutput;
-	delete fft;
+	soundStream.close();
+	shadows.stop();
+	saveCalibration();
+	calibrations.waitForThread(true);
+	if (!traceFile.empty()) {
+		writeTrace(traceFile);
+	}
+	if (capture.isCapturing()) {
+		stopCapture();
+	}
+	simulation.waitForThread(true);
+
+	delete[] fftBuffer;
+	delete[] amplitudes;
 }
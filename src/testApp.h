@@ -1,41 +1,25 @@
 #pragma once
 
 #include "ofMain.h"
-#include "ofxFft.h"
-#include "dywapitchtrack.h"
-
-#define SEGMENTS_PER_VIEWPORT 20
-#define SEGMENTS_STORED SEGMENTS_PER_VIEWPORT + 1
-#define SEGMENT_MAX_HEIGHT_PART 0.2
-#define MOVEMENT_SPEED 2 // Segments per second
-#define VIEWPORT_ASPECT 1.77777778
-#define SAMPLE_RATE 44100
-#define AUDIO_BUFFER_SIZE 4096
-#define MAX_FBAND 200
-#define MIN_VOICE_FREQ 40
-#define MAX_VOICE_FREQ 3000
-
-struct movableObject {
-	double mass;
-
-	ofPoint position;
-	double velocity;
-
-	double elastic;
-	double resistance;
-
-	double dbgSignal;
-};
-
-struct t_config {
-	double signalAmp;
-	double elasticKoeff;
-	double resistanceKoeff;
-
-	double gateThreshold;
-	double maxSignalClampRate;
-	double rangeClampRate;
-};
+#include "pitchAnalyzer.h"
+#include "tripnoConfig.h"
+#include "gameSimulation.h"
+#include "controlStream.h"
+#include "audioCapture.h"
+#include "traceZones.h"
+#include "dspGraph.h"
+#include "realFft.h"
+#include "sceneRenderer.h"
+#include "calibrationLoader.h"
+#include "qualityGovernor.h"
+#include "idleMonitor.h"
+#include "envelopeFollower.h"
+#include "shadowAnalyzers.h"
+#include "plotHistory.h"
+#include "frameArena.h"
+#include "allocCounter.h"
+
+#define ALLOC_OVERLAY_SECONDS 1 // the allocation counts are averaged over
 
 class testApp : public ofBaseApp{
 
@@ -56,42 +40,94 @@ class testApp : public ofBaseApp{
 
 		void audioIn(float * input, int bufferSize, int nChannels); 
 
+		// the trace is written there on exit, needs TRIPNO_TRACE
+		void setTraceFile(const string& path);
+
 		~testApp();
 	
 private:
-		movableObject tripno;
-
-		int ceilHeights[SEGMENTS_STORED], floorHeights[SEGMENTS_STORED];
-		ofRectangle skyline[SEGMENTS_STORED], earthline[SEGMENTS_STORED];
-		ofRectangle paddingTop, paddingBottom;
-		ofRectangle gameField, viewPort;
-		int currentIndex;
-		double minFreqLog;
-		double maxFreqLog;
-		double maxSignal;
-
-		vector < vector < float > > spectrum;
-		vector <float> pitches;
-		vector <float> control;
-
-		ofxFft* fft;
-		float* fftOutput;
-		
-		unsigned long long timeElapsed;
+		gameSimulation simulation;
+
+		ofRectangle viewPort;
+		sceneRenderer renderer;
+
+		dspGraph graph; // guarded by soundMutex for the audio thread
+
+		plotHistory plots; // guarded by soundMutex
+		frameArena arena; // what a frame builds and drops, main thread
+
+		realFft fft;
+		float* fftBuffer; // transform of the analysis window
+		float* amplitudes;
+
+		pitchAnalyzer<TRIPNO_SAMPLE_TYPE> analyzer;
 
 		ofSoundStream soundStream;
 		t_config config;
 
 		ofMutex soundMutex;
 
-		double getTripnoAbsoluteY();
-		void moveSegments(int index);
-		void updateBackground();
-		void updateTripno(float dt);
-		void drawScene();
+		qualityGovernor governor; // audio thread only
+		uint64_t lastAudioIn;
+		double audioInterval; // s since the previous audioIn began
+		qualityTier shownTier; // of the last hop, for the overlay, guarded by soundMutex
+		double shownLoad;
+
+		idleMonitor idle; // audio thread only
+		uint32_t idleState; // idle.isIdle() of the last hop, for the main thread
+		bool paused; // main thread
+		uint64_t lastFrame;
+
+		envelopeFollower envelope; // audio thread only, but for setConfig
+		vector<float> hopBuffer; // small blocks gathered for the pitch chain
+		int hopFrames;
+		float pitchControl; // of the last hop
+
+		calibrationLoader calibrations;
+		string profile;
+		uint32_t profileLoad; // number of the load of profile
+		t_calibration calibration; // of the last hop, guarded by soundMutex
+		uint32_t calibrationLoad; // the load it grew from, guarded by soundMutex
+
+		controlPublisher publisher;
+		audioCapture capture;
+		shadowAnalyzers shadows;
+
 		void plotSpectrum();
-		void drawSceneDebug();
-		float smoothSignal(float rawVal, vector<float> signal);
+		void processHop(const dspGraph& graph, float* input, int bufferSize, int nChannels);
+		void processSpectrum(const dspGraph& graph, float* signal, int size, double rate);
 
 		void readConfig();
+		void selectProfile(const string& name);
+		void saveCalibration();
+		string getCalibrationPath(const string& name);
+		void startCapture();
+		void stopCapture();
+		void writeTrace(const string& path);
+
+		// the overlay lines, remade only when what they show changes
+		string statusText;
+		qualityTier statusTier;
+		int statusLoad; // percent
+		string statusProfile;
+		string captureText;
+		uint32_t captureOverflows;
+		string shadowText;
+		uint32_t shadowShed;
+		string idleText;
+
+		string traceFile;
+#ifdef TRIPNO_TRACE
+		uint64_t traceDrawEnd; // the rest of the frame after draw() is the buffer swap
+#endif
+
+#ifdef TRIPNO_ALLOC_COUNT
+		void drawAllocations();
+
+		t_allocCount allocLast[ALLOC_MAX_THREADS]; // at the last refresh
+		int allocLastCount;
+		uint64_t allocLastTime;
+		uint32_t allocFrames; // drawn since
+		string allocText;
+#endif
 };
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include "traceZones.h"
+
+#ifdef TRIPNO_TRACE
+
+#include "atomicOps.h"
+#include "controlStream.h"
+
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACE_THREAD_LOCAL __thread
+#endif
+
+struct t_traceEvent {
+	const char* name;
+	uint64_t start;
+	uint64_t end;
+};
+
+// written only by its thread, count is the number of events ever recorded
+struct t_traceBuffer {
+	uint32_t count;
+	const char* threadName;
+	t_traceEvent events[TRACE_BUFFER_EVENTS];
+};
+
+static void* buffers[TRACE_MAX_THREADS];
+static uint32_t bufferCount;
+
+static TRACE_THREAD_LOCAL t_traceBuffer* threadBuffer;
+static TRACE_THREAD_LOCAL bool threadRejected;
+
+//--------------------------------------------------------------
+static t_traceBuffer* getThreadBuffer() {
+	if (threadBuffer || threadRejected) {
+		return threadBuffer;
+	}
+
+	uint32_t index = fetchAdd(&bufferCount, 1);
+	if (index >= TRACE_MAX_THREADS) {
+		threadRejected = true;
+		return NULL;
+	}
+
+	// lives until the process exits, the writer may still read it
+	t_traceBuffer* buffer = new t_traceBuffer();
+	storeReleasePointer(&buffers[index], buffer);
+	threadBuffer = buffer;
+	return buffer;
+}
+
+//--------------------------------------------------------------
+uint64_t traceTime() {
+	return controlStreamTime();
+}
+
+//--------------------------------------------------------------
+void traceRecord(const char* name, uint64_t start, uint64_t end) {
+	t_traceBuffer* buffer = getThreadBuffer();
+	if (!buffer) {
+		return;
+	}
+
+	t_traceEvent& event = buffer->events[buffer->count & (TRACE_BUFFER_EVENTS - 1)];
+	event.name = name;
+	event.start = start;
+	event.end = end;
+	storeRelease(&buffer->count, buffer->count + 1);
+}
+
+//--------------------------------------------------------------
+void traceThreadName(const char* name) {
+	t_traceBuffer* buffer = getThreadBuffer();
+	if (buffer) {
+		storeReleasePointer((void**)&buffer->threadName, (void*)name);
+	}
+}
+
+//--------------------------------------------------------------
+// Copies the events of one thread that were not overwritten during the copy
+static void copyEvents(t_traceBuffer* buffer, std::vector<t_traceEvent>& events) {
+	uint32_t end = loadAcquire(&buffer->count);
+	uint32_t begin = end > TRACE_BUFFER_EVENTS ? end - TRACE_BUFFER_EVENTS : 0;
+
+	events.clear();
+	for (uint32_t i = begin; i != end; i++) {
+		events.push_back(buffer->events[i & (TRACE_BUFFER_EVENTS - 1)]);
+	}
+
+	// the thread may be writing event count, over event count - capacity
+	fenceAcquire();
+	uint32_t now = loadAcquire(&buffer->count);
+	uint32_t firstValid = now + 1 > TRACE_BUFFER_EVENTS ? now + 1 - TRACE_BUFFER_EVENTS : 0;
+	if (firstValid > begin) {
+		events.erase(events.begin(), events.begin() + std::min<uint32_t>(firstValid - begin, events.size()));
+	}
+}
+
+//--------------------------------------------------------------
+bool traceWrite(const std::string& path) {
+	FILE* file = fopen(path.c_str(), "w");
+	if (!file) {
+		return false;
+	}
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"tripno\"}}");
+
+	uint32_t threads = std::min<uint32_t>(loadAcquire(&bufferCount), TRACE_MAX_THREADS);
+	std::vector<t_traceEvent> events;
+	events.reserve(TRACE_BUFFER_EVENTS);
+
+	for (uint32_t tid = 0; tid < threads; tid++) {
+		t_traceBuffer* buffer = (t_traceBuffer*)loadAcquirePointer(&buffers[tid]);
+		if (!buffer) {
+			continue; // registered, not published yet
+		}
+
+		const char* threadName = (const char*)loadAcquirePointer((void* const*)&buffer->threadName);
+		if (threadName) {
+			fprintf(file, ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}",
+				tid, threadName);
+		}
+
+		copyEvents(buffer, events);
+		for (size_t i = 0; i < events.size(); i++) {
+			fprintf(file, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"name\":\"%s\",\"ts\":%llu,\"dur\":%llu}",
+				tid, events[i].name, (unsigned long long)events[i].start,
+				(unsigned long long)(events[i].end - events[i].start));
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+	return fclose(file) == 0;
+}
+
+#endif
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+// Timeline of what every thread does, for chrome://tracing or Perfetto.
+//
+// TRACE_ZONE("name") records the time from there to the end of the scope.
+// Each thread writes its zones to its own ring of TRACE_BUFFER_EVENTS, with
+// no lock and no allocation after the first zone of the thread; the oldest
+// zones are overwritten. traceWrite() copies the rings of all threads while
+// they keep running and writes them as Chrome Trace Event JSON.
+//
+// Tracing is compiled in only with TRIPNO_TRACE defined. Without it, the
+// macros expand to nothing and cost nothing.
+//
+// Zone names must be string literals, only the pointer is kept.
+
+#define TRACE_BUFFER_EVENTS 65536 // per thread, ~20 s of the audio thread
+#define TRACE_MAX_THREADS 16
+
+#ifdef TRIPNO_TRACE
+
+uint64_t traceTime();
+void traceRecord(const char* name, uint64_t start, uint64_t end);
+void traceThreadName(const char* name);
+bool traceWrite(const std::string& path);
+
+class traceScope {
+
+	public:
+		traceScope(const char* name) : name(name), start(traceTime()) {}
+		~traceScope() { traceRecord(name, start, traceTime()); }
+
+	private:
+		const char* name;
+		uint64_t start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#define TRACE_ZONE(name) traceScope TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_SPAN(name, start, end) traceRecord(name, start, end)
+#define TRACE_THREAD_NAME(name) traceThreadName(name)
+#define TRACE_TIME() traceTime()
+#define TRACE_WRITE(path) traceWrite(path)
+
+#else
+
+#define TRACE_ZONE(name)
+#define TRACE_SPAN(name, start, end)
+#define TRACE_THREAD_NAME(name)
+#define TRACE_TIME() 0
+#define TRACE_WRITE(path) false
+
+#endif
@@ -0,0 +1,100 @@
+#include "tripnoConfig.h"
+
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+//--------------------------------------------------------------
+// config.xml is a flat list of <key>value</key> under <config>
+static bool readValue(const std::string& xml, const std::string& key, std::string& value) {
+	std::string open = "<" + key + ">";
+	size_t begin = xml.find(open);
+	if (begin == std::string::npos) {
+		return false;
+	}
+	begin += open.size();
+
+	size_t end = xml.find("</" + key + ">", begin);
+	if (end == std::string::npos) {
+		return false;
+	}
+
+	value = xml.substr(begin, end - begin);
+	return true;
+}
+
+static bool readValue(const std::string& xml, const std::string& key, double& value) {
+	std::string text;
+	if (!readValue(xml, key, text)) {
+		return false;
+	}
+
+	value = atof(text.c_str());
+	return true;
+}
+
+//--------------------------------------------------------------
+t_config defaultConfig() {
+	t_config config = t_config();
+	config.signalAmp = 10000;
+	config.elasticKoeff = 0.5;
+	config.resistanceKoeff = 0.005;
+	config.gateThreshold = 0.1;
+	config.maxSignalClampRate = 0.997;
+	config.rangeClampRate = 0.002;
+	config.decimation = 1;
+	return config;
+}
+
+//--------------------------------------------------------------
+bool readConfigFile(const std::string& path, t_config& config) {
+	std::ifstream file(path.c_str());
+	if (!file) {
+		return false;
+	}
+
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	const std::string xml = buffer.str();
+
+	double decimation = config.decimation;
+	double capture = config.capture;
+	double governor = config.governor;
+	double windowMin = config.windowMin;
+	double windowMax = config.windowMax;
+	double envelopeBlock = config.envelopeBlock;
+
+	readValue(xml, "signalAmp", config.signalAmp);
+	readValue(xml, "elasticKoeff", config.elasticKoeff);
+	readValue(xml, "resistanceKoeff", config.resistanceKoeff);
+	readValue(xml, "gateThreshold", config.gateThreshold);
+	readValue(xml, "maxSignalClampRate", config.maxSignalClampRate);
+	readValue(xml, "rangeClampRate", config.rangeClampRate);
+	readValue(xml, "decimation", decimation);
+	readValue(xml, "governor", governor);
+	readValue(xml, "windowMin", windowMin);
+	readValue(xml, "windowMax", windowMax);
+	readValue(xml, "idleTimeout", config.idleTimeout);
+	readValue(xml, "idleWakePeak", config.idleWakePeak);
+	readValue(xml, "envelopeBlend", config.envelopeBlend);
+	readValue(xml, "envelopeBlock", envelopeBlock);
+	readValue(xml, "envelopeAttack", config.envelopeAttack);
+	readValue(xml, "envelopeRelease", config.envelopeRelease);
+	readValue(xml, "envelopeGain", config.envelopeGain);
+	readValue(xml, "capture", capture);
+	readValue(xml, "capturePreallocate", config.capturePreallocate);
+	readValue(xml, "obstaclesPerSegment", config.obstaclesPerSegment);
+	readValue(xml, "pickupsPerSegment", config.pickupsPerSegment);
+	readValue(xml, "profile", config.profile);
+	readValue(xml, "stages", config.stages);
+	readValue(xml, "consumers", config.consumers);
+	readValue(xml, "shadow", config.shadow);
+
+	config.decimation = (int)decimation;
+	config.capture = (int)capture;
+	config.governor = (int)governor;
+	config.windowMin = (int)windowMin;
+	config.windowMax = (int)windowMax;
+	config.envelopeBlock = (int)envelopeBlock;
+	return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+
+struct t_config {
+	double signalAmp;
+	double elasticKoeff;
+	double resistanceKoeff;
+
+	double gateThreshold;
+	double maxSignalClampRate;
+	double rangeClampRate;
+
+	int decimation; // 1 - full rate analysis, 4 - 11025 Hz, no pitch above ~1 kHz
+	int governor; // 1 - lower the analysis quality under cpu pressure, see qualityGovernor.h
+	int windowMin; // pitch window bounds, samples at 44100 Hz, rounded, see pitchAnalyzer.h
+	int windowMax;
+
+	double idleTimeout; // s without a voice before the game idles, 0 - never, see idleMonitor.h
+	double idleWakePeak; // input peak that wakes it
+
+	double envelopeBlend; // 0 - pitch control, 1 - loudness control, see envelopeFollower.h
+	int envelopeBlock; // frames per envelope step, 32 - 128
+	double envelopeAttack; // s
+	double envelopeRelease;
+	double envelopeGain; // control per unit of peak
+
+	int capture; // records the input from startup: 0 - off, 1 - WAV, 2 - raw float32
+	double capturePreallocate; // s of capture file space reserved up front
+
+	double obstaclesPerSegment; // spawned with every wall segment, on average
+	double pickupsPerSegment;
+
+	std::string profile; // calibration profile at startup, see calibration.h
+
+	std::string stages; // audioIn pipeline, see dspGraph.h
+	std::string consumers;
+
+	std::string shadow; // candidate config files run next to the analysis, see shadowAnalyzers.h
+};
+
+// The physics and analysis values of the shipped config.xml, with the
+// governor, idling, capture, entities and the envelope off: what the
+// headless tools run with when there is no config file.
+t_config defaultConfig();
+
+// Reads data/config.xml without openFrameworks, for the headless tools.
+// Keys missing from the file keep their current value.
+bool readConfigFile(const std::string& path, t_config& config);
@@ -0,0 +1,38 @@
+#include "tripnoPhysics.h"
+
+#include <cmath>
+#include <algorithm>
+
+//--------------------------------------------------------------
+void integrateTripno(t_tripnoMotion& motion, double control, double mass, const t_config& config, double dt) {
+	motion.elastic = - config.elasticKoeff * motion.y;
+
+	double sign = motion.velocity < 0 ? -1 : 1;
+	motion.resistance = - sign * motion.velocity * motion.velocity * config.resistanceKoeff;
+
+	double acceleration = (control/* as control force */ + motion.elastic + motion.resistance) * mass;
+
+	motion.y += motion.velocity * dt + acceleration * dt * dt;
+
+	motion.velocity += acceleration * dt;
+}
+
+//--------------------------------------------------------------
+bool bounceTripno(t_tripnoMotion& motion, double ceilLimit, double floorLimit) {
+	if (motion.y >= ceilLimit) {
+		motion.y = std::max(floorLimit, 2 * ceilLimit - motion.y);
+		motion.velocity = -fabs(motion.velocity);
+		return true;
+	}
+	if (motion.y <= floorLimit) {
+		motion.y = std::min(ceilLimit, 2 * floorLimit - motion.y);
+		motion.velocity = fabs(motion.velocity);
+		return true;
+	}
+	return false;
+}
+
+//--------------------------------------------------------------
+double gameFieldHeight(double viewPortWidth) {
+	return viewPortWidth / VIEWPORT_ASPECT;
+}
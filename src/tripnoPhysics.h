@@ -0,0 +1,30 @@
+#pragma once
+
+#include "tripnoConfig.h"
+
+#define SIMULATION_RATE 240 // steps per second
+#define VIEWPORT_ASPECT 1.77777778 // of the game field
+#define SEGMENT_MAX_HEIGHT_PART 0.2 // highest wall, part of the game field, the lowest is half of it
+#define MOVEMENT_SPEED 2 // Segments per second
+
+// Vertical motion of tripno, in pixels up from the middle of the view
+struct t_tripnoMotion {
+	double y;
+	double velocity;
+
+	// forces of the last step, for the debug lines
+	double elastic;
+	double resistance;
+};
+
+// One step of tripno without the walls: the control force, the elastic
+// pull back to the middle and a quadratic air resistance. Free of
+// openFrameworks, so the headless tools move tripno the way the game does.
+void integrateTripno(t_tripnoMotion& motion, double control, double mass, const t_config& config, double dt);
+
+// Bounces tripno back by what it went past the ceiling or the floor limit,
+// in its own coordinates. True when it touched one.
+bool bounceTripno(t_tripnoMotion& motion, double ceilLimit, double floorLimit);
+
+// the height of the game field, the walls live in, in a viewport that wide
+double gameFieldHeight(double viewPortWidth);
@@ -0,0 +1,302 @@
+// Heap allocations of the game's threads once they run, headless.
+//
+// The audio thread runs the analysis chain and the spectrum of every hop
+// into a plotHistory, the simulation thread steps tripno and a level of
+// entities, and the main thread does the frame work of testApp for the
+// plots: the frameArena is reset and the plots copied into it under the
+// lock. The drawing itself, sceneRenderer and the overlay, needs
+// openFrameworks and is not run. They run as fast as they can, each for its
+// share of the frames at 60 Hz; a frame waits for the hops before it, so it
+// copies what the game would. Every new is counted per thread (see
+// allocCounter.h); after the warm-up frames none is expected.
+//
+// Before that, a loader thread is started and ended over and over, as
+// calibrationLoader is on every profile switch. It has to keep one counter
+// slot.
+//
+// usage: tripnoAllocSoak [config.xml] [-f frames] [-w warm-up frames]
+//
+// Exits with 1 when a thread allocates after its warm-up, the arena
+// spills, or the loader takes more than one slot.
+
+#include "pitchAnalyzer.h"
+#include "tripnoPhysics.h"
+#include "entityStore.h"
+#include "realFft.h"
+#include "plotHistory.h"
+#include "frameArena.h"
+#include "allocCounter.h"
+#include "atomicOps.h"
+#include "voiceCorpus.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+
+#define SOAK_FRAME_RATE 60
+#define SOAK_BANDS 200 // MAX_FBAND of the game
+#define SOAK_HISTORY 1024 // SPECTRUM_HISTORY of the game
+#define SOAK_SPEED 2.0f // segments per second, as the game scrolls
+#define SOAK_ENTITIES_PER_SEGMENT 2
+#define SOAK_MAX_HITS 16
+#define SOAK_RESTARTS (ALLOC_MAX_THREADS * 2)
+
+// the counts of a thread at the end of its warm-up and of its run, from
+// the thread start: the setup of the thread is in the warm-up
+struct t_soakThread {
+	const char* name;
+	int iterations;
+	int warmup;
+	uint32_t done;		// iterations so far
+	t_allocCount warm;
+	t_allocCount end;
+};
+
+//--------------------------------------------------------------
+static t_soakThread soakThread(const char* name, int iterations, int warmup) {
+	t_soakThread run = t_soakThread();
+	run.name = name;
+	run.iterations = iterations;
+	run.warmup = warmup;
+	return run;
+}
+
+//--------------------------------------------------------------
+// the counts of the calling thread, named name
+static t_allocCount threadCount(const char* name) {
+	t_allocCount counts[ALLOC_MAX_THREADS];
+	int count = allocSnapshot(counts, ALLOC_MAX_THREADS);
+	for (int i = 0; i < count; i++) {
+		if (counts[i].thread && !strcmp(counts[i].thread, name)) {
+			return counts[i];
+		}
+	}
+	return t_allocCount();
+}
+
+//--------------------------------------------------------------
+// slots in the table, after a thread named loader ran restarts times
+static int restartLoader(int restarts, uint32_t& allocations) {
+	for (int k = 0; k < restarts; k++) {
+		std::thread loader([]() {
+			// before the name, as the thread setup of ofThread does
+			std::vector<int> setup(16);
+			ALLOC_THREAD_NAME("loader");
+			std::vector<int> load(16);
+			ALLOC_THREAD_EXIT();
+		});
+		loader.join();
+	}
+
+	allocations = threadCount("loader").allocations;
+	t_allocCount counts[ALLOC_MAX_THREADS];
+	return allocSnapshot(counts, ALLOC_MAX_THREADS);
+}
+
+//--------------------------------------------------------------
+// audioIn with the control and spectrum plots as consumers, hop by hop
+static void runAudio(t_soakThread& run, const t_config& config, const std::vector<float>& signal,
+	plotHistory& plots, std::mutex& lock) {
+	ALLOC_THREAD_NAME(run.name);
+
+	pitchAnalyzer<TRIPNO_SAMPLE_TYPE> analyzer;
+	analyzer.setup(config);
+	realFft fft;
+	fft.setup(analyzer.getWindowSize(), FFT_WINDOW_RECTANGULAR);
+	std::vector<float> fftBuffer(fft.getSize());
+	std::vector<float> amplitudes(fft.getBinSize());
+	std::vector<float> input(AUDIO_HOP_SIZE * 2);
+	const int bands = std::min(fft.getBinSize(), SOAK_BANDS);
+	const size_t hops = signal.size() / AUDIO_HOP_SIZE;
+
+	for (int k = 0; k < run.iterations; k++) {
+		if (k == run.warmup) {
+			run.warm = threadCount(run.name);
+		}
+
+		const float* hop = &signal[(k % hops) * AUDIO_HOP_SIZE];
+		for (int i = 0; i < AUDIO_HOP_SIZE; i++) {
+			input[i * 2] = input[i * 2 + 1] = hop[i];
+		}
+
+		t_analysis analysis = analyzer.process(&input[0], AUDIO_HOP_SIZE, 2);
+		fft.transform(analyzer.getSignal(), &fftBuffer[0]);
+		fft.amplitude(&fftBuffer[0], &amplitudes[0], 0, bands);
+
+		lock.lock();
+		plots.pushPoint(analysis.freqLog, analysis.control);
+		plots.pushLine(&amplitudes[0]);
+		lock.unlock();
+		storeRelease(&run.done, k + 1);
+	}
+
+	run.end = threadCount(run.name);
+}
+
+//--------------------------------------------------------------
+// the simulation steps: tripno, and entities spawned per segment, moved,
+// collided and dropped behind the view
+static void runSimulation(t_soakThread& run, const t_config& config) {
+	ALLOC_THREAD_NAME(run.name);
+
+	const float dt = 1.0f / SIMULATION_RATE;
+	t_tripnoMotion motion = t_tripnoMotion();
+	entityStore entities;
+	int hits[SOAK_MAX_HITS];
+	float scroll = 0;
+	int segment = 0;
+	srand(1);
+
+	for (int k = 0; k < run.iterations; k++) {
+		if (k == run.warmup) {
+			run.warm = threadCount(run.name);
+		}
+
+		scroll += SOAK_SPEED * dt;
+		for (; segment < scroll + 20; segment++) {
+			for (int n = 0; n < SOAK_ENTITIES_PER_SEGMENT; n++) {
+				entities.add(n % 2 ? ENTITY_PICKUP : ENTITY_OBSTACLE, segment + rand() / (float)RAND_MAX,
+					10.0f * rand() / RAND_MAX - 5, 0.5f, 0.5f, n % 2 ? 0 : -0.3f);
+			}
+		}
+		entities.update(dt, scroll - 1);
+
+		integrateTripno(motion, sin(k * 0.01), 1, config, dt);
+		int count = entities.collide(scroll + 6, (float)motion.y / 50, 0.6f, hits, SOAK_MAX_HITS);
+		for (int h = 0; h < count; h++) {
+			if (entities.getKind(hits[h]) == ENTITY_PICKUP) {
+				entities.remove(hits[h]);
+			}
+		}
+	}
+
+	run.end = threadCount(run.name);
+}
+
+//--------------------------------------------------------------
+// update() and draw() without the drawing: the arena is reset, the plots
+// copied into it and read
+static double runFrames(t_soakThread& run, const t_soakThread& audio, plotHistory& plots, std::mutex& lock,
+	uint32_t& spills) {
+	ALLOC_THREAD_NAME(run.name);
+
+	frameArena arena;
+	arena.setup(FRAME_ARENA_SIZE);
+	double sum = 0;
+
+	for (int k = 0; k < run.iterations; k++) {
+		if (k == run.warmup) {
+			run.warm = threadCount(run.name);
+			spills = arena.getSpills();
+		}
+
+		const uint32_t hops = (uint32_t)((long long)audio.iterations * k / run.iterations);
+		while (loadAcquire(&audio.done) < hops) {
+			std::this_thread::yield();
+		}
+
+		arena.reset();
+		lock.lock();
+		t_plotFrame plot = plots.copy(arena, true);
+		lock.unlock();
+
+		for (int i = 0; i < plot.lines * plot.bands; i++) {
+			sum += plot.spectrum[i];
+		}
+		for (int i = 0; i < plot.points; i++) {
+			sum += plot.pitches[i] + plot.control[i];
+		}
+	}
+
+	spills = arena.getSpills() - spills;
+	run.end = threadCount(run.name);
+	return sum;
+}
+
+//--------------------------------------------------------------
+int main(int argc, char** argv) {
+	std::string configPath = "data/config.xml";
+	int frames = 3600;
+	int warmupFrames = 120;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+			frames = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-w") && i + 1 < argc) {
+			warmupFrames = atoi(argv[++i]);
+		}
+		else {
+			configPath = argv[i];
+		}
+	}
+	frames = std::max(frames, warmupFrames + 1);
+
+	t_config config = defaultConfig();
+	if (!readConfigFile(configPath, config)) {
+		fprintf(stderr, "%s not found, using defaults\n", configPath.c_str());
+	}
+
+	// the corpus, looped
+	std::vector<t_voiceSignal> corpus = voiceCorpus(SAMPLE_RATE);
+	std::vector<float> signal;
+	for (size_t i = 0; i < corpus.size(); i++) {
+		signal.insert(signal.end(), corpus[i].samples.begin(), corpus[i].samples.end());
+	}
+
+	plotHistory plots;
+	plots.setup(SOAK_HISTORY, SOAK_BANDS, SOAK_HISTORY);
+	std::mutex lock;
+
+	// the share of each thread in frames at 60 Hz
+	const int hopsPerFrame = (SAMPLE_RATE / SOAK_FRAME_RATE + AUDIO_HOP_SIZE - 1) / AUDIO_HOP_SIZE;
+	const int stepsPerFrame = SIMULATION_RATE / SOAK_FRAME_RATE;
+	t_soakThread runs[3] = {
+		soakThread("audio", frames * hopsPerFrame, warmupFrames * hopsPerFrame),
+		soakThread("simulation", frames * stepsPerFrame, warmupFrames * stepsPerFrame),
+		soakThread("main", frames, warmupFrames)
+	};
+
+	uint32_t loaderAllocations = 0;
+	// the second start leaves a slot for the setup of the next ones
+	const int slotsBefore = restartLoader(2, loaderAllocations);
+	const int slotsAfter = restartLoader(SOAK_RESTARTS - 2, loaderAllocations);
+
+	uint32_t spills = 0;
+	double sum = 0;
+	std::thread audio([&]() { runAudio(runs[0], config, signal, plots, lock); });
+	std::thread simulation([&]() { runSimulation(runs[1], config); });
+	sum = runFrames(runs[2], runs[0], plots, lock, spills);
+	audio.join();
+	simulation.join();
+
+	printf("%d frames after %d of warm-up, %d hops and %d steps per frame (checksum %g)\n\n",
+		frames - warmupFrames, warmupFrames, hopsPerFrame, stepsPerFrame, sum);
+	printf("%-12s %14s %14s %14s %14s\n", "thread", "warm-up new", "warm-up bytes", "steady new", "steady bytes");
+
+	bool allocates = false;
+	for (int t = 0; t < 3; t++) {
+		const t_soakThread& run = runs[t];
+		uint32_t allocations = run.end.allocations - run.warm.allocations;
+		uint32_t bytes = run.end.bytes - run.warm.bytes;
+		printf("%-12s %14u %14u %14u %14u\n", run.name, run.warm.allocations, run.warm.bytes, allocations, bytes);
+		allocates = allocates || allocations > 0;
+	}
+	printf("\narena spills after the warm-up: %u\n", spills);
+	printf("loader: %d restarts, %u new counted, %d counter slots before, %d after\n",
+		SOAK_RESTARTS, loaderAllocations, slotsBefore, slotsAfter);
+
+	if (allocates || spills > 0) {
+		printf("\na thread allocates after the warm-up\n");
+		return 1;
+	}
+	if (slotsAfter != slotsBefore || loaderAllocations < SOAK_RESTARTS) {
+		printf("\nthe loader does not keep its counter slot\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,290 @@
+// Accuracy and cost benchmark of the analysis chain.
+//
+// Runs every signal of the voice corpus through pitchAnalyzer hop by hop,
+// as audioIn would get it, and compares the output to the known pitch:
+//   GPE      gross pitch error, voiced frames more than 20% off
+//   octave   part of those that are an octave off
+//   voicing  voiced frames without pitch + unvoiced frames with a pitch
+//   cents    mean error of the frames without gross error
+//   lag      time for pitch / control to cover half of a pitch step
+//   cpu      analysis time per second of audio
+//
+// usage: tripnoBench [config.xml] [-d decimation] [-t double|float|int16] [-p hops] [-trace file]
+//
+// -p tracks the pitch every that many hops only, as the quality governor
+// does under load (see qualityGovernor.h).
+// -trace writes the analysis zones as Chrome Trace Event JSON, in builds
+// with TRIPNO_TRACE (make TRACE=1).
+
+#include "pitchAnalyzer.h"
+#include "voiceCorpus.h"
+#include "traceZones.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+
+struct t_benchScore {
+	int frames;
+	int voicedFrames;		// voiced in truth and analysis
+	int grossErrors;
+	int octaveErrors;
+	int missed;
+	int falseAlarms;
+	double centsSum;
+	std::vector<double> pitchLags;		// s
+	std::vector<double> controlLags;	// s
+	double cpuSeconds;
+	double audioSeconds;
+
+	t_benchScore() : frames(0), voicedFrames(0), grossErrors(0), octaveErrors(0),
+		missed(0), falseAlarms(0), centsSum(0), cpuSeconds(0), audioSeconds(0) {}
+
+	void add(const t_benchScore& other) {
+		frames += other.frames;
+		voicedFrames += other.voicedFrames;
+		grossErrors += other.grossErrors;
+		octaveErrors += other.octaveErrors;
+		missed += other.missed;
+		falseAlarms += other.falseAlarms;
+		centsSum += other.centsSum;
+		pitchLags.insert(pitchLags.end(), other.pitchLags.begin(), other.pitchLags.end());
+		controlLags.insert(controlLags.end(), other.controlLags.begin(), other.controlLags.end());
+		cpuSeconds += other.cpuSeconds;
+		audioSeconds += other.audioSeconds;
+	}
+};
+
+//--------------------------------------------------------------
+static double median(std::vector<double> values) {
+	if (values.empty()) {
+		return NAN;
+	}
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+//--------------------------------------------------------------
+// Time from a step at hop `from` until series crosses half way to the
+// value it settles at `settle`.
+static double stepLag(const std::vector<double>& series, int from, int settle, double stepTime,
+	double hopTime) {
+
+	double before = series[std::max(0, from - 1)];
+	double after = series[settle];
+	double half = (before + after) / 2;
+
+	for (int k = from; k <= settle; k++) {
+		if ((after > before && series[k] >= half) || (after < before && series[k] <= half)) {
+			return (k + 1) * hopTime - stepTime;
+		}
+	}
+	return NAN;
+}
+
+//--------------------------------------------------------------
+template<typename T>
+static t_benchScore runSignal(const t_voiceSignal& signal, const t_config& config, int pitchInterval) {
+	TRACE_ZONE("signal");
+	t_benchScore score;
+
+	pitchAnalyzer<T> analyzer;
+	analyzer.setup(config);
+	analyzer.setPitchInterval(pitchInterval);
+
+	const int hops = signal.samples.size() / AUDIO_HOP_SIZE;
+	const double hopTime = AUDIO_HOP_SIZE / signal.sampleRate;
+	std::vector<float> input(AUDIO_HOP_SIZE * 2);
+	std::vector<double> pitchLog(hops), control(hops);
+
+	for (int k = 0; k < hops; k++) {
+		// stereo, as the sound stream delivers it
+		for (int i = 0; i < AUDIO_HOP_SIZE; i++) {
+			input[i * 2] = input[i * 2 + 1] = signal.samples[k * AUDIO_HOP_SIZE + i];
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		t_analysis analysis = analyzer.process(&input[0], AUDIO_HOP_SIZE, 2);
+		score.cpuSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		pitchLog[k] = analysis.freqLog;
+		control[k] = analysis.control;
+
+		// the pitch window ends with this hop, judge it against its middle
+		const int pitchWindow = (int)(analyzer.getPitchWindowSize() * SAMPLE_RATE / analyzer.getAnalysisRate());
+		int center = (k + 1) * AUDIO_HOP_SIZE - pitchWindow / 2;
+		if (center < 0) {
+			continue;
+		}
+		double truth = signal.truth[center];
+
+		score.frames++;
+		if (truth > 0 && analysis.freq <= 0) {
+			score.missed++;
+		}
+		else if (truth <= 0 && analysis.freq > 0) {
+			score.falseAlarms++;
+		}
+		else if (truth > 0) {
+			score.voicedFrames++;
+
+			double ratio = analysis.freq / truth;
+			if (fabs(ratio - 1) > 0.2) {
+				score.grossErrors++;
+				if (fabs(ratio - 2) < 0.4 || fabs(ratio - 0.5) < 0.1) {
+					score.octaveErrors++;
+				}
+			}
+			else {
+				score.centsSum += fabs(1200 * log(ratio) / log(2.0));
+			}
+		}
+	}
+	score.audioSeconds = hops * hopTime;
+
+	// pitch steps : a voiced sample more than 25% off the previous voiced
+	// one, with less than 50 ms between them
+	double lastVoiced = 0;
+	size_t lastVoicedAt = 0;
+	for (size_t i = 0; i < signal.truth.size(); i++) {
+		double f0 = signal.truth[i];
+		if (f0 <= 0) {
+			continue;
+		}
+
+		if (lastVoiced > 0 && i - lastVoicedAt < 0.05 * signal.sampleRate
+			&& fabs(log(f0 / lastVoiced)) > log(1.25)) {
+
+			double stepTime = i / signal.sampleRate;
+			int from = i / AUDIO_HOP_SIZE;
+			int settle = std::min(hops - 1, (int)((stepTime + 0.3) / hopTime));
+			if (settle > from) {
+				double pitchLag = stepLag(pitchLog, from, settle, stepTime, hopTime);
+				double controlLag = stepLag(control, from, settle, stepTime, hopTime);
+				if (pitchLag == pitchLag) score.pitchLags.push_back(pitchLag);
+				if (controlLag == controlLag) score.controlLags.push_back(controlLag);
+			}
+		}
+		lastVoiced = f0;
+		lastVoicedAt = i;
+	}
+
+	return score;
+}
+
+//--------------------------------------------------------------
+// the median lag in ms, - for signals without pitch steps
+static std::string lagColumn(const std::vector<double>& lags) {
+	if (lags.empty()) {
+		return "-";
+	}
+	char text[32];
+	snprintf(text, sizeof(text), "%.1f", median(lags) * 1000);
+	return text;
+}
+
+//--------------------------------------------------------------
+static void printScore(const std::string& name, const t_benchScore& score) {
+	printf("%-16s %6d %7.2f%% %7.2f%% %8.2f%% %7.1f %8s %8s %9.2f\n",
+		name.c_str(),
+		score.frames,
+		score.voicedFrames ? 100.0 * score.grossErrors / score.voicedFrames : 0.0,
+		score.voicedFrames ? 100.0 * score.octaveErrors / score.voicedFrames : 0.0,
+		score.frames ? 100.0 * (score.missed + score.falseAlarms) / score.frames : 0.0,
+		score.voicedFrames > score.grossErrors ? score.centsSum / (score.voicedFrames - score.grossErrors) : 0.0,
+		lagColumn(score.pitchLags).c_str(),
+		lagColumn(score.controlLags).c_str(),
+		score.audioSeconds > 0 ? score.cpuSeconds / score.audioSeconds * 1000 : 0.0);
+}
+
+//--------------------------------------------------------------
+int main(int argc, char** argv) {
+	t_config config = defaultConfig();
+
+	std::string configPath = "data/config.xml";
+	int decimation = 0;
+	std::string sampleType = "double";
+	int pitchInterval = 1;
+	std::string tracePath;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+			decimation = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+			sampleType = argv[++i];
+		}
+		else if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+			pitchInterval = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-trace") && i + 1 < argc) {
+			tracePath = argv[++i];
+		}
+		else {
+			configPath = argv[i];
+		}
+	}
+
+	if (!readConfigFile(configPath, config)) {
+		fprintf(stderr, "%s not found, using defaults\n", configPath.c_str());
+	}
+	if (decimation > 0) {
+		config.decimation = decimation;
+	}
+
+	t_benchScore (*run)(const t_voiceSignal&, const t_config&, int);
+	if (sampleType == "double") {
+		run = runSignal<double>;
+	}
+	else if (sampleType == "float") {
+		run = runSignal<float>;
+	}
+	else if (sampleType == "int16") {
+		run = runSignal<int16_t>;
+	}
+	else {
+		fprintf(stderr, "unknown sample type %s\n", sampleType.c_str());
+		return 1;
+	}
+
+	// the pitch window bounds dywapitch takes, at 44100 Hz
+	pitchAnalyzer<double> probe;
+	probe.setup(config);
+	const double toFull = SAMPLE_RATE / probe.getAnalysisRate();
+
+	printf("window %d, pitch window %d - %d, hop %d, decimation %d, gateThreshold %g, %s samples",
+		AUDIO_BUFFER_SIZE, (int)(probe.getPitchWindowMin() * toFull), (int)(probe.getPitchWindowMax() * toFull),
+		AUDIO_HOP_SIZE, config.decimation, config.gateThreshold, sampleType.c_str());
+	if (pitchInterval > 1) {
+		printf(", pitch every %d hops", pitchInterval);
+	}
+	printf("\n\n");
+	printf("%-16s %6s %8s %8s %9s %7s %8s %8s %9s\n",
+		"signal", "frames", "GPE", "octave", "voicing", "cents", "lag ms", "ctl ms", "cpu ms/s");
+
+	std::vector<t_voiceSignal> corpus = voiceCorpus(SAMPLE_RATE);
+	t_benchScore total;
+	for (size_t i = 0; i < corpus.size(); i++) {
+		t_benchScore score = run(corpus[i], config, pitchInterval);
+		printScore(corpus[i].name, score);
+		total.add(score);
+	}
+
+	printf("\n");
+	printScore("total", total);
+
+	if (!tracePath.empty()) {
+		TRACE_THREAD_NAME("bench");
+		if (TRACE_WRITE(tracePath)) {
+			printf("trace written to %s\n", tracePath.c_str());
+		}
+		else {
+			fprintf(stderr, "cannot write %s, tracing needs make TRACE=1\n", tracePath.c_str());
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,97 @@
+#include "captureFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+
+#define CAPTURE_RAW_RATE 44100
+#define CAPTURE_RAW_CHANNELS 2
+
+//--------------------------------------------------------------
+static uint32_t getLE(const unsigned char* in, int bytes) {
+	uint32_t value = 0;
+	for (int i = 0; i < bytes; i++) {
+		value |= (uint32_t)in[i] << (8 * i);
+	}
+	return value;
+}
+
+//--------------------------------------------------------------
+static std::string baseName(const std::string& path) {
+	size_t slash = path.find_last_of("/\\");
+	std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+	size_t dot = name.find_last_of('.');
+	return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+//--------------------------------------------------------------
+// float samples from the current position to the end, or count bytes.
+// A capture cut short keeps what was written.
+static void readSamples(FILE* file, long count, std::vector<float>& samples) {
+	if (count < 0) {
+		long start = ftell(file);
+		fseek(file, 0, SEEK_END);
+		count = ftell(file) - start;
+		fseek(file, start, SEEK_SET);
+	}
+
+	samples.resize(count / sizeof(float));
+	samples.resize(samples.empty() ? 0 : fread(&samples[0], sizeof(float), samples.size(), file));
+}
+
+//--------------------------------------------------------------
+bool readCaptureFile(const std::string& path, t_captureFile& capture) {
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file) {
+		return false;
+	}
+
+	capture.name = baseName(path);
+	capture.sampleRate = CAPTURE_RAW_RATE;
+	capture.channels = CAPTURE_RAW_CHANNELS;
+
+	unsigned char header[12];
+	bool isWav = fread(header, 1, sizeof(header), file) == sizeof(header)
+		&& !memcmp(header, "RIFF", 4) && !memcmp(header + 8, "WAVE", 4);
+	if (!isWav) {
+		fseek(file, 0, SEEK_SET);
+		readSamples(file, -1, capture.samples);
+		fclose(file);
+		return true;
+	}
+
+	// chunks up to the data, the fmt one must say 32 bit float
+	bool isFloat = false;
+	unsigned char chunk[8];
+	while (fread(chunk, 1, sizeof(chunk), file) == sizeof(chunk)) {
+		uint32_t size = getLE(chunk + 4, 4);
+
+		if (!memcmp(chunk, "fmt ", 4) && size >= 16) {
+			unsigned char format[16];
+			if (fread(format, 1, sizeof(format), file) != sizeof(format)) {
+				break;
+			}
+			// WAVE_FORMAT_IEEE_FLOAT, or WAVE_FORMAT_EXTENSIBLE holding it
+			uint32_t tag = getLE(format, 2);
+			capture.channels = getLE(format + 2, 2);
+			capture.sampleRate = getLE(format + 4, 4);
+			isFloat = (tag == 3 || tag == 0xfffe) && getLE(format + 14, 2) == 32;
+			fseek(file, size - sizeof(format) + (size & 1), SEEK_CUR);
+		}
+		else if (!memcmp(chunk, "data", 4)) {
+			// a saturated size (past 4 GB), or none yet while the game
+			// was still recording, runs to the end of the file
+			if (isFloat && capture.channels > 0) {
+				readSamples(file, size == 0 || size >= 0xffffffff - 36 ? -1 : (long)size, capture.samples);
+			}
+			fclose(file);
+			return isFloat && capture.channels > 0;
+		}
+		else {
+			fseek(file, size + (size & 1), SEEK_CUR);
+		}
+	}
+
+	fclose(file);
+	return false;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Audio recorded by the game (see audioCapture.h), read back for the
+// headless tools: a 32 bit float WAV, or a headerless float32 .raw file,
+// which the game always writes as stereo at 44100 Hz.
+struct t_captureFile {
+	std::string name;
+	double sampleRate;
+	int channels;
+	std::vector<float> samples;	// interleaved
+};
+
+// false when the file cannot be read or is not 32 bit float
+bool readCaptureFile(const std::string& path, t_captureFile& capture);
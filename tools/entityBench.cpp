@@ -0,0 +1,138 @@
+// Cost of the entity store at game scale.
+//
+// A level of entities (obstacles and pickups, half of them moving) is
+// stepped at 60 Hz, with SIMULATION_STEPS updates per frame as the
+// simulation thread does, and every step collides a few players against it.
+// The hits are checked against a brute force test of every entity, the
+// time per frame is compared with the 16.7 ms of a 60 Hz frame.
+//
+// usage: tripnoEntityBench [-n entities] [-p players] [-f frames]
+
+#include "entityStore.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#define LEVEL_LENGTH 2000.0f // segments
+#define LEVEL_HEIGHT 11.25f // segments, the field of a 16:9 view
+#define SIMULATION_STEPS 4 // per 60 Hz frame, at 240 Hz
+#define PLAYER_RADIUS 0.6f
+#define MAX_HITS 64
+
+static float randomIn(float from, float to) {
+	return from + (to - from) * (rand() / (float)RAND_MAX);
+}
+
+//--------------------------------------------------------------
+static int bruteForce(const entityStore& store, float cx, float cy, float radius, std::vector<int>& hits) {
+	hits.clear();
+	for (int i = 0; i < store.size(); i++) {
+		float dx = cx - std::min(std::max(cx, store.getX(i)), store.getX(i) + store.getWidth(i));
+		float dy = cy - std::min(std::max(cy, store.getY(i)), store.getY(i) + store.getHeight(i));
+		if (dx * dx + dy * dy <= radius * radius && !store.isRemoved(i)) {
+			hits.push_back(i);
+		}
+	}
+	return (int)hits.size();
+}
+
+//--------------------------------------------------------------
+int main(int argc, char** argv) {
+	int entities = 10000;
+	int players = 4;
+	int frames = 600;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "-n")) {
+			entities = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-p")) {
+			players = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-f")) {
+			frames = atoi(argv[i + 1]);
+		}
+	}
+
+	srand(1);
+	entityStore store;
+	store.reserve(entities);
+	for (int i = 0; i < entities; i++) {
+		bool pickup = i % 4 == 0;
+		float size = pickup ? 0.4f : randomIn(0.3f, 2.0f);
+		bool moving = i % 2 == 0;
+		store.add(pickup ? ENTITY_PICKUP : ENTITY_OBSTACLE,
+			randomIn(0, LEVEL_LENGTH), randomIn(-LEVEL_HEIGHT / 2, LEVEL_HEIGHT / 2 - size), size, size,
+			moving ? randomIn(-1, 1) : 0, moving ? randomIn(-0.5f, 0.5f) : 0);
+	}
+	store.update(0, -1e9f);
+
+	const float dt = 1.0f / (60 * SIMULATION_STEPS);
+	const float speed = LEVEL_LENGTH / 2 / (frames * SIMULATION_STEPS * dt); // half the level
+	std::vector<int> hits(MAX_HITS), expected;
+	long long totalHits = 0;
+	int mismatches = 0;
+	double worst = 0;
+	double updateSeconds = 0, collideSeconds = 0;
+	float scroll = 0;
+
+	for (int frame = 0; frame < frames; frame++) {
+		std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+		double frameUpdate = 0;
+
+		for (int step = 0; step < SIMULATION_STEPS; step++) {
+			scroll += speed * dt;
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			// keep what is behind the view, the brute force check sees the whole level
+			store.update(dt, -1e9f);
+			frameUpdate += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			for (int p = 0; p < players; p++) {
+				float cx = scroll + 6 + p;
+				float cy = (LEVEL_HEIGHT / 2 - 1) * sinf(scroll * 0.7f + p);
+				int count = store.collide(cx, cy, PLAYER_RADIUS, &hits[0], MAX_HITS);
+				totalHits += count;
+
+				// pickups are taken
+				for (int h = 0; h < count; h++) {
+					if (store.getKind(hits[h]) == ENTITY_PICKUP) {
+						store.remove(hits[h]);
+					}
+				}
+			}
+		}
+
+		double frameSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count();
+		updateSeconds += frameUpdate;
+		collideSeconds += frameSeconds - frameUpdate;
+		worst = std::max(worst, frameSeconds);
+
+		// outside the timing : the same queries by brute force
+		for (int p = 0; p < players && frame % 10 == 0; p++) {
+			float cx = scroll + 6 + p;
+			float cy = (LEVEL_HEIGHT / 2 - 1) * sinf(scroll * 0.7f + p) + 0.5f;
+			int count = store.collide(cx, cy, PLAYER_RADIUS, &hits[0], MAX_HITS);
+			bruteForce(store, cx, cy, PLAYER_RADIUS, expected);
+			std::sort(hits.begin(), hits.begin() + count);
+			if (count != (int)expected.size() || !std::equal(expected.begin(), expected.end(), hits.begin())) {
+				mismatches++;
+			}
+		}
+	}
+
+	double frameBudget = 1.0 / 60;
+	double average = (updateSeconds + collideSeconds) / frames;
+	printf("%d entities, %d players, %d frames of %d steps, %d left\n",
+		entities, players, frames, SIMULATION_STEPS, store.size());
+	printf("update  %8.1f us/frame\n", updateSeconds / frames * 1e6);
+	printf("collide %8.1f us/frame, %lld hits\n", collideSeconds / frames * 1e6, totalHits);
+	printf("total   %8.1f us/frame (%.2f%% of a 60 Hz frame), worst %.1f us\n",
+		average * 1e6, average / frameBudget * 100, worst * 1e6);
+	printf("%d brute force mismatches\n", mismatches);
+	return mismatches ? 1 : 0;
+}
@@ -0,0 +1,136 @@
+// Checks realFft against a direct DFT, and times it.
+//
+// For every size and window, a random signal is transformed out of place
+// and in place, and the amplitudes of all bins and of a bin range are
+// compared to a DFT in double. A range must leave the other bins alone.
+// Then the analysis window sizes are timed, all bins and the voice band.
+//
+// usage: tripnoFftCheck [-n transforms]
+//
+// Exits with 1 on an error above 1e-4 of the largest amplitude.
+
+#include "realFft.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#define CHECK_TOLERANCE 1e-4
+#define CHECK_UNTOUCHED -1.0f
+
+//--------------------------------------------------------------
+static std::vector<double> directAmplitudes(const std::vector<float>& signal, fftWindow window) {
+	const int size = signal.size();
+	std::vector<double> amplitudes(size / 2 + 1);
+	for (int k = 0; k <= size / 2; k++) {
+		double re = 0, im = 0;
+		for (int n = 0; n < size; n++) {
+			double w = window == FFT_WINDOW_HANN ? 0.5 - 0.5 * cos(2 * M_PI * n / size) : 1.0;
+			re += signal[n] * w * cos(2 * M_PI * k * n / size);
+			im -= signal[n] * w * sin(2 * M_PI * k * n / size);
+		}
+		amplitudes[k] = sqrt(re * re + im * im);
+	}
+	return amplitudes;
+}
+
+//--------------------------------------------------------------
+// largest error over the bins [from, to), relative to the largest amplitude.
+// A bin outside the range that was written counts as an error of 1.
+static double compare(const std::vector<float>& amplitudes, const std::vector<double>& expected, int from, int to) {
+	double scale = *std::max_element(expected.begin(), expected.end());
+	double error = 0;
+	for (int k = 0; k < (int)expected.size(); k++) {
+		if (k < from || k >= to) {
+			error = std::max(error, amplitudes[k] == CHECK_UNTOUCHED ? 0.0 : 1.0);
+		}
+		else {
+			error = std::max(error, fabs(amplitudes[k] - expected[k]) / scale);
+		}
+	}
+	return error;
+}
+
+//--------------------------------------------------------------
+static bool check(int size, fftWindow window) {
+	std::vector<float> signal(size);
+	for (int n = 0; n < size; n++) {
+		signal[n] = 2.0f * rand() / RAND_MAX - 1.0f;
+	}
+	std::vector<double> expected = directAmplitudes(signal, window);
+
+	realFft fft;
+	fft.setup(size, window);
+	const int bins = fft.getBinSize();
+	std::vector<float> transformed(size), amplitudes(bins);
+
+	// out of place, every bin
+	std::fill(amplitudes.begin(), amplitudes.end(), CHECK_UNTOUCHED);
+	fft.transform(&signal[0], &transformed[0]);
+	fft.amplitude(&transformed[0], &amplitudes[0], 0, bins);
+	double fullError = compare(amplitudes, expected, 0, bins);
+
+	// in place, an odd range off the SIMD blocks
+	int from = std::min(3, bins - 1), to = std::max(from, bins - 2);
+	std::fill(amplitudes.begin(), amplitudes.end(), CHECK_UNTOUCHED);
+	transformed = signal;
+	fft.transform(&transformed[0], &transformed[0]);
+	fft.amplitude(&transformed[0], &amplitudes[0], from, to);
+	double rangeError = compare(amplitudes, expected, from, to);
+
+	bool ok = fullError < CHECK_TOLERANCE && rangeError < CHECK_TOLERANCE;
+	printf("%6d %-12s %12.2e %12.2e %s\n", size, window == FFT_WINDOW_HANN ? "hann" : "rectangular",
+		fullError, rangeError, ok ? "" : "FAILED");
+	return ok;
+}
+
+//--------------------------------------------------------------
+static void timeTransform(int size, int from, int to, int count) {
+	realFft fft;
+	fft.setup(size, FFT_WINDOW_RECTANGULAR);
+	std::vector<float> signal(size), transformed(size), amplitudes(fft.getBinSize());
+	for (int n = 0; n < size; n++) {
+		signal[n] = 2.0f * rand() / RAND_MAX - 1.0f;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < count; i++) {
+		fft.transform(&signal[0], &transformed[0]);
+		fft.amplitude(&transformed[0], &amplitudes[0], from, to);
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("%6d   bins %4d-%-4d %8.2f us\n", size, from, to, seconds / count * 1000000);
+}
+
+//--------------------------------------------------------------
+int main(int argc, char** argv) {
+	int count = 20000;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+			count = atoi(argv[++i]);
+		}
+	}
+
+	srand(1);
+	printf("%6s %-12s %12s %12s\n", "size", "window", "all bins", "bin range");
+	bool ok = true;
+	for (int size = 16; size <= 4096; size *= 2) {
+		ok = check(size, FFT_WINDOW_RECTANGULAR) && ok;
+		ok = check(size, FFT_WINDOW_HANN) && ok;
+	}
+
+	// the analysis window at full rate and decimated by 4, the voice band
+	// at 44.1 kHz is bins 3 to 279 of 4096
+	printf("\n");
+	timeTransform(4096, 0, 2049, count);
+	timeTransform(4096, 3, 279, count);
+	timeTransform(1024, 0, 513, count);
+	timeTransform(1024, 3, 279, count);
+
+	return ok ? 0 : 1;
+}
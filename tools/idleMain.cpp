@@ -0,0 +1,158 @@
+// Cost of the audio analysis awake and idle, and how fast a voice wakes it.
+//
+// Feeds quiet noise through the audioIn chain twice, hop by hop: once with
+// idling off, once with a short idle timeout, and compares the process cpu
+// time per second of audio spent on the quiet part. Then a voice starts and
+// the hops until the first full analysis and the first pitch are counted.
+// Frames and simulation steps are not run here, their rates are printed
+// from the constants.
+//
+// usage: tripnoIdle [config.xml] [-s seconds of quiet] [-n noise peak] [-d decimation]
+//
+// Exits with 1 when the voice takes more than one hop to wake the analysis.
+
+#include "pitchAnalyzer.h"
+#include "idleMonitor.h"
+#include "tripnoPhysics.h"
+#include "voiceCorpus.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <string>
+
+#define IDLE_TEST_TIMEOUT 2.0 // s, the idle run falls idle after that much quiet
+
+struct t_idleRun {
+	double cpuSeconds;		// on the quiet hops after the timeout
+	int quietHops;
+	int wakeHops;			// from the voice onset to its first full analysis, -1 never
+	int pitchHops;			// to its first pitch, -1 never
+};
+
+//--------------------------------------------------------------
+// audioIn without the consumers : gate, level check, pitch, range, smoother
+static t_idleRun runIdle(const std::vector<float>& signal, int onsetHop, const t_config& config, double timeout) {
+	pitchAnalyzer<TRIPNO_SAMPLE_TYPE> analyzer;
+	analyzer.setup(config);
+
+	idleMonitor idle;
+	idle.setup((double)AUDIO_HOP_SIZE / SAMPLE_RATE, timeout, config.idleWakePeak);
+
+	t_idleRun run = t_idleRun();
+	run.wakeHops = run.pitchHops = -1;
+
+	const int timeoutHops = (int)(IDLE_TEST_TIMEOUT * SAMPLE_RATE / AUDIO_HOP_SIZE) + 1;
+	const int hops = signal.size() / AUDIO_HOP_SIZE;
+	std::vector<float> input(AUDIO_HOP_SIZE * 2);
+
+	// process cpu time over the whole quiet part, a hop is below the clock resolution
+	std::clock_t quietStart = 0;
+	for (int k = 0; k < hops; k++) {
+		if (k == timeoutHops) {
+			quietStart = std::clock();
+		}
+		if (k == onsetHop && k > timeoutHops) {
+			run.cpuSeconds = (double)(std::clock() - quietStart) / CLOCKS_PER_SEC;
+			run.quietHops = k - timeoutHops;
+		}
+
+		for (int i = 0; i < AUDIO_HOP_SIZE; i++) {
+			input[i * 2] = input[i * 2 + 1] = signal[k * AUDIO_HOP_SIZE + i];
+		}
+
+		t_analysis analysis = t_analysis();
+		analyzer.gate(&input[0], AUDIO_HOP_SIZE, 2, analysis);
+		const bool awake = idle.listen(analysis.peak);
+		if (awake) {
+			analyzer.pitch(analysis);
+			analyzer.mapRange(analysis);
+			analyzer.smooth(analysis);
+			idle.update(analysis.freq > 0);
+		}
+		else {
+			analyzer.skipPitch(analysis);
+		}
+
+		if (k >= onsetHop && awake && run.wakeHops < 0) {
+			run.wakeHops = k - onsetHop;
+		}
+		if (k >= onsetHop && analysis.freq > 0 && run.pitchHops < 0) {
+			run.pitchHops = k - onsetHop;
+		}
+	}
+	return run;
+}
+
+//--------------------------------------------------------------
+int main(int argc, char** argv) {
+	t_config config = defaultConfig();
+	config.idleWakePeak = 0.05;
+
+	std::string configPath = "data/config.xml";
+	double quietSeconds = 60;
+	double noisePeak = 0.005;
+	int decimation = 0;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+			quietSeconds = atof(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+			noisePeak = atof(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+			decimation = atoi(argv[++i]);
+		}
+		else {
+			configPath = argv[i];
+		}
+	}
+
+	if (!readConfigFile(configPath, config)) {
+		fprintf(stderr, "%s not found, using defaults\n", configPath.c_str());
+	}
+	if (decimation > 0) {
+		config.decimation = decimation;
+	}
+
+	// quiet room, then a voice on a hop boundary
+	srand(1);
+	int onsetHop = (int)(quietSeconds * SAMPLE_RATE / AUDIO_HOP_SIZE);
+	std::vector<float> signal(onsetHop * AUDIO_HOP_SIZE);
+	for (size_t i = 0; i < signal.size(); i++) {
+		signal[i] = noisePeak * (2.0f * rand() / RAND_MAX - 1.0f);
+	}
+
+	std::vector<t_voiceSegment> segments(1);
+	segments[0].duration = 1.0;
+	segments[0].f0Start = segments[0].f0End = 180;
+	segments[0].vibratoDepth = 0;
+	segments[0].vibratoRate = 0;
+	segments[0].breath = 0.02;
+	segments[0].level = 0.5;
+	segments[0].vowel = VOWEL_A;
+	t_voiceSignal voice = synthesizeVoice("voice", segments, SAMPLE_RATE, 1);
+	signal.insert(signal.end(), voice.samples.begin(), voice.samples.end());
+
+	t_idleRun awake = runIdle(signal, onsetHop, config, 0);
+	t_idleRun idle = runIdle(signal, onsetHop, config, IDLE_TEST_TIMEOUT);
+
+	const double hopSeconds = (double)AUDIO_HOP_SIZE / SAMPLE_RATE;
+	printf("%.0f s of noise at peak %g, then a voice, decimation %d, wake peak %g\n\n",
+		quietSeconds, noisePeak, config.decimation, config.idleWakePeak);
+	printf("%-8s %12s %10s %10s %8s %8s\n", "", "cpu ms/s", "wake hops", "pitch hops", "frames/s", "sim/s");
+	printf("%-8s %12.3f %10d %10d %8d %8d\n", "awake",
+		awake.quietHops ? awake.cpuSeconds / (awake.quietHops * hopSeconds) * 1000 : 0.0,
+		awake.wakeHops, awake.pitchHops, 60, SIMULATION_RATE);
+	printf("%-8s %12.3f %10d %10d %8d %8d\n", "idle",
+		idle.quietHops ? idle.cpuSeconds / (idle.quietHops * hopSeconds) * 1000 : 0.0,
+		idle.wakeHops, idle.pitchHops, IDLE_FRAME_RATE, 1000 / IDLE_POLL_MILLIS);
+
+	if (idle.wakeHops < 0 || idle.wakeHops > 1) {
+		printf("\nthe voice did not wake the analysis within one hop\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,426 @@
+// Voice to photon latency of the game, headless.
+//
+// Every trial sings a synthetic vowel that steps in pitch, and feeds it hop
+// by hop through the analysis chain as the sound stream would. The control
+// then drives tripno's physics at SIMULATION_RATE, and frames are drawn at
+// 60 Hz showing the scene one step behind, as getScene() does. A reference
+// run without the step gives the motion tripno would have had anyway.
+// Each stage is timed from the pitch step:
+//   capture     the audio block holding the step reaches audioIn
+//   analysis    pitch crosses half way to the new pitch
+//   control     control crosses half way to its new value
+//   simulation  tripno is more than a pixel off the reference
+//   draw        a drawn frame shows it
+//   photon      that frame is on screen, one refresh after the draw
+// The analysis runs for real and its measured cpu time is added. The audio
+// blocks, simulation steps and frames run on a virtual clock, with random
+// phases between them, so the result does not depend on the machine load.
+//
+// -e blend mixes the loudness control in (see envelopeFollower.h): audioIn
+// gets ENVELOPE_AUDIO_BLOCK frames, and every trial is a voice starting
+// from silence instead of a pitch step. The analysis stage is then the
+// envelope crossing half way.
+//
+// usage: tripnoLatency [config.xml] [-n trials] [-d decimation] [-seed n]
+//                      [-e blend] [-csv file] [-max ms]
+//
+// -max fails (exit 1) when the median voice to photon latency is above ms.
+
+#include "pitchAnalyzer.h"
+#include "envelopeFollower.h"
+#include "tripnoPhysics.h"
+#include "voiceCorpus.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+
+#define FRAME_RATE 60
+#define PRE_ROLL 1.0 // s of the first pitch, for the range tracking to settle
+#define POST_ROLL 0.6 // s after the step
+#define SIMULATION_POLL 0.001 // s, the simulation thread sleeps that long between checks
+#define MOTION_THRESHOLD 1.0 // pixels
+
+enum latencyStage {
+	LATENCY_CAPTURE,
+	LATENCY_ANALYSIS,
+	LATENCY_CONTROL,
+	LATENCY_SIMULATION,
+	LATENCY_DRAW,
+	LATENCY_PHOTON,
+	LATENCY_STAGES
+};
+
+static const char* stageNames[LATENCY_STAGES] = {
+	"capture", "analysis", "control", "simulation", "draw", "photon"
+};
+
+// what audioIn produced for one block, at virtual time `done`
+struct t_hopOutput {
+	double done;
+	double freqLog;		// of the last hop
+	double envelope;
+	double control;
+};
+
+// cpu time of the whole run
+static double pitchSeconds = 0;
+static double envelopeSeconds = 0;
+static double audioSeconds = 0;
+
+static double randomIn(double from, double to) {
+	return from + (to - from) * (rand() / (double)RAND_MAX);
+}
+
+//--------------------------------------------------------------
+static t_voiceSignal singStep(double f0, double f1, double onset, unsigned seed) {
+	std::vector<t_voiceSegment> segments(2);
+	t_voiceSegment& before = segments[0];
+	before.duration = onset;
+	before.f0Start = before.f0End = f0;
+	before.vibratoDepth = 0;
+	before.vibratoRate = 0;
+	before.breath = 0.02;
+	before.level = 1;
+	before.vowel = VOWEL_A;
+
+	segments[1] = before;
+	segments[1].duration = POST_ROLL;
+	segments[1].f0Start = segments[1].f0End = f1;
+
+	return synthesizeVoice("step", segments, SAMPLE_RATE, seed);
+}
+
+//--------------------------------------------------------------
+static int blockSize(const envelopeFollower& envelope) {
+	return envelope.isEnabled() ? ENVELOPE_AUDIO_BLOCK : AUDIO_HOP_SIZE;
+}
+
+//--------------------------------------------------------------
+// audioIn over the whole signal: analysis as the default dspGraph runs it,
+// on hops gathered from the blocks while the envelope is mixed in
+static std::vector<t_hopOutput> runAudio(const t_voiceSignal& signal, const t_config& config) {
+	pitchAnalyzer<TRIPNO_SAMPLE_TYPE> analyzer;
+	analyzer.setup(config);
+	envelopeFollower envelope;
+	envelope.setup(config, SAMPLE_RATE);
+
+	const int block = blockSize(envelope);
+	const int blocks = signal.samples.size() / block;
+	std::vector<float> input(block * 2);
+	std::vector<float> hop(AUDIO_HOP_SIZE * 2);
+	int hopFrames = 0;
+	std::vector<t_hopOutput> outputs(blocks);
+	t_analysis analysis = t_analysis();
+
+	for (int k = 0; k < blocks; k++) {
+		for (int i = 0; i < block; i++) {
+			input[i * 2] = input[i * 2 + 1] = signal.samples[k * block + i];
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (envelope.isEnabled()) {
+			envelope.process(&input[0], block, 2);
+		}
+		std::chrono::steady_clock::time_point envelopeDone = std::chrono::steady_clock::now();
+
+		std::copy(input.begin(), input.end(), hop.begin() + hopFrames * 2);
+		hopFrames += block;
+		if (hopFrames == AUDIO_HOP_SIZE) {
+			analysis = analyzer.process(&hop[0], AUDIO_HOP_SIZE, 2);
+			hopFrames = 0;
+		}
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		envelopeSeconds += std::chrono::duration<double>(envelopeDone - start).count();
+		pitchSeconds += std::chrono::duration<double>(end - envelopeDone).count();
+		audioSeconds += (double)block / SAMPLE_RATE;
+
+		outputs[k].done = (double)(k + 1) * block / SAMPLE_RATE + std::chrono::duration<double>(end - start).count();
+		outputs[k].freqLog = analysis.freqLog;
+		outputs[k].envelope = envelope.getEnvelope();
+		outputs[k].control = envelope.isEnabled() ? envelope.mix(analysis.control) : analysis.control;
+	}
+	return outputs;
+}
+
+//--------------------------------------------------------------
+// tripno's height at every simulation step, steps at phase + n / rate.
+// A step takes the strongest control published since the previous one,
+// the simulation thread reads it up to one poll late.
+static std::vector<double> runSimulation(const std::vector<t_hopOutput>& outputs, const t_config& config,
+	double phase, const std::vector<double>& pollDelays) {
+
+	const double dt = 1.0 / SIMULATION_RATE;
+	const int steps = pollDelays.size();
+	std::vector<double> heights(steps);
+
+	t_tripnoMotion motion;
+	motion.y = motion.velocity = motion.elastic = motion.resistance = 0;
+	double signal = 0;
+	size_t next = 0;
+
+	for (int n = 0; n < steps; n++) {
+		double readAt = phase + n * dt + pollDelays[n];
+
+		bool pending = false;
+		double control = 0;
+		while (next < outputs.size() && outputs[next].done <= readAt) {
+			control = pending ? std::max(control, outputs[next].control) : outputs[next].control;
+			pending = true;
+			next++;
+		}
+		if (pending) {
+			signal = control * config.signalAmp;
+		}
+
+		integrateTripno(motion, signal, 1.0, config, dt);
+		heights[n] = motion.y;
+	}
+	return heights;
+}
+
+//--------------------------------------------------------------
+// height drawn at time `now`: one step behind, between the two last
+// published steps
+static double drawnHeight(const std::vector<double>& heights, double phase, const std::vector<double>& pollDelays,
+	double now) {
+
+	const double dt = 1.0 / SIMULATION_RATE;
+	int published = -1;
+	while (published + 1 < (int)heights.size() && phase + (published + 1) * dt + pollDelays[published + 1] <= now) {
+		published++;
+	}
+	if (published < 1) {
+		return 0;
+	}
+
+	double t0 = phase + (published - 1) * dt;
+	double alpha = std::min(1.0, std::max(0.0, (now - dt - t0) / dt));
+	return heights[published - 1] + (heights[published] - heights[published - 1]) * alpha;
+}
+
+//--------------------------------------------------------------
+static double outputValue(const t_hopOutput& output, int stage) {
+	return stage == LATENCY_CONTROL ? output.control : stage == LATENCY_ANALYSIS ? output.freqLog : output.envelope;
+}
+
+//--------------------------------------------------------------
+// first block at or after `from` where the value of stage (control,
+// analysis, or LATENCY_STAGES for the envelope) crossed half way to its
+// end value
+static int halfCross(const std::vector<t_hopOutput>& outputs, int from, int stage) {
+	int last = outputs.size() - 1;
+	double before = outputValue(outputs[std::max(0, from - 1)], stage);
+	double after = outputValue(outputs[last], stage);
+	double half = (before + after) / 2;
+
+	for (int k = from; k <= last; k++) {
+		double value = outputValue(outputs[k], stage);
+		if ((after > before && value >= half) || (after < before && value <= half)) {
+			return k;
+		}
+	}
+	return -1;
+}
+
+//--------------------------------------------------------------
+// latencies of one trial, NAN for a stage that was not reached. With
+// onset, the voice starts from silence instead of stepping in pitch.
+static void runTrial(const t_config& config, bool onset, unsigned seed, double* latency) {
+	for (int s = 0; s < LATENCY_STAGES; s++) {
+		latency[s] = NAN;
+	}
+
+	double f0 = randomIn(110, 260);
+	double f1 = f0 * (seed % 2 ? 1.5 : 1 / 1.5);
+	double stepAt = PRE_ROLL + randomIn(0, (double)AUDIO_HOP_SIZE / SAMPLE_RATE);
+	if (onset) {
+		f1 = f0;
+		f0 = 0;
+	}
+
+	t_voiceSignal stepped = singStep(f0, f1, stepAt, seed);
+	t_voiceSignal reference = singStep(f0, f0, stepAt, seed);
+
+	size_t stepSample = 0;
+	while (stepSample < stepped.truth.size() && stepped.truth[stepSample] != (float)f1) {
+		stepSample++;
+	}
+	double stepTime = (double)stepSample / SAMPLE_RATE;
+
+	envelopeFollower envelope;
+	envelope.setup(config, SAMPLE_RATE);
+	const int block = blockSize(envelope);
+	int stepBlock = stepSample / block;
+
+	std::vector<t_hopOutput> outputs = runAudio(stepped, config);
+	std::vector<t_hopOutput> referenceOutputs = runAudio(reference, config);
+	if (stepBlock >= (int)outputs.size()) {
+		return;
+	}
+
+	latency[LATENCY_CAPTURE] = (stepBlock + 1.0) * block / SAMPLE_RATE - stepTime;
+
+	int analysisBlock = halfCross(outputs, stepBlock, envelope.isEnabled() ? LATENCY_STAGES : LATENCY_ANALYSIS);
+	int controlBlock = halfCross(outputs, stepBlock, LATENCY_CONTROL);
+	if (analysisBlock >= 0) {
+		latency[LATENCY_ANALYSIS] = outputs[analysisBlock].done - stepTime;
+	}
+	if (controlBlock >= 0) {
+		latency[LATENCY_CONTROL] = outputs[controlBlock].done - stepTime;
+	}
+
+	// the same thread timing for both runs
+	const double duration = (double)outputs.size() * block / SAMPLE_RATE;
+	const double simPhase = randomIn(0, 1.0 / SIMULATION_RATE);
+	std::vector<double> pollDelays((int)(duration * SIMULATION_RATE));
+	for (size_t n = 0; n < pollDelays.size(); n++) {
+		pollDelays[n] = randomIn(0, SIMULATION_POLL);
+	}
+
+	std::vector<double> heights = runSimulation(outputs, config, simPhase, pollDelays);
+	std::vector<double> referenceHeights = runSimulation(referenceOutputs, config, simPhase, pollDelays);
+
+	for (size_t n = 0; n < heights.size(); n++) {
+		double at = simPhase + n / (double)SIMULATION_RATE + pollDelays[n];
+		if (at >= stepTime && fabs(heights[n] - referenceHeights[n]) > MOTION_THRESHOLD) {
+			latency[LATENCY_SIMULATION] = at - stepTime;
+			break;
+		}
+	}
+
+	const double framePhase = randomIn(0, 1.0 / FRAME_RATE);
+	for (double now = framePhase; now < duration; now += 1.0 / FRAME_RATE) {
+		if (now < stepTime) {
+			continue;
+		}
+		double drawn = drawnHeight(heights, simPhase, pollDelays, now);
+		double referenceDrawn = drawnHeight(referenceHeights, simPhase, pollDelays, now);
+		if (fabs(drawn - referenceDrawn) > MOTION_THRESHOLD) {
+			latency[LATENCY_DRAW] = now - stepTime;
+			latency[LATENCY_PHOTON] = now + 1.0 / FRAME_RATE - stepTime;
+			break;
+		}
+	}
+}
+
+//--------------------------------------------------------------
+static double percentile(const std::vector<double>& sorted, double part) {
+	return sorted.empty() ? NAN : sorted[std::min(sorted.size() - 1, (size_t)(part * sorted.size()))];
+}
+
+//--------------------------------------------------------------
+int main(int argc, char** argv) {
+	t_config config = defaultConfig();
+
+	std::string configPath = "data/config.xml";
+	std::string csvPath;
+	int trials = 200;
+	int decimation = 0;
+	unsigned seed = 1;
+	double maxPhoton = 0;
+	double blend = -1;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+			trials = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+			decimation = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-seed") && i + 1 < argc) {
+			seed = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-e") && i + 1 < argc) {
+			blend = atof(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-csv") && i + 1 < argc) {
+			csvPath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "-max") && i + 1 < argc) {
+			maxPhoton = atof(argv[++i]);
+		}
+		else {
+			configPath = argv[i];
+		}
+	}
+
+	if (!readConfigFile(configPath, config)) {
+		fprintf(stderr, "%s not found, using defaults\n", configPath.c_str());
+	}
+	if (decimation > 0) {
+		config.decimation = decimation;
+	}
+	if (blend >= 0) {
+		config.envelopeBlend = blend;
+	}
+	const bool onset = config.envelopeBlend > 0;
+
+	FILE* csv = csvPath.empty() ? NULL : fopen(csvPath.c_str(), "w");
+	if (csv) {
+		fprintf(csv, "trial");
+		for (int s = 0; s < LATENCY_STAGES; s++) {
+			fprintf(csv, ",%s", stageNames[s]);
+		}
+		fprintf(csv, "\n");
+	}
+
+	srand(seed);
+	std::vector<double> latencies[LATENCY_STAGES];
+	for (int t = 0; t < trials; t++) {
+		double latency[LATENCY_STAGES];
+		runTrial(config, onset, seed + t, latency);
+
+		if (csv) {
+			fprintf(csv, "%d", t);
+		}
+		for (int s = 0; s < LATENCY_STAGES; s++) {
+			if (latency[s] == latency[s]) {
+				latencies[s].push_back(latency[s]);
+			}
+			if (csv) {
+				fprintf(csv, ",%.2f", latency[s] * 1000);
+			}
+		}
+		if (csv) {
+			fprintf(csv, "\n");
+		}
+	}
+	if (csv) {
+		fclose(csv);
+	}
+
+	if (onset) {
+		printf("%d voice onsets, blocks %d, envelope blend %.2f, hop %d, window %d, decimation %d, %d Hz simulation, %d Hz frames\n",
+			trials, ENVELOPE_AUDIO_BLOCK, config.envelopeBlend, AUDIO_HOP_SIZE, AUDIO_BUFFER_SIZE, config.decimation,
+			SIMULATION_RATE, FRAME_RATE);
+	}
+	else {
+		printf("%d pitch steps of a fifth, hop %d, window %d, decimation %d, %d Hz simulation, %d Hz frames\n",
+			trials, AUDIO_HOP_SIZE, AUDIO_BUFFER_SIZE, config.decimation, SIMULATION_RATE, FRAME_RATE);
+	}
+	printf("cpu ms per s of audio: pitch %.2f, envelope %.3f\n\n",
+		pitchSeconds / audioSeconds * 1000, envelopeSeconds / audioSeconds * 1000);
+	printf("%-12s %8s %8s %8s %8s %8s %8s\n", "ms from step", "min", "median", "p90", "p99", "max", "missed");
+
+	for (int s = 0; s < LATENCY_STAGES; s++) {
+		std::vector<double>& values = latencies[s];
+		std::sort(values.begin(), values.end());
+		printf("%-12s %8.1f %8.1f %8.1f %8.1f %8.1f %8d\n", stageNames[s],
+			percentile(values, 0) * 1000, percentile(values, 0.5) * 1000, percentile(values, 0.9) * 1000,
+			percentile(values, 0.99) * 1000, values.empty() ? NAN : values.back() * 1000,
+			trials - (int)values.size());
+	}
+
+	double photon = percentile(latencies[LATENCY_PHOTON], 0.5) * 1000;
+	if (maxPhoton > 0 && !(photon <= maxPhoton)) {
+		printf("\nmedian voice to photon %.1f ms is over %.1f ms\n", photon, maxPhoton);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,185 @@
+// Checks the shared memory control stream with several reader processes.
+//
+// The publisher writes records whose fields are all derived from their
+// index, every reader verifies each record it gets (a torn read shows as
+// fields that disagree) and that indexes only go forward. Runs a burst at
+// full speed, where slow readers are expected to lose records, then a paced
+// run at 10x the audio block rate, where none may be lost.
+//
+// usage: tripnoStreamCheck [-r readers]
+//        tripnoStreamCheck -follow [name]    print a live stream
+
+#include "controlStream.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+
+struct t_readerResult {
+	unsigned long long records;
+	unsigned long long lost;
+	unsigned long long torn;
+	unsigned long long backwards;
+};
+
+//--------------------------------------------------------------
+static t_controlRecord makeRecord(uint32_t index) {
+	t_controlRecord record;
+	memset(&record, 0, sizeof(record));
+	record.freq = index * 0.25;
+	record.freqLog = index;
+	record.control = (float)(index % 4096);
+	record.peak = (float)(index & 255);
+	record.reserved = ~index;
+	return record;
+}
+
+static bool consistent(const t_controlRecord& record) {
+	t_controlRecord expected = makeRecord(record.index);
+	return record.freq == expected.freq && record.freqLog == expected.freqLog
+		&& record.control == expected.control && record.peak == expected.peak
+		&& record.reserved == expected.reserved;
+}
+
+//--------------------------------------------------------------
+// Reads until the record with index last, reports through the pipe
+static int runReader(const std::string& name, uint32_t last, int pipeOut) {
+	controlReader reader;
+	while (!reader.open(name)) {
+		sched_yield();
+	}
+
+	t_readerResult result;
+	memset(&result, 0, sizeof(result));
+
+	t_controlRecord record;
+	long long previous = -1;
+	while (previous < (long long)last) {
+		if (!reader.read(record)) {
+			sched_yield();
+			continue;
+		}
+		result.records++;
+		if (!consistent(record)) {
+			result.torn++;
+		}
+		if ((long long)record.index <= previous) {
+			result.backwards++;
+		}
+		previous = record.index;
+	}
+	result.lost = reader.getLost();
+
+	ssize_t written = write(pipeOut, &result, sizeof(result));
+	return written == sizeof(result) ? 0 : 1;
+}
+
+//--------------------------------------------------------------
+static bool runPhase(const char* title, int readers, uint32_t count, int pauseMicros, bool lossAllowed) {
+	std::string name = "tripno-check-" + std::to_string((long long)getpid());
+
+	controlPublisher publisher;
+	if (!publisher.open(name, 64)) {
+		fprintf(stderr, "cannot create /dev/shm/%s\n", name.c_str());
+		return false;
+	}
+
+	int pipes[2];
+	if (pipe(pipes) != 0) {
+		return false;
+	}
+
+	std::vector<pid_t> children;
+	for (int i = 0; i < readers; i++) {
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(pipes[0]);
+			_exit(runReader(name, count - 1, pipes[1]));
+		}
+		children.push_back(pid);
+	}
+	close(pipes[1]);
+
+	// give the readers time to attach, they start from the current head
+	usleep(200000);
+
+	uint64_t start = controlStreamTime();
+	for (uint32_t i = 0; i < count; i++) {
+		publisher.publish(makeRecord(i));
+		if (pauseMicros) {
+			usleep(pauseMicros);
+		}
+	}
+	double seconds = (controlStreamTime() - start) / 1e6;
+
+	bool ok = true;
+	printf("%s: %u records in %.2f s (%.0f/s), %d readers\n", title, count, seconds, count / seconds, readers);
+	for (int i = 0; i < readers; i++) {
+		t_readerResult result;
+		if (read(pipes[0], &result, sizeof(result)) != sizeof(result)) {
+			printf("  reader %d: no result\n", i);
+			ok = false;
+			continue;
+		}
+		bool readerOk = result.torn == 0 && result.backwards == 0 && (lossAllowed || result.lost == 0);
+		printf("  reader %d: %llu read, %llu lost, %llu torn, %llu out of order%s\n", i,
+			result.records, result.lost, result.torn, result.backwards, readerOk ? "" : "  FAILED");
+		ok = ok && readerOk;
+	}
+
+	for (size_t i = 0; i < children.size(); i++) {
+		int status;
+		waitpid(children[i], &status, 0);
+		ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	}
+	close(pipes[0]);
+
+	publisher.close();
+	shm_unlink(("/" + name).c_str());
+	return ok;
+}
+
+//--------------------------------------------------------------
+static int follow(const std::string& name) {
+	controlReader reader;
+	while (!reader.open(name)) {
+		usleep(100000);
+	}
+
+	t_controlRecord record;
+	while (true) {
+		while (reader.read(record)) {
+			printf("%8u %14llu %9.2f %8.4f %8.4f %6.3f  lost %llu\n", record.index,
+				(unsigned long long)record.timeMicros, record.freq, record.freqLog,
+				record.control, record.peak, reader.getLost());
+		}
+		fflush(stdout);
+		usleep(5000);
+	}
+	return 0;
+}
+
+//--------------------------------------------------------------
+int main(int argc, char** argv) {
+	int readers = 4;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-follow")) {
+			return follow(i + 1 < argc ? argv[i + 1] : CONTROL_STREAM_NAME);
+		}
+		if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+			readers = atoi(argv[++i]);
+		}
+	}
+
+	bool ok = runPhase("burst", readers, 20000000, 0, true);
+	ok = runPhase("paced", readers, 2000, 2000, false) && ok;
+
+	printf("%s\n", ok ? "ok" : "FAILED");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,681 @@
+// Parameter search for config.xml, headless.
+//
+// Replays sessions through the analysis chain and tripno's physics the way
+// the game runs them, for many parameter sets at once on all cores, and
+// writes the best set into a copy of the config. Sessions are captures
+// made with the game (see audioCapture.h), or the synthetic voice corpus
+// when none is given.
+//
+// Tuned: gateThreshold, maxSignalClampRate and rangeClampRate (analysis),
+// signalAmp, elasticKoeff and resistanceKoeff (physics). The rest of the
+// config is kept. Sets are drawn as analysis settings, each with physics
+// settings under it: the analysis runs once per analysis setting and
+// session, and every set under it replays the cached control.
+//   grid     levels per parameter, for the analysis and the physics
+//            apart, so that up to n sets are made
+//   random   uniform, sqrt(n) analysis settings
+//   refine   random rounds, each around the best sets of the previous one
+//            in a box half as wide
+//
+// Objectives, lower is better, tripno should follow the voice: the
+// reference pitch of a hop, placed in the session's pitch range, gives
+// the height to be at
+//   track       rms distance of tripno's height to that height, in
+//               TUNE_TARGET_HEIGHT: a tripno that barely moves is as far
+//               off as the voice goes
+//   lag         mean ms to cover half of the way after a pitch step
+//   collisions  wall touches per minute, among the sets that track at
+//               least as well as the config (a still tripno never touches)
+// Whatever the objective, sets that get half of the way within
+// TUNE_LAG_LIMIT on less than TUNE_MIN_FOLLOWED of the steps rank last,
+// and one is never written.
+// The reference pitch is the truth for the corpus, for captures it is the
+// analysis with the config, taken half a window later.
+//
+// usage: tripnoTune [config.xml] [-s grid|random|refine] [-n sets] [-o track|lag|collisions]
+//                   [-j threads] [-seed n] [-w out.xml] [capture.wav|capture.raw ...]
+//
+// -w defaults to data/config-tuned.xml, the config itself is not touched.
+
+#include "pitchAnalyzer.h"
+#include "tripnoPhysics.h"
+#include "atomicOps.h"
+#include "voiceCorpus.h"
+#include "captureFile.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+
+#define TUNE_PARAMS 6
+#define TUNE_ANALYSIS_PARAMS 3 // the first ones
+#define TUNE_REFINE_ROUNDS 4
+#define TUNE_REFINE_KEEP 4 // best sets a round samples around
+#define TUNE_TOP 5 // sets printed
+#define TUNE_VIEWPORT_WIDTH 1024 // the window main.cpp opens
+#define TUNE_TARGET_HEIGHT 140 // px from the middle for the ends of the pitch range
+#define TUNE_LAG_LIMIT 0.5 // s, a step not followed by then counts as that
+#define TUNE_STEP_RATIO 1.25 // pitch change between voiced hops taken as a step
+#define TUNE_STEP_GAP 3 // hops, at most between them
+#define TUNE_MIN_RANGE 2.0 // pitch ratio, a session sung in less still spans that
+#define TUNE_MIN_FOLLOWED 0.5 // part of the steps a set must follow to be kept
+
+struct t_tuneParam {
+	const char* name;
+	double t_config::*field;
+	double low;
+	double high;
+	bool logScale;
+};
+
+static const t_tuneParam tuneParams[TUNE_PARAMS] = {
+	{ "gateThreshold", &t_config::gateThreshold, 0, 0.4, false },
+	{ "maxSignalClampRate", &t_config::maxSignalClampRate, 0.98, 0.9995, false },
+	{ "rangeClampRate", &t_config::rangeClampRate, 0.0002, 0.02, true },
+	{ "signalAmp", &t_config::signalAmp, 10, 100000, true },
+	{ "elasticKoeff", &t_config::elasticKoeff, 0.05, 50, true },
+	{ "resistanceKoeff", &t_config::resistanceKoeff, 0.0005, 0.5, true },
+};
+
+enum t_objective { OBJECTIVE_TRACK, OBJECTIVE_LAG, OBJECTIVE_COLLISIONS };
+
+// a recording or corpus signal, with what it is judged against
+struct t_session {
+	t_captureFile audio;
+	int hops;
+	std::vector<double> target;		// height per hop
+	std::vector<int> steps;			// hops starting with a pitch step
+	std::vector<float> ceilWalls;	// px from the field edge, per wall segment
+	std::vector<float> floorWalls;
+};
+
+// a point of the search, in the unit cube of the parameters
+struct t_paramSet {
+	double unit[TUNE_PARAMS];
+	int analysis;		// index of its analysis setting in the round
+
+	double track;
+	double lag;			// ms
+	double followed;	// part of the steps reached half way within TUNE_LAG_LIMIT
+	double collisions;	// per minute
+	double score;
+};
+
+//--------------------------------------------------------------
+static double paramValue(int p, double unit) {
+	const t_tuneParam& param = tuneParams[p];
+	if (param.logScale) {
+		return param.low * pow(param.high / param.low, unit);
+	}
+	return param.low + (param.high - param.low) * unit;
+}
+
+static double paramUnit(int p, double value) {
+	const t_tuneParam& param = tuneParams[p];
+	double unit = param.logScale ? log(value / param.low) / log(param.high / param.low)
+		: (value - param.low) / (param.high - param.low);
+	return std::min(1.0, std::max(0.0, unit));
+}
+
+static t_config applySet(const t_config& base, const double* unit) {
+	t_config config = base;
+	for (int p = 0; p < TUNE_PARAMS; p++) {
+		config.*tuneParams[p].field = paramValue(p, unit[p]);
+	}
+	return config;
+}
+
+//--------------------------------------------------------------
+// runs task(0..count-1) on threads, each index once
+template<typename F>
+static void runParallel(int count, int threads, F task) {
+	uint32_t next = 0;
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; t++) {
+		workers.push_back(std::thread([&]() {
+			for (int i = fetchAdd(&next, 1); i < count; i = fetchAdd(&next, 1)) {
+				task(i);
+			}
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++) {
+		workers[t].join();
+	}
+}
+
+//--------------------------------------------------------------
+// control per hop, as audioIn hands it to the simulation
+static std::vector<float> runAnalysis(const t_captureFile& audio, int hops, const t_config& config,
+	std::vector<double>* pitches = NULL, std::vector<int>* pitchWindows = NULL) {
+
+	pitchAnalyzer<TRIPNO_SAMPLE_TYPE> analyzer;
+	analyzer.setup(config);
+
+	std::vector<float> control(hops);
+	for (int k = 0; k < hops; k++) {
+		t_analysis analysis = analyzer.process(&audio.samples[k * AUDIO_HOP_SIZE * audio.channels],
+			AUDIO_HOP_SIZE, audio.channels);
+		control[k] = analysis.control;
+
+		if (pitches) {
+			(*pitches)[k] = analysis.freq;
+			(*pitchWindows)[k] = (int)(analyzer.getPitchWindowSize() * SAMPLE_RATE / analyzer.getAnalysisRate());
+		}
+	}
+	return control;
+}
+
+//--------------------------------------------------------------
+// target heights and pitch steps from the reference pitch of every hop
+static void setReference(t_session& session, const std::vector<double>& pitches, unsigned seed) {
+	// the range the session is sung in, without its outliers. A held note
+	// stays in the middle, as the game's adaptive range puts it.
+	std::vector<double> voiced;
+	for (int k = 0; k < session.hops; k++) {
+		if (pitches[k] > 0) {
+			voiced.push_back(log(pitches[k]));
+		}
+	}
+	std::sort(voiced.begin(), voiced.end());
+	double low = voiced.empty() ? 0 : voiced[voiced.size() / 20];
+	double high = voiced.empty() ? 0 : voiced[voiced.size() * 19 / 20];
+	double middle = (low + high) / 2;
+	double half = std::max(log(TUNE_MIN_RANGE), high - low) / 2;
+
+	// silence lets tripno settle in the middle
+	session.target.assign(session.hops, 0);
+	session.steps.clear();
+	int lastVoiced = -1;
+	for (int k = 0; k < session.hops; k++) {
+		if (pitches[k] <= 0) {
+			continue;
+		}
+		double place = (log(pitches[k]) - middle) / half;
+		session.target[k] = std::min(1.0, std::max(-1.0, place)) * TUNE_TARGET_HEIGHT;
+
+		// a change across a short gap is a step too
+		if (lastVoiced >= 0 && k - lastVoiced <= TUNE_STEP_GAP
+			&& fabs(log(pitches[k] / pitches[lastVoiced])) > log(TUNE_STEP_RATIO)) {
+			session.steps.push_back(k);
+		}
+		lastVoiced = k;
+	}
+
+	// walls as the game draws them, the same for every set
+	std::mt19937 random(seed);
+	const double maxWall = gameFieldHeight(TUNE_VIEWPORT_WIDTH) * SEGMENT_MAX_HEIGHT_PART;
+	std::uniform_real_distribution<float> wall(maxWall / 2, maxWall);
+	int segments = (int)(session.hops * AUDIO_HOP_SIZE / (double)SAMPLE_RATE * MOVEMENT_SPEED) + 1;
+	session.ceilWalls.resize(segments);
+	session.floorWalls.resize(segments);
+	for (int s = 0; s < segments; s++) {
+		session.ceilWalls[s] = wall(random);
+		session.floorWalls[s] = wall(random);
+	}
+}
+
+//--------------------------------------------------------------
+static t_session corpusSession(const t_voiceSignal& signal, unsigned seed) {
+	t_session session;
+	session.audio.name = signal.name;
+	session.audio.sampleRate = signal.sampleRate;
+	session.audio.channels = 1;
+	session.audio.samples = signal.samples;
+	session.hops = signal.samples.size() / AUDIO_HOP_SIZE;
+
+	// what is sung at the end of each hop
+	std::vector<double> pitches(session.hops);
+	for (int k = 0; k < session.hops; k++) {
+		pitches[k] = signal.truth[(k + 1) * AUDIO_HOP_SIZE - 1];
+	}
+	setReference(session, pitches, seed);
+	return session;
+}
+
+//--------------------------------------------------------------
+static t_session captureSession(const t_captureFile& audio, const t_config& config, unsigned seed) {
+	t_session session;
+	session.audio = audio;
+	session.hops = audio.samples.size() / audio.channels / AUDIO_HOP_SIZE;
+
+	// the analysis with the config, looking half its window ahead
+	std::vector<double> pitches(session.hops), reference(session.hops);
+	std::vector<int> pitchWindows(session.hops);
+	runAnalysis(audio, session.hops, config, &pitches, &pitchWindows);
+	for (int k = 0; k < session.hops; k++) {
+		int later = k + (pitchWindows[k] / 2 + AUDIO_HOP_SIZE - 1) / AUDIO_HOP_SIZE;
+		reference[k] = later < session.hops ? pitches[later] : 0;
+	}
+	setReference(session, reference, seed);
+	return session;
+}
+
+//--------------------------------------------------------------
+// tripno through the session, as gameSimulation::step moves it against the walls
+static void replay(const t_session& session, const std::vector<float>& control, const t_config& config,
+	double& squares, double& lagSum, int& followed, int& touches) {
+
+	const double dt = 1.0 / SIMULATION_RATE;
+	const double hopTime = AUDIO_HOP_SIZE / (double)SAMPLE_RATE;
+	const double fieldHalf = gameFieldHeight(TUNE_VIEWPORT_WIDTH) / 2;
+	const int steps = (int)(session.hops * hopTime * SIMULATION_RATE);
+
+	t_tripnoMotion motion;
+	motion.y = motion.velocity = motion.elastic = motion.resistance = 0;
+	double signal = 0;
+	bool touching = false;
+
+	// the pitch step being followed
+	size_t nextStep = 0;
+	bool following = false;
+	double stepTime = 0, half = 0, direction = 0;
+
+	squares = 0;
+	lagSum = 0;
+	followed = 0;
+	touches = 0;
+	for (int n = 0; n < steps; n++) {
+		const double t = (n + 1) * dt;
+		const int hop = std::min(session.hops - 1, (int)(t / hopTime));
+
+		// a hop's control arrives at its end
+		if (hop > 0) {
+			signal = control[hop - 1] * config.signalAmp;
+		}
+		integrateTripno(motion, signal, 1.0, config, dt);
+
+		// bounced back by what it went past the walls
+		int segment = std::min((int)session.ceilWalls.size() - 1, (int)(t * MOVEMENT_SPEED));
+		bool touch = bounceTripno(motion, fieldHalf - session.ceilWalls[segment], session.floorWalls[segment] - fieldHalf);
+		touches += touch && !touching ? 1 : 0;
+		touching = touch;
+
+		const double target = session.target[hop];
+		squares += (motion.y - target) * (motion.y - target) * dt;
+
+		if (nextStep < session.steps.size() && hop >= session.steps[nextStep]) {
+			if (following) {
+				lagSum += TUNE_LAG_LIMIT;
+			}
+			following = true;
+			stepTime = session.steps[nextStep] * hopTime;
+			half = (motion.y + target) / 2;
+			direction = target > motion.y ? 1 : -1;
+			nextStep++;
+		}
+		if (following && (motion.y - half) * direction >= 0 && t - stepTime < TUNE_LAG_LIMIT) {
+			lagSum += t - stepTime;
+			followed++;
+			following = false;
+		}
+		else if (following && t - stepTime >= TUNE_LAG_LIMIT) {
+			lagSum += TUNE_LAG_LIMIT;
+			following = false;
+		}
+	}
+	if (following) {
+		lagSum += TUNE_LAG_LIMIT;
+	}
+}
+
+//--------------------------------------------------------------
+// the sets of a round, scored. cache[a][s] is the control of analysis
+// setting a on session s.
+static void evaluate(std::vector<t_paramSet>& sets, const std::vector<t_paramSet>& analyses,
+	const std::vector<t_session>& sessions, const t_config& base, int threads) {
+
+	const int nSessions = sessions.size();
+	std::vector< std::vector< std::vector<float> > > cache(analyses.size(), std::vector< std::vector<float> >(nSessions));
+	runParallel(analyses.size() * nSessions, threads, [&](int i) {
+		const int a = i / nSessions;
+		const t_session& session = sessions[i % nSessions];
+		cache[a][i % nSessions] = runAnalysis(session.audio, session.hops, applySet(base, analyses[a].unit));
+	});
+
+	runParallel(sets.size(), threads, [&](int i) {
+		t_paramSet& set = sets[i];
+		const t_config config = applySet(base, set.unit);
+
+		double squares = 0, lagSum = 0, seconds = 0;
+		int touches = 0, lagSteps = 0, followed = 0;
+		for (int s = 0; s < nSessions; s++) {
+			double sessionSquares, sessionLag;
+			int sessionFollowed, sessionTouches;
+			replay(sessions[s], cache[set.analysis][s], config, sessionSquares, sessionLag, sessionFollowed, sessionTouches);
+
+			seconds += sessions[s].hops * AUDIO_HOP_SIZE / (double)SAMPLE_RATE;
+			squares += sessionSquares;
+			lagSum += sessionLag;
+			lagSteps += sessions[s].steps.size();
+			followed += sessionFollowed;
+			touches += sessionTouches;
+		}
+
+		set.track = seconds > 0 ? sqrt(squares / seconds) / TUNE_TARGET_HEIGHT : 0;
+		set.lag = lagSteps ? lagSum / lagSteps * 1000 : 0;
+		set.followed = lagSteps ? (double)followed / lagSteps : 1;
+		set.collisions = seconds > 0 ? touches / seconds * 60 : 0;
+	});
+}
+
+//--------------------------------------------------------------
+static void score(std::vector<t_paramSet>& sets, t_objective objective, double baseTrack) {
+	for (size_t i = 0; i < sets.size(); i++) {
+		t_paramSet& set = sets[i];
+		switch (objective) {
+		case OBJECTIVE_TRACK:
+			set.score = set.track;
+			break;
+		case OBJECTIVE_LAG:
+			set.score = set.lag;
+			break;
+		default:
+			// the sets that track worse than the config come after the others
+			set.score = set.collisions + (set.track > baseTrack ? 1e6 * set.track : 0);
+			break;
+		}
+		// tripno must get to the pitch it is sung
+		if (set.followed < TUNE_MIN_FOLLOWED) {
+			set.score += 1e9 * (1 + TUNE_MIN_FOLLOWED - set.followed);
+		}
+	}
+}
+
+static bool followsSteps(const t_paramSet& set) {
+	return set.followed >= TUNE_MIN_FOLLOWED && set.lag < TUNE_LAG_LIMIT * 1000;
+}
+
+static bool betterSet(const t_paramSet& a, const t_paramSet& b) {
+	return a.score < b.score;
+}
+
+//--------------------------------------------------------------
+// one round of sets: nAnalyses analysis settings with the physics
+// settings under them, uniform or around centers in a box of width
+static void drawRound(int count, const std::vector<t_paramSet>& centers, double width, std::mt19937& random,
+	std::vector<t_paramSet>& analyses, std::vector<t_paramSet>& sets) {
+
+	std::uniform_real_distribution<double> uniform(0, 1);
+	const int nAnalyses = std::max(1, (int)(sqrt((double)count) + 0.5));
+
+	for (int a = 0; a < nAnalyses; a++) {
+		const t_paramSet* center = centers.empty() ? NULL : &centers[a % centers.size()];
+		t_paramSet analysis = t_paramSet();
+		for (int p = 0; p < TUNE_PARAMS; p++) {
+			analysis.unit[p] = center ? center->unit[p] + (uniform(random) - 0.5) * width : uniform(random);
+			analysis.unit[p] = std::min(1.0, std::max(0.0, analysis.unit[p]));
+		}
+		analysis.analysis = analyses.size();
+		analyses.push_back(analysis);
+
+		// the physics around the same center, count spread over the settings
+		int under = count / nAnalyses + (a < count % nAnalyses ? 1 : 0);
+		for (int i = 0; i < under; i++) {
+			t_paramSet set = analysis;
+			for (int p = TUNE_ANALYSIS_PARAMS; p < TUNE_PARAMS; p++) {
+				set.unit[p] = center ? center->unit[p] + (uniform(random) - 0.5) * width : uniform(random);
+				set.unit[p] = std::min(1.0, std::max(0.0, set.unit[p]));
+			}
+			sets.push_back(set);
+		}
+	}
+}
+
+//--------------------------------------------------------------
+static int gridSize(int levels, int params) {
+	int size = 1;
+	for (int p = 0; p < params; p++) {
+		size *= levels;
+	}
+	return size;
+}
+
+//--------------------------------------------------------------
+// analysis grid times physics grid, each with its own levels per
+// parameter: the most sets up to count, at least 2 levels. On a tie the
+// fewer analysis settings, each of them runs the analysis again.
+static void drawGrid(int count, std::vector<t_paramSet>& analyses, std::vector<t_paramSet>& sets) {
+	const int physicsParams = TUNE_PARAMS - TUNE_ANALYSIS_PARAMS;
+	int analysisLevels = 2, physicsLevels = 2;
+	for (int a = 2; gridSize(a, TUNE_ANALYSIS_PARAMS) * gridSize(2, physicsParams) <= count; a++) {
+		for (int p = 2; gridSize(a, TUNE_ANALYSIS_PARAMS) * gridSize(p, physicsParams) <= count; p++) {
+			if (gridSize(a, TUNE_ANALYSIS_PARAMS) * gridSize(p, physicsParams)
+				> gridSize(analysisLevels, TUNE_ANALYSIS_PARAMS) * gridSize(physicsLevels, physicsParams)) {
+				analysisLevels = a;
+				physicsLevels = p;
+			}
+		}
+	}
+
+	const int nAnalyses = gridSize(analysisLevels, TUNE_ANALYSIS_PARAMS);
+	const int perAnalysis = gridSize(physicsLevels, physicsParams);
+	for (int a = 0; a < nAnalyses; a++) {
+		t_paramSet analysis = t_paramSet();
+		for (int p = 0, rest = a; p < TUNE_ANALYSIS_PARAMS; p++, rest /= analysisLevels) {
+			analysis.unit[p] = (rest % analysisLevels) / (analysisLevels - 1.0);
+		}
+		analysis.analysis = analyses.size();
+		analyses.push_back(analysis);
+
+		for (int i = 0; i < perAnalysis; i++) {
+			t_paramSet set = analysis;
+			for (int p = TUNE_ANALYSIS_PARAMS, rest = i; p < TUNE_PARAMS; p++, rest /= physicsLevels) {
+				set.unit[p] = (rest % physicsLevels) / (physicsLevels - 1.0);
+			}
+			sets.push_back(set);
+		}
+	}
+}
+
+//--------------------------------------------------------------
+static void printSet(const char* rank, const t_paramSet& set, const t_config& base) {
+	const t_config config = applySet(base, set.unit);
+	printf("%-5s %7.3f %7.1f %8.0f%% %9.2f ", rank, set.track, set.lag, set.followed * 100, set.collisions);
+	for (int p = 0; p < TUNE_PARAMS; p++) {
+		printf(" %*g", (int)strlen(tuneParams[p].name), config.*tuneParams[p].field);
+	}
+	printf("\n");
+}
+
+//--------------------------------------------------------------
+// the config file with the tuned values in place, or added before </config>
+static bool writeConfig(const std::string& from, const std::string& to, const t_config& config) {
+	std::ifstream in(from.c_str());
+	std::stringstream buffer;
+	buffer << in.rdbuf();
+	std::string xml = in ? buffer.str() : "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<config>\n</config>\n";
+
+	for (int p = 0; p < TUNE_PARAMS; p++) {
+		char value[32];
+		snprintf(value, sizeof(value), "%g", config.*tuneParams[p].field);
+		std::string open = std::string("<") + tuneParams[p].name + ">";
+		std::string close = std::string("</") + tuneParams[p].name + ">";
+
+		size_t begin = xml.find(open);
+		size_t end = begin == std::string::npos ? begin : xml.find(close, begin);
+		if (end != std::string::npos) {
+			xml.replace(begin + open.size(), end - begin - open.size(), value);
+		}
+		else {
+			size_t at = xml.find("</config>");
+			if (at == std::string::npos) {
+				return false;
+			}
+			xml.insert(at, "  " + open + value + close + "\n");
+		}
+	}
+
+	std::ofstream out(to.c_str());
+	out << xml;
+	return (bool)out;
+}
+
+//--------------------------------------------------------------
+int main(int argc, char** argv) {
+	t_config config = defaultConfig();
+
+	std::string configPath = "data/config.xml";
+	std::string outPath = "data/config-tuned.xml";
+	std::string strategy = "refine";
+	std::string objectiveName = "track";
+	std::vector<std::string> capturePaths;
+	int count = 256;
+	int threads = std::max(1u, std::thread::hardware_concurrency());
+	unsigned seed = 1;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+			strategy = argv[++i];
+		}
+		else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+			count = std::max(1, atoi(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+			objectiveName = argv[++i];
+		}
+		else if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+			threads = std::max(1, atoi(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "-seed") && i + 1 < argc) {
+			seed = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-w") && i + 1 < argc) {
+			outPath = argv[++i];
+		}
+		else if (strstr(argv[i], ".xml")) {
+			configPath = argv[i];
+		}
+		else {
+			capturePaths.push_back(argv[i]);
+		}
+	}
+
+	t_objective objective;
+	if (objectiveName == "track") {
+		objective = OBJECTIVE_TRACK;
+	}
+	else if (objectiveName == "lag") {
+		objective = OBJECTIVE_LAG;
+	}
+	else if (objectiveName == "collisions") {
+		objective = OBJECTIVE_COLLISIONS;
+	}
+	else {
+		fprintf(stderr, "unknown objective %s\n", objectiveName.c_str());
+		return 1;
+	}
+	if (strategy != "grid" && strategy != "random" && strategy != "refine") {
+		fprintf(stderr, "unknown search %s\n", strategy.c_str());
+		return 1;
+	}
+
+	if (!readConfigFile(configPath, config)) {
+		fprintf(stderr, "%s not found, using defaults\n", configPath.c_str());
+	}
+
+	// decoded once, shared read-only by every evaluation
+	std::vector<t_session> sessions;
+	for (size_t i = 0; i < capturePaths.size(); i++) {
+		t_captureFile audio;
+		if (!readCaptureFile(capturePaths[i], audio) || audio.sampleRate != SAMPLE_RATE) {
+			fprintf(stderr, "%s: not a %d Hz float capture, skipped\n", capturePaths[i].c_str(), SAMPLE_RATE);
+			continue;
+		}
+		sessions.push_back(captureSession(audio, config, seed + i));
+	}
+	if (capturePaths.empty()) {
+		std::vector<t_voiceSignal> corpus = voiceCorpus(SAMPLE_RATE);
+		for (size_t i = 0; i < corpus.size(); i++) {
+			sessions.push_back(corpusSession(corpus[i], seed + i));
+		}
+	}
+
+	double seconds = 0;
+	for (size_t s = 0; s < sessions.size(); s++) {
+		seconds += sessions[s].hops * AUDIO_HOP_SIZE / (double)SAMPLE_RATE;
+	}
+	if (seconds <= 0) {
+		fprintf(stderr, "no audio to tune on\n");
+		return 1;
+	}
+
+	// the config itself, to compare with
+	std::vector<t_paramSet> baseAnalyses(1), baseSets(1);
+	for (int p = 0; p < TUNE_PARAMS; p++) {
+		baseAnalyses[0].unit[p] = paramUnit(p, config.*tuneParams[p].field);
+	}
+	baseSets[0] = baseAnalyses[0];
+	evaluate(baseSets, baseAnalyses, sessions, config, threads);
+	score(baseSets, objective, baseSets[0].track);
+	const double baseTrack = baseSets[0].track;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::mt19937 random(seed);
+	std::vector<t_paramSet> all;
+	int analysisRuns = 0;
+	const int rounds = strategy == "refine" ? TUNE_REFINE_ROUNDS : 1;
+	double width = 1;
+	for (int r = 0; r < rounds; r++) {
+		std::vector<t_paramSet> analyses, sets, centers;
+		if (r > 0) {
+			centers.assign(all.begin(), all.begin() + std::min((size_t)TUNE_REFINE_KEEP, all.size()));
+		}
+
+		if (strategy == "grid") {
+			drawGrid(count, analyses, sets);
+		}
+		else {
+			drawRound(count / rounds + (r < count % rounds ? 1 : 0), centers, width, random, analyses, sets);
+		}
+
+		evaluate(sets, analyses, sessions, config, threads);
+		score(sets, objective, baseTrack);
+		analysisRuns += analyses.size();
+
+		all.insert(all.end(), sets.begin(), sets.end());
+		std::sort(all.begin(), all.end(), betterSet);
+		width /= 2;
+		fprintf(stderr, "round %d: %d sets, best %g\n", r + 1, (int)sets.size(), all[0].score);
+	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("%d sessions, %.1f s of audio, %s search, %d sets, %d analysis settings, %d threads, %.1f s\n",
+		(int)sessions.size(), seconds, strategy.c_str(), (int)all.size(), analysisRuns, threads, elapsed);
+	printf("objective %s\n\n", objectiveName.c_str());
+	printf("%-5s %7s %7s %9s %9s ", "rank", "track", "lag ms", "followed", "coll/min");
+	for (int p = 0; p < TUNE_PARAMS; p++) {
+		printf(" %s", tuneParams[p].name);
+	}
+	printf("\n");
+
+	printSet("base", baseSets[0], config);
+	for (int i = 0; i < TUNE_TOP && i < (int)all.size(); i++) {
+		char rank[8];
+		snprintf(rank, sizeof(rank), "%d", i + 1);
+		printSet(rank, all[i], config);
+	}
+
+	if (all.empty() || !(all[0].score < baseSets[0].score)) {
+		printf("\nno set beats the config, nothing written\n");
+		return 0;
+	}
+	if (!followsSteps(all[0])) {
+		printf("\nthe best set follows %.0f%% of the pitch steps, less than %.0f%%, nothing written\n",
+			all[0].followed * 100, TUNE_MIN_FOLLOWED * 100);
+		return 0;
+	}
+	if (!writeConfig(configPath, outPath, applySet(config, all[0].unit))) {
+		fprintf(stderr, "cannot write %s\n", outPath.c_str());
+		return 1;
+	}
+	printf("\nwritten to %s\n", outPath.c_str());
+	return 0;
+}
@@ -0,0 +1,209 @@
+#include "voiceCorpus.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+//--------------------------------------------------------------
+// F1..F3 in Hz, adult averages
+static const double formants[5][3] = {
+	{ 730, 1090, 2440 },	// a
+	{ 530, 1840, 2480 },	// e
+	{ 270, 2290, 3010 },	// i
+	{ 570,  840, 2410 },	// o
+	{ 300,  870, 2240 },	// u
+};
+static const double bandwidths[3] = { 60, 90, 120 };
+
+// two-pole resonator, unity gain at DC
+struct resonator {
+	double a1, a2, gain;
+	double y1, y2;
+
+	void setup(double freq, double bandwidth, double sampleRate) {
+		double r = exp(-M_PI * bandwidth / sampleRate);
+		a1 = 2 * r * cos(2 * M_PI * freq / sampleRate);
+		a2 = -r * r;
+		gain = 1 - a1 - a2;
+	}
+
+	double process(double x) {
+		double y = gain * x + a1 * y1 + a2 * y2;
+		y2 = y1;
+		y1 = y;
+		return y;
+	}
+};
+
+//--------------------------------------------------------------
+// Rosenberg pulse, phase in [0, 1)
+static double glottalPulse(double phase) {
+	const double opening = 0.4;
+	const double closing = 0.16;
+
+	if (phase < opening) {
+		return 0.5 * (1 - cos(M_PI * phase / opening));
+	}
+	if (phase < opening + closing) {
+		return cos(M_PI * (phase - opening) / (2 * closing));
+	}
+	return 0;
+}
+
+//--------------------------------------------------------------
+static double noise(unsigned& state) {
+	state = state * 1664525u + 1013904223u;
+	return (state >> 8) / (double)(1 << 24) * 2 - 1;
+}
+
+//--------------------------------------------------------------
+t_voiceSignal synthesizeVoice(const std::string& name, const std::vector<t_voiceSegment>& segments,
+	double sampleRate, unsigned seed) {
+
+	t_voiceSignal signal;
+	signal.name = name;
+	signal.sampleRate = sampleRate;
+
+	resonator filters[3] = {};
+	double phase = 0;
+	double previousPulse = 0;
+	double breathLow = 0;
+	double time = 0;
+
+	for (size_t s = 0; s < segments.size(); s++) {
+		const t_voiceSegment& segment = segments[s];
+		const int count = segment.duration * sampleRate;
+		const double ramp = 0.02 * sampleRate;	// 20 ms attack and release
+
+		for (int k = 0; k < 3; k++) {
+			filters[k].setup(formants[segment.vowel][k], bandwidths[k], sampleRate);
+		}
+
+		for (int i = 0; i < count; i++, time += 1 / sampleRate) {
+			double envelope = std::min(1.0, std::min(i / ramp, (count - i) / ramp));
+
+			double f0 = 0;
+			if (segment.f0Start > 0) {
+				f0 = segment.f0Start * pow(segment.f0End / segment.f0Start, (double)i / count);
+				f0 *= 1 + segment.vibratoDepth * sin(2 * M_PI * segment.vibratoRate * time);
+			}
+
+			// differentiated glottal flow : the lip radiation
+			double voice = 0;
+			if (f0 > 0) {
+				phase += f0 / sampleRate;
+				phase -= floor(phase);
+				double pulse = glottalPulse(phase);
+				voice = (pulse - previousPulse) * sampleRate / f0;
+				previousPulse = pulse;
+			}
+
+			// breath : white noise with the lowest octaves taken out
+			double white = noise(seed);
+			breathLow += (white - breathLow) * 0.05;
+			double breath = (white - breathLow) * segment.breath;
+
+			double x = voice * segment.level + breath;
+			for (int k = 0; k < 3; k++) {
+				x = filters[k].process(x);
+			}
+
+			// noise floor of a real input
+			x = x * envelope + noise(seed) * 1e-4;
+
+			signal.samples.push_back(x);
+			signal.truth.push_back(f0 > 0 && envelope > 0.5 ? f0 : 0);
+		}
+	}
+
+	// normalize to a comfortable peak
+	float peak = 0;
+	for (size_t i = 0; i < signal.samples.size(); i++) {
+		peak = std::max(peak, std::fabs(signal.samples[i]));
+	}
+	for (size_t i = 0; peak > 0 && i < signal.samples.size(); i++) {
+		signal.samples[i] *= 0.5f / peak;
+	}
+
+	return signal;
+}
+
+//--------------------------------------------------------------
+static t_voiceSegment segment(double duration, double f0Start, double f0End, t_vowel vowel,
+	double vibrato = 0, double breath = 0, double level = 1) {
+
+	t_voiceSegment s;
+	s.duration = duration;
+	s.f0Start = f0Start;
+	s.f0End = f0End;
+	s.vibratoDepth = vibrato;
+	s.vibratoRate = 5.5;
+	s.breath = breath;
+	s.level = level;
+	s.vowel = vowel;
+	return s;
+}
+
+//--------------------------------------------------------------
+std::vector<t_voiceSignal> voiceCorpus(double sampleRate) {
+	std::vector<t_voiceSignal> corpus;
+	std::vector<t_voiceSegment> v;
+
+	// low male voice, steady
+	v.clear();
+	v.push_back(segment(3, 110, 110, VOWEL_A));
+	corpus.push_back(synthesizeVoice("steady-110", v, sampleRate, 1));
+
+	// sung note with vibrato
+	v.clear();
+	v.push_back(segment(3, 330, 330, VOWEL_I, 0.03));
+	corpus.push_back(synthesizeVoice("vibrato-330", v, sampleRate, 2));
+
+	// slow glide up two octaves and back
+	v.clear();
+	v.push_back(segment(2, 150, 600, VOWEL_U));
+	v.push_back(segment(2, 600, 150, VOWEL_U));
+	corpus.push_back(synthesizeVoice("glide-150-600", v, sampleRate, 3));
+
+	// octave jumps
+	v.clear();
+	for (int i = 0; i < 8; i++) {
+		double f0 = i % 2 ? 400 : 200;
+		v.push_back(segment(0.5, f0, f0, VOWEL_A));
+	}
+	corpus.push_back(synthesizeVoice("octave-jumps", v, sampleRate, 4));
+
+	// phrases : notes, breaths and silence gaps
+	v.clear();
+	const double notes[] = { 196, 220, 247, 262, 294, 262, 220, 196 };
+	for (int i = 0; i < 8; i++) {
+		v.push_back(segment(0.6, notes[i], notes[i], (t_vowel)(i % 5), 0.01, 0.05));
+		v.push_back(i % 2
+			? segment(0.3, 0, 0, VOWEL_A, 0, 0.3)	// breath in
+			: segment(0.3, 0, 0, VOWEL_A));			// silence
+	}
+	corpus.push_back(synthesizeVoice("phrases", v, sampleRate, 5));
+
+	// breathy voice
+	v.clear();
+	v.push_back(segment(3, 250, 250, VOWEL_E, 0.01, 0.6));
+	corpus.push_back(synthesizeVoice("breathy-250", v, sampleRate, 6));
+
+	// child voice, high with vibrato and a glide
+	v.clear();
+	v.push_back(segment(1.5, 450, 450, VOWEL_O, 0.03));
+	v.push_back(segment(1.5, 450, 700, VOWEL_O, 0.03));
+	corpus.push_back(synthesizeVoice("child-450-700", v, sampleRate, 7));
+
+	// quiet singer, far from the mic
+	v.clear();
+	v.push_back(segment(1, 180, 180, VOWEL_A, 0.02, 0.1, 1));
+	v.push_back(segment(2, 180, 240, VOWEL_A, 0.02, 0.1, 0.1));
+	corpus.push_back(synthesizeVoice("fading-180", v, sampleRate, 8));
+
+	return corpus;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Synthetic voice-like signals with known pitch, for judging the analysis
+// chain: a Rosenberg glottal pulse train through three formant resonators,
+// with vibrato, glides, breath noise and silence.
+
+enum t_vowel { VOWEL_A, VOWEL_E, VOWEL_I, VOWEL_O, VOWEL_U };
+
+struct t_voiceSegment {
+	double duration;		// s
+	double f0Start;			// Hz, 0 - no voice
+	double f0End;			// Hz, glides geometrically from f0Start
+	double vibratoDepth;	// part of f0
+	double vibratoRate;		// Hz
+	double breath;			// breath noise level, relative to the voice
+	double level;			// voice level, relative to the loudest segment
+	t_vowel vowel;
+};
+
+struct t_voiceSignal {
+	std::string name;
+	double sampleRate;
+	std::vector<float> samples;
+	std::vector<float> truth;	// f0 per sample, 0 when unvoiced
+};
+
+t_voiceSignal synthesizeVoice(const std::string& name, const std::vector<t_voiceSegment>& segments,
+	double sampleRate, unsigned seed);
+
+// the standard corpus the benchmark runs
+std::vector<t_voiceSignal> voiceCorpus(double sampleRate);